@@ -1,5 +1,6 @@
 #include <gbm.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <wlr/util/log.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -89,23 +90,72 @@ static void set_plane_props(struct atomic *atom, struct wlr_drm_plane *plane,
 	atomic_add(atom, id, props->crtc_h, plane->surf.height);
 	atomic_add(atom, id, props->fb_id, fb_id);
 	atomic_add(atom, id, props->crtc_id, crtc_id);
+	if (plane->in_fence_fd >= 0 && props->in_fence_fd != 0) {
+		atomic_add(atom, id, props->in_fence_fd, plane->in_fence_fd);
+	}
 	if (set_crtc_xy) {
 		atomic_add(atom, id, props->crtc_x, 0);
 		atomic_add(atom, id, props->crtc_y, 0);
 	}
 }
 
+// The kernel holds a reference to the fences once they have been committed
+static void release_in_fences(struct wlr_drm_crtc *crtc) {
+	for (size_t type = 0; type < 3; ++type) {
+		struct wlr_drm_plane *plane = crtc->planes[type];
+		if (plane != NULL && plane->in_fence_fd >= 0) {
+			close(plane->in_fence_fd);
+			plane->in_fence_fd = -1;
+		}
+	}
+}
+
+// Replaces the mode blob of the CRTC if the new mode has been applied
+static void finish_mode_blob(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, uint32_t mode_id, bool applied) {
+	if (mode_id == crtc->mode_id) {
+		return;
+	}
+	if (!applied) {
+		drmModeDestroyPropertyBlob(drm->fd, mode_id);
+		return;
+	}
+	if (crtc->mode_id != 0) {
+		drmModeDestroyPropertyBlob(drm->fd, crtc->mode_id);
+	}
+	crtc->mode_id = mode_id;
+}
+
+// Replaces the gamma LUT blob of the CRTC if the new one has been applied
+static void finish_gamma_lut(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, uint32_t gamma_lut, bool applied) {
+	if (gamma_lut == 0 || gamma_lut == crtc->gamma_lut) {
+		return;
+	}
+	if (!applied) {
+		// Unless superseded, it'll be part of the next pageflip
+		if (gamma_lut != crtc->pending_gamma_lut) {
+			drmModeDestroyPropertyBlob(drm->fd, gamma_lut);
+		}
+		return;
+	}
+	if (crtc->gamma_lut != 0) {
+		drmModeDestroyPropertyBlob(drm->fd, crtc->gamma_lut);
+	}
+	crtc->gamma_lut = gamma_lut;
+	if (crtc->pending_gamma_lut == gamma_lut) {
+		crtc->pending_gamma_lut = 0;
+	}
+}
+
 static bool atomic_crtc_pageflip(struct wlr_drm_backend *drm,
 		struct wlr_drm_connector *conn,
 		struct wlr_drm_crtc *crtc,
 		uint32_t fb_id, drmModeModeInfo *mode) {
+	uint32_t mode_id = crtc->mode_id;
 	if (mode != NULL) {
-		if (crtc->mode_id != 0) {
-			drmModeDestroyPropertyBlob(drm->fd, crtc->mode_id);
-		}
-
 		if (drmModeCreatePropertyBlob(drm->fd, mode, sizeof(*mode),
-				&crtc->mode_id)) {
+				&mode_id)) {
 			wlr_log_errno(WLR_ERROR, "Unable to create property blob");
 			return false;
 		}
@@ -125,10 +175,128 @@ static bool atomic_crtc_pageflip(struct wlr_drm_backend *drm,
 		atomic_add(&atom, conn->id, conn->props.link_status,
 			DRM_MODE_LINK_STATUS_GOOD);
 	}
-	atomic_add(&atom, crtc->id, crtc->props.mode_id, crtc->mode_id);
+	atomic_add(&atom, crtc->id, crtc->props.mode_id, mode_id);
 	atomic_add(&atom, crtc->id, crtc->props.active, 1);
+	if (crtc->props.vrr_enabled != 0) {
+		atomic_add(&atom, crtc->id, crtc->props.vrr_enabled,
+			crtc->vrr_enabled);
+	}
+	uint32_t gamma_lut = crtc->pending_gamma_lut;
+	if (gamma_lut != 0) {
+		atomic_add(&atom, crtc->id, crtc->props.gamma_lut, gamma_lut);
+	}
 	set_plane_props(&atom, crtc->primary, crtc->id, fb_id, true);
-	return atomic_commit(drm->fd, &atom, conn, flags, mode);
+	// Apply the latest cursor position along with the new frame
+	struct wlr_drm_plane *cursor = crtc->cursor;
+	bool has_cursor = cursor != NULL && cursor->id != 0;
+	if (has_cursor) {
+		atomic_add(&atom, cursor->id, cursor->props.crtc_x, conn->cursor_x);
+		atomic_add(&atom, cursor->id, cursor->props.crtc_y, conn->cursor_y);
+	} else if (cursor != NULL && conn->cursor_dirty) {
+		// We can't use atomic operations on fake planes
+		conn->cursor_dirty = !legacy_iface.crtc_move_cursor(drm, crtc,
+			conn->cursor_x, conn->cursor_y);
+	}
+
+	if (drm->batching) {
+		if (atom.failed) {
+			drmModeAtomicSetCursor(atom.req, atom.cursor);
+			finish_mode_blob(drm, crtc, mode_id, false);
+			return false;
+		}
+		// Committed along with the other CRTCs in atomic_commit_batch
+		if (crtc->batch_conn == NULL) {
+			crtc->batch_cursor = atom.cursor;
+		}
+		if (mode != NULL) {
+			if (crtc->batch_mode_id != 0) {
+				finish_mode_blob(drm, crtc, crtc->batch_mode_id, false);
+			}
+			crtc->batch_mode_id = mode_id;
+		}
+		if (gamma_lut != 0) {
+			if (crtc->batch_gamma_lut != gamma_lut) {
+				finish_gamma_lut(drm, crtc, crtc->batch_gamma_lut, false);
+			}
+			crtc->batch_gamma_lut = gamma_lut;
+		}
+		crtc->batch_conn = conn;
+		return true;
+	}
+
+	bool ok = atomic_commit(drm->fd, &atom, conn, flags, mode);
+	finish_mode_blob(drm, crtc, mode_id, ok);
+	finish_gamma_lut(drm, crtc, gamma_lut, ok);
+	release_in_fences(crtc);
+	if (ok && has_cursor) {
+		conn->cursor_dirty = false;
+	}
+	return ok;
+}
+
+static bool atomic_commit_batch(struct wlr_drm_backend *drm) {
+	drmModeAtomicReq *req = drmModeAtomicAlloc();
+	if (req == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+
+	bool ok = true;
+	bool modeset = false;
+	struct wlr_drm_connector *conn = NULL;
+	for (size_t i = 0; i < drm->num_crtcs; ++i) {
+		struct wlr_drm_crtc *crtc = &drm->crtcs[i];
+		if (crtc->batch_conn == NULL) {
+			continue;
+		}
+		if (drmModeAtomicMerge(req, crtc->atomic) < 0) {
+			wlr_log_errno(WLR_ERROR, "Failed to merge atomic requests");
+			ok = false;
+		}
+		modeset |= crtc->batch_mode_id != 0;
+		conn = crtc->batch_conn;
+	}
+
+	if (conn == NULL) {
+		drmModeAtomicFree(req);
+		return true;
+	}
+
+	uint32_t flags = modeset ?
+		DRM_MODE_ATOMIC_ALLOW_MODESET : DRM_MODE_ATOMIC_NONBLOCK;
+	if (ok && drmModeAtomicCommit(drm->fd, req,
+			flags | DRM_MODE_ATOMIC_TEST_ONLY, NULL)) {
+		wlr_log_errno(WLR_ERROR, "Atomic test of batched commit failed");
+		ok = false;
+	}
+	// Page-flip events carry the CRTC ID, see page_flip_handler
+	if (ok && drmModeAtomicCommit(drm->fd, req,
+			flags | DRM_MODE_PAGE_FLIP_EVENT, conn)) {
+		wlr_log_errno(WLR_ERROR, "Batched atomic commit failed (%s)",
+			modeset ? "modeset" : "pageflip");
+		ok = false;
+	}
+	drmModeAtomicFree(req);
+
+	for (size_t i = 0; i < drm->num_crtcs; ++i) {
+		struct wlr_drm_crtc *crtc = &drm->crtcs[i];
+		if (crtc->batch_conn == NULL) {
+			continue;
+		}
+		drmModeAtomicSetCursor(crtc->atomic, ok ? 0 : crtc->batch_cursor);
+		if (crtc->batch_mode_id != 0) {
+			finish_mode_blob(drm, crtc, crtc->batch_mode_id, ok);
+		}
+		finish_gamma_lut(drm, crtc, crtc->batch_gamma_lut, ok);
+		if (ok) {
+			release_in_fences(crtc);
+		}
+		crtc->batch_conn = NULL;
+		crtc->batch_mode_id = 0;
+		crtc->batch_gamma_lut = 0;
+	}
+
+	return ok;
 }
 
 static bool atomic_conn_enable(struct wlr_drm_backend *drm,
@@ -148,8 +316,10 @@ static bool atomic_conn_enable(struct wlr_drm_backend *drm,
 		atomic_add(&atom, conn->id, conn->props.crtc_id, 0);
 		atomic_add(&atom, crtc->id, crtc->props.mode_id, 0);
 	}
-	return atomic_commit(drm->fd, &atom, conn, DRM_MODE_ATOMIC_ALLOW_MODESET,
-		true);
+	bool ok = atomic_commit(drm->fd, &atom, conn,
+		DRM_MODE_ATOMIC_ALLOW_MODESET, true);
+	release_in_fences(crtc);
+	return ok;
 }
 
 bool legacy_crtc_set_cursor(struct wlr_drm_backend *drm,
@@ -197,12 +367,29 @@ static bool atomic_crtc_move_cursor(struct wlr_drm_backend *drm,
 		return legacy_crtc_move_cursor(drm, crtc, x, y);
 	}
 
-	struct atomic atom;
-
-	atomic_begin(crtc, &atom);
+	// Only the cursor position is committed, the rest of the CRTC state is
+	// left to the next pageflip. This is only done when no frame is about to
+	// be rendered, see drm_connector_stage_cursor: the pageflip would fail
+	// with EBUSY until this commit is applied.
+	struct atomic atom = { .req = drmModeAtomicAlloc() };
+	if (!atom.req) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return legacy_crtc_move_cursor(drm, crtc, x, y);
+	}
 	atomic_add(&atom, plane->id, plane->props.crtc_x, x);
 	atomic_add(&atom, plane->id, plane->props.crtc_y, y);
-	return atomic_end(drm->fd, &atom);
+
+	bool ok = !atom.failed &&
+		drmModeAtomicCommit(drm->fd, atom.req, DRM_MODE_ATOMIC_NONBLOCK,
+			NULL) == 0;
+	if (!ok) {
+		// e.g. EBUSY while a pageflip is pending
+		wlr_log_errno(WLR_DEBUG, "Atomic cursor move failed, "
+			"falling back to legacy");
+	}
+	drmModeAtomicFree(atom.req);
+
+	return ok || legacy_crtc_move_cursor(drm, crtc, x, y);
 }
 
 static bool atomic_crtc_set_gamma(struct wlr_drm_backend *drm,
@@ -230,22 +417,24 @@ static bool atomic_crtc_set_gamma(struct wlr_drm_backend *drm,
 		gamma[i].blue = b[i];
 	}
 
-	if (crtc->gamma_lut != 0) {
-		drmModeDestroyPropertyBlob(drm->fd, crtc->gamma_lut);
-	}
-
+	uint32_t gamma_lut;
 	if (drmModeCreatePropertyBlob(drm->fd, gamma,
-			size * sizeof(struct drm_color_lut), &crtc->gamma_lut)) {
+			size * sizeof(struct drm_color_lut), &gamma_lut)) {
 		free(gamma);
 		wlr_log_errno(WLR_ERROR, "Unable to create property blob");
 		return false;
 	}
 	free(gamma);
 
-	struct atomic atom;
-	atomic_begin(crtc, &atom);
-	atomic_add(&atom, crtc->id, crtc->props.gamma_lut, crtc->gamma_lut);
-	return atomic_end(drm->fd, &atom);
+	// The LUT is applied with the next pageflip, instead of committing it
+	// right away and racing with pending pageflips. The blob might still be
+	// referenced by the current batch.
+	if (crtc->pending_gamma_lut != 0 &&
+			crtc->pending_gamma_lut != crtc->batch_gamma_lut) {
+		drmModeDestroyPropertyBlob(drm->fd, crtc->pending_gamma_lut);
+	}
+	crtc->pending_gamma_lut = gamma_lut;
+	return true;
 }
 
 static size_t atomic_crtc_get_gamma_size(struct wlr_drm_backend *drm,
@@ -264,6 +453,17 @@ static size_t atomic_crtc_get_gamma_size(struct wlr_drm_backend *drm,
 	return (size_t)gamma_lut_size;
 }
 
+static bool atomic_crtc_set_vrr(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, bool enabled) {
+	if (crtc->props.vrr_enabled == 0) {
+		return !enabled;
+	}
+
+	// Applied with the next pageflip
+	crtc->vrr_enabled = enabled;
+	return true;
+}
+
 const struct wlr_drm_interface atomic_iface = {
 	.conn_enable = atomic_conn_enable,
 	.crtc_pageflip = atomic_crtc_pageflip,
@@ -271,4 +471,6 @@ const struct wlr_drm_interface atomic_iface = {
 	.crtc_move_cursor = atomic_crtc_move_cursor,
 	.crtc_set_gamma = atomic_crtc_set_gamma,
 	.crtc_get_gamma_size = atomic_crtc_get_gamma_size,
+	.crtc_set_vrr = atomic_crtc_set_vrr,
+	.commit_batch = atomic_commit_batch,
 };
@@ -1,8 +1,10 @@
+#define _POSIX_C_SOURCE 200112L
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <wayland-server.h>
 #include <wlr/backend/interface.h>
@@ -23,7 +25,8 @@ struct wlr_drm_backend *get_drm_backend_from_backend(
 
 static bool backend_start(struct wlr_backend *backend) {
 	struct wlr_drm_backend *drm = get_drm_backend_from_backend(backend);
-	scan_drm_connectors(drm);
+	clock_gettime(drm->clock, &drm->start_time);
+	scan_drm_connectors(drm, NULL);
 	return true;
 }
 
@@ -88,7 +91,7 @@ static void session_signal(struct wl_listener *listener, void *data) {
 
 	if (session->active) {
 		wlr_log(WLR_INFO, "DRM fd resumed");
-		scan_drm_connectors(drm);
+		scan_drm_connectors(drm, NULL);
 
 		struct wlr_drm_connector *conn;
 		wl_list_for_each(conn, &drm->outputs, link){
@@ -109,30 +112,44 @@ static void session_signal(struct wl_listener *listener, void *data) {
 			drm->iface->crtc_move_cursor(drm, conn->crtc, conn->cursor_x,
 				conn->cursor_y);
 
+			// Shader gamma is applied while rendering, its table is still valid
+			if (conn->crtc->shader_gamma) {
+				continue;
+			}
 			if (conn->crtc->gamma_table != NULL) {
 				size_t size = conn->crtc->gamma_table_size;
 				uint16_t *r = conn->crtc->gamma_table;
 				uint16_t *g = conn->crtc->gamma_table + size;
 				uint16_t *b = conn->crtc->gamma_table + 2 * size;
 				drm->iface->crtc_set_gamma(drm, conn->crtc, size, r, g, b);
+				if (conn->crtc->pending_gamma_lut != 0) {
+					wlr_output_schedule_frame(&conn->output);
+				}
 			} else {
 				set_drm_connector_gamma(&conn->output, 0, NULL, NULL, NULL);
 			}
 		}
 	} else {
 		wlr_log(WLR_INFO, "DRM fd paused");
+
+		// The next DRM master may change the CRTCs
+		struct wlr_drm_connector *conn;
+		wl_list_for_each(conn, &drm->outputs, link) {
+			conn->boot_mode_pending = false;
+		}
 	}
 }
 
 static void drm_invalidated(struct wl_listener *listener, void *data) {
 	struct wlr_drm_backend *drm =
 		wl_container_of(listener, drm, drm_invalidated);
+	struct wlr_device_hotplug_event *event = data;
 
 	char *name = drmGetDeviceNameFromFd2(drm->fd);
 	wlr_log(WLR_DEBUG, "%s invalidated", name);
 	free(name);
 
-	scan_drm_connectors(drm);
+	scan_drm_connectors(drm, event);
 }
 
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
@@ -164,12 +181,26 @@ struct wlr_backend *wlr_drm_backend_create(struct wl_display *display,
 	wl_list_init(&drm->outputs);
 
 	drm->fd = gpu_fd;
+	drm->frame_margin_ns = -1;
+	const char *margin_str = getenv("WLR_DRM_FRAME_SCHEDULING_MARGIN");
+	if (margin_str != NULL) {
+		char *end;
+		long margin_us = strtol(margin_str, &end, 10);
+		if (*end != '\0' || margin_us < 0 || margin_us > 1000000) {
+			wlr_log(WLR_ERROR, "Invalid WLR_DRM_FRAME_SCHEDULING_MARGIN, "
+				"disabling adaptive frame scheduling");
+		} else {
+			drm->frame_margin_ns = margin_us * 1000;
+		}
+	}
+	const char *no_boot_mode = getenv("WLR_DRM_NO_BOOT_MODE");
+	drm->adopt_boot_mode = !no_boot_mode || strcmp(no_boot_mode, "1") != 0;
 	if (parent != NULL) {
 		drm->parent = get_drm_backend_from_backend(parent);
 	}
 
 	drm->drm_invalidated.notify = drm_invalidated;
-	wlr_session_signal_add(session, gpu_fd, &drm->drm_invalidated);
+	wlr_session_hotplug_add(session, gpu_fd, &drm->drm_invalidated);
 
 	drm->display = display;
 	struct wl_event_loop *event_loop = wl_display_get_event_loop(display);
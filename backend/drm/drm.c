@@ -13,9 +13,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <wayland-server.h>
 #include <wayland-util.h>
 #include <wlr/backend/interface.h>
+#include <wlr/backend/multi.h>
 #include <wlr/interfaces/wlr_output.h>
 #include <wlr/render/gles2.h>
 #include <wlr/render/wlr_renderer.h>
@@ -119,6 +121,7 @@ static bool init_planes(struct wlr_drm_backend *drm) {
 		}
 
 		p->type = type;
+		p->in_fence_fd = -1;
 		drm->num_type_planes[type]++;
 
 		// Choose an RGB format for the plane
@@ -227,6 +230,9 @@ void finish_drm_resources(struct wlr_drm_backend *drm) {
 		if (crtc->gamma_lut) {
 			drmModeDestroyPropertyBlob(drm->fd, crtc->gamma_lut);
 		}
+		if (crtc->pending_gamma_lut) {
+			drmModeDestroyPropertyBlob(drm->fd, crtc->pending_gamma_lut);
+		}
 		free(crtc->gamma_table);
 	}
 
@@ -240,10 +246,108 @@ static struct wlr_drm_connector *get_drm_connector_from_output(
 	return (struct wlr_drm_connector *)wlr_output;
 }
 
+static int64_t timespec_to_nsec(const struct timespec *t) {
+	return (int64_t)t->tv_sec * 1000000000 + t->tv_nsec;
+}
+
+// Sets the CRTC's gamma ramp for the next render pass if it has no gamma LUT
+static void drm_crtc_set_render_gamma(struct wlr_drm_crtc *crtc,
+		struct wlr_renderer *renderer) {
+	if (crtc->shader_gamma && crtc->gamma_table != NULL) {
+		size_t size = crtc->gamma_table_size;
+		wlr_renderer_set_gamma(renderer, size, crtc->gamma_table,
+			crtc->gamma_table + size, crtc->gamma_table + 2 * size);
+	} else {
+		wlr_renderer_set_gamma(renderer, 0, NULL, NULL, NULL);
+	}
+}
+
 static bool drm_connector_make_current(struct wlr_output *output,
 		int *buffer_age) {
 	struct wlr_drm_connector *conn = get_drm_connector_from_output(output);
-	return make_drm_surface_current(&conn->crtc->primary->surf, buffer_age);
+	struct wlr_drm_backend *drm = get_drm_backend_from_backend(output->backend);
+	struct wlr_drm_plane *plane = conn->crtc->primary;
+	if (!make_drm_surface_current(&plane->surf, buffer_age)) {
+		return false;
+	}
+	drm_crtc_set_render_gamma(conn->crtc, plane->surf.renderer->wlr_rend);
+	if (!conn->rendering) {
+		conn->rendering = true;
+		clock_gettime(drm->clock, &conn->render_start);
+	}
+	return true;
+}
+
+static void drm_connector_record_render_time(struct wlr_drm_connector *conn) {
+	struct wlr_drm_backend *drm =
+		get_drm_backend_from_backend(conn->output.backend);
+	if (!conn->rendering) {
+		return;
+	}
+	conn->rendering = false;
+
+	struct timespec now;
+	clock_gettime(drm->clock, &now);
+	int64_t render_time = timespec_to_nsec(&now) -
+		timespec_to_nsec(&conn->render_start);
+	if (render_time <= 0 || render_time > 1000000000) {
+		return;
+	}
+
+	conn->render_times[conn->render_times_idx] = render_time;
+	conn->render_times_idx =
+		(conn->render_times_idx + 1) % DRM_RENDER_TIME_HISTORY_LEN;
+}
+
+/**
+ * Makes the kernel wait for the rendering operations submitted so far with
+ * `egl` before scanning out the plane's next buffer, instead of relying on
+ * implicit synchronization or stalling the CPU. Returns false if explicit
+ * fences aren't supported.
+ */
+static bool drm_plane_attach_fence(struct wlr_drm_backend *drm,
+		struct wlr_drm_plane *plane, struct wlr_egl *egl) {
+	if (drm->iface != &atomic_iface || plane->props.in_fence_fd == 0) {
+		return false;
+	}
+
+	int fd = wlr_egl_create_fence(egl);
+	if (fd < 0) {
+		return false;
+	}
+
+	if (plane->in_fence_fd >= 0) {
+		close(plane->in_fence_fd);
+	}
+	plane->in_fence_fd = fd;
+	return true;
+}
+
+/**
+ * Returns a framebuffer the secondary GPU can scan out for a buffer rendered
+ * by the parent GPU. The buffer is imported directly if possible, otherwise
+ * the damaged region is copied into the plane's multi-GPU surface.
+ */
+static uint32_t get_fb_for_mgpu_bo(struct wlr_drm_backend *drm,
+		struct wlr_drm_plane *plane, struct gbm_bo *bo,
+		pixman_region32_t *damage) {
+	if (!plane->mgpu_copy) {
+		struct gbm_bo *imported = import_drm_bo_mgpu(&drm->renderer, bo);
+		if (imported != NULL) {
+			uint32_t fb_id = get_fb_for_bo(imported, plane->drm_format);
+			if (fb_id != 0) {
+				return fb_id;
+			}
+		}
+		wlr_log(WLR_INFO, "Cannot scan out buffers from the parent GPU "
+			"directly, falling back to copying");
+		plane->mgpu_copy = true;
+		// The multi-GPU surface hasn't been kept up to date
+		damage = NULL;
+	}
+
+	bo = copy_drm_surface_mgpu(&plane->mgpu_surf, bo, damage);
+	return get_fb_for_bo(bo, plane->drm_format);
 }
 
 static bool drm_connector_swap_buffers(struct wlr_output *output,
@@ -261,20 +365,41 @@ static bool drm_connector_swap_buffers(struct wlr_output *output,
 	struct wlr_drm_plane *plane = crtc->primary;
 
 	struct gbm_bo *bo = swap_drm_surface_buffers(&plane->surf, damage);
+	uint32_t fb_id;
 	if (drm->parent) {
-		bo = copy_drm_surface_mgpu(&plane->mgpu_surf, bo);
+		fb_id = get_fb_for_mgpu_bo(drm, plane, bo, damage);
+	} else {
+		fb_id = get_fb_for_bo(bo, plane->drm_format);
 	}
-	uint32_t fb_id = get_fb_for_bo(bo, plane->drm_format);
 
 	if (conn->pageflip_pending) {
 		wlr_log(WLR_ERROR, "Skipping pageflip on output '%s'", conn->output.name);
 		return false;
 	}
 
-	if (!drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, NULL)) {
+	// The last rendering operations happened on the secondary GPU if the
+	// buffer has been copied
+	struct wlr_drm_surface *last_surf = drm->parent && plane->mgpu_copy ?
+		&plane->mgpu_surf : &plane->surf;
+	drm_plane_attach_fence(drm, plane, &last_surf->renderer->egl);
+
+	bool ok = drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, NULL);
+	if (!ok && drm->parent && !plane->mgpu_copy) {
+		// Some drivers only reject foreign buffers at commit time
+		wlr_log(WLR_INFO, "Failed to scan out imported buffer on output '%s', "
+			"falling back to copying", conn->output.name);
+		plane->mgpu_copy = true;
+		fb_id = get_fb_for_mgpu_bo(drm, plane, bo, NULL);
+		drm_plane_attach_fence(drm, plane, &plane->mgpu_surf.renderer->egl);
+		ok = drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, NULL);
+	}
+	if (!ok) {
+		conn->rendering = false;
 		return false;
 	}
 
+	drm_connector_record_render_time(conn);
+
 	conn->pageflip_pending = true;
 	wlr_output_update_enabled(output, true);
 	return true;
@@ -293,7 +418,9 @@ static size_t drm_connector_get_gamma_size(struct wlr_output *output) {
 	struct wlr_drm_backend *drm = get_drm_backend_from_backend(output->backend);
 
 	if (conn->crtc) {
-		return drm->iface->crtc_get_gamma_size(drm, conn->crtc);
+		size_t size = drm->iface->crtc_get_gamma_size(drm, conn->crtc);
+		// Without hardware support, the renderer applies the gamma ramp
+		return size > 0 ? size : DRM_SHADER_GAMMA_SIZE;
 	}
 
 	return 0;
@@ -334,13 +461,48 @@ bool set_drm_connector_gamma(struct wlr_output *output, size_t size,
 		memcpy(_b, b, size * sizeof(uint16_t));
 	}
 
-	bool ok = drm->iface->crtc_set_gamma(drm, conn->crtc, size, _r, _g, _b);
-	if (ok) {
-		wlr_output_update_needs_swap(output);
+	struct wlr_drm_crtc *crtc = conn->crtc;
+	if (crtc->gamma_table != NULL && crtc->gamma_table_size == size &&
+			memcmp(crtc->gamma_table, gamma_table,
+				3 * size * sizeof(uint16_t)) == 0) {
+		// Night light tools tend to send the same ramp over and over
+		free(gamma_table);
+		return true;
+	}
 
-		free(conn->crtc->gamma_table);
-		conn->crtc->gamma_table = gamma_table;
-		conn->crtc->gamma_table_size = size;
+	bool ok = true;
+	bool shader_gamma = drm->iface->crtc_get_gamma_size(drm, crtc) == 0;
+	if (!shader_gamma) {
+		ok = drm->iface->crtc_set_gamma(drm, crtc, size, _r, _g, _b);
+	} else if (size != DRM_SHADER_GAMMA_SIZE) {
+		wlr_log(WLR_ERROR, "Invalid gamma table size for output '%s'",
+			output->name);
+		ok = false;
+	}
+	if (ok) {
+		if (shader_gamma && reset) {
+			// No need to apply an identity ramp while rendering
+			free(gamma_table);
+			gamma_table = NULL;
+			size = 0;
+		}
+		free(crtc->gamma_table);
+		crtc->gamma_table = gamma_table;
+		crtc->gamma_table_size = size;
+		crtc->shader_gamma = shader_gamma;
+
+		if (crtc->pending_gamma_lut != 0) {
+			// Applied with the next pageflip, make sure there is one. If a
+			// pageflip is pending, the frame event handler takes care of it.
+			if (!conn->pageflip_pending) {
+				wlr_output_schedule_frame(output);
+			}
+		} else if (shader_gamma) {
+			// The whole output needs to be rendered again with the new ramp
+			wlr_output_damage_whole(output);
+		} else {
+			wlr_output_update_needs_swap(output);
+		}
 	} else {
 		free(gamma_table);
 	}
@@ -366,6 +528,38 @@ static bool drm_connector_export_dmabuf(struct wlr_output *output,
 	return export_drm_bo(surf->back, attribs);
 }
 
+/**
+ * Returns whether the connector is still lit by the firmware or the boot
+ * splash with `mode` on the same CRTC. The first frame can then be a plain
+ * pageflip, which avoids the black screen caused by a modeset.
+ */
+static bool drm_connector_can_adopt_boot_mode(struct wlr_drm_connector *conn,
+		const drmModeModeInfo *mode) {
+	struct wlr_drm_backend *drm =
+		get_drm_backend_from_backend(conn->output.backend);
+	if (!conn->boot_mode_pending) {
+		return false;
+	}
+	// Only tried once, a failed pageflip falls back to a modeset
+	conn->boot_mode_pending = false;
+
+	struct wlr_drm_crtc *crtc = conn->crtc;
+	if (!drm->session->active || crtc == NULL ||
+			crtc->id != conn->old_crtc->crtc_id ||
+			!drm_mode_equal(&conn->old_crtc->mode, mode)) {
+		return false;
+	}
+
+	// Without a modeset, the atomic interface reuses the current mode blob
+	if (drm->iface == &atomic_iface && crtc->mode_id == 0 &&
+			drmModeCreatePropertyBlob(drm->fd, mode, sizeof(*mode),
+				&crtc->mode_id)) {
+		wlr_log_errno(WLR_ERROR, "Unable to create property blob");
+		return false;
+	}
+	return true;
+}
+
 static void drm_connector_start_renderer(struct wlr_drm_connector *conn) {
 	if (conn->state != WLR_DRM_CONN_CONNECTED) {
 		return;
@@ -386,6 +580,19 @@ static void drm_connector_start_renderer(struct wlr_drm_connector *conn) {
 	uint32_t fb_id = get_fb_for_bo(bo, plane->drm_format);
 
 	struct wlr_drm_mode *mode = (struct wlr_drm_mode *)conn->output.current_mode;
+	if (drm_connector_can_adopt_boot_mode(conn, &mode->drm_mode)) {
+		wlr_log(WLR_INFO, "Keeping the boot mode of output '%s'",
+			conn->output.name);
+		if (drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, NULL)) {
+			conn->adopting_boot_mode = true;
+			conn->pageflip_pending = true;
+			wlr_output_update_enabled(&conn->output, true);
+			return;
+		}
+		wlr_log(WLR_INFO, "Failed to keep the boot mode of output '%s', "
+			"falling back to a modeset", conn->output.name);
+	}
+
 	if (drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, &mode->drm_mode)) {
 		conn->pageflip_pending = true;
 		wlr_output_update_enabled(&conn->output, true);
@@ -395,6 +602,92 @@ static void drm_connector_start_renderer(struct wlr_drm_connector *conn) {
 	}
 }
 
+static bool drm_begin_batch(struct wlr_drm_backend *drm) {
+	if (drm->batching || drm->iface->commit_batch == NULL) {
+		return false;
+	}
+	drm->batching = true;
+	return true;
+}
+
+/**
+ * Commits the queued pageflips and modesets. If the batch is rejected, none of
+ * them is applied; with `retry` set, the modesets are then applied one by one
+ * instead.
+ */
+static bool drm_commit_batch(struct wlr_drm_backend *drm, bool retry) {
+	if (!drm->batching) {
+		return true;
+	}
+	drm->batching = false;
+
+	struct wlr_drm_connector *conns[drm->num_crtcs + 1];
+	bool modesets[drm->num_crtcs + 1];
+	size_t conns_len = 0;
+	for (size_t i = 0; i < drm->num_crtcs; ++i) {
+		struct wlr_drm_crtc *crtc = &drm->crtcs[i];
+		if (crtc->batch_conn != NULL) {
+			modesets[conns_len] = crtc->batch_mode_id != 0 ||
+				crtc->batch_conn->adopting_boot_mode;
+			conns[conns_len++] = crtc->batch_conn;
+		}
+	}
+
+	if (drm->iface->commit_batch(drm)) {
+		return true;
+	}
+
+	for (size_t i = 0; i < conns_len; ++i) {
+		conns[i]->pageflip_pending = false;
+		conns[i]->rendering = false;
+		conns[i]->adopting_boot_mode = false;
+		// No frame event will come for the rejected buffer swap, the output
+		// needs to be rendered again
+		conns[i]->output.frame_pending = false;
+		wlr_output_damage_whole(&conns[i]->output);
+	}
+	if (retry) {
+		for (size_t i = 0; i < conns_len; ++i) {
+			if (modesets[i]) {
+				drm_connector_start_renderer(conns[i]);
+			}
+		}
+	}
+	return false;
+}
+
+static void backend_begin_batch(struct wlr_backend *backend, void *data) {
+	if (wlr_backend_is_drm(backend)) {
+		drm_begin_batch(get_drm_backend_from_backend(backend));
+	}
+}
+
+void wlr_drm_backend_begin_batch(struct wlr_backend *backend) {
+	if (wlr_backend_is_multi(backend)) {
+		wlr_multi_for_each_backend(backend, backend_begin_batch, NULL);
+	} else {
+		backend_begin_batch(backend, NULL);
+	}
+}
+
+static void backend_commit_batch(struct wlr_backend *backend, void *data) {
+	bool *ok = data;
+	if (wlr_backend_is_drm(backend) &&
+			!drm_commit_batch(get_drm_backend_from_backend(backend), false)) {
+		*ok = false;
+	}
+}
+
+bool wlr_drm_backend_commit_batch(struct wlr_backend *backend) {
+	bool ok = true;
+	if (wlr_backend_is_multi(backend)) {
+		wlr_multi_for_each_backend(backend, backend_commit_batch, &ok);
+	} else {
+		backend_commit_batch(backend, &ok);
+	}
+	return ok;
+}
+
 static void realloc_crtcs(struct wlr_drm_backend *drm, bool *changed_outputs);
 
 static void attempt_enable_needs_modeset(struct wlr_drm_backend *drm) {
@@ -422,26 +715,31 @@ bool enable_drm_connector(struct wlr_output *output, bool enable) {
 
 	conn->desired_enabled = enable;
 
+	// The connector is updated with direct commits, apply the queued changes
+	// first so that they don't end up in them, and resume batching afterwards
+	bool batching = drm->batching;
+	drm_commit_batch(drm, true);
+
 	if (enable && conn->crtc == NULL) {
 		// Maybe we can steal a CRTC from a disabled output
 		realloc_crtcs(drm, NULL);
 	}
 
 	bool ok = drm->iface->conn_enable(drm, conn, enable);
-	if (!ok) {
-		return false;
-	}
+	if (ok) {
+		if (enable) {
+			drm_connector_start_renderer(conn);
+		} else {
+			realloc_crtcs(drm, NULL);
 
-	if (enable) {
-		drm_connector_start_renderer(conn);
-	} else {
-		realloc_crtcs(drm, NULL);
+			attempt_enable_needs_modeset(drm);
+		}
 
-		attempt_enable_needs_modeset(drm);
+		wlr_output_update_enabled(&conn->output, enable);
 	}
 
-	wlr_output_update_enabled(&conn->output, enable);
-	return true;
+	drm->batching = batching;
+	return ok;
 }
 
 static ssize_t connector_index_from_crtc(struct wlr_drm_backend *drm,
@@ -601,6 +899,60 @@ static void drm_connector_transform(struct wlr_output *output,
 	output->transform = transform;
 }
 
+static void drm_connector_flush_cursor(struct wlr_drm_connector *conn) {
+	struct wlr_drm_backend *drm =
+		get_drm_backend_from_backend(conn->output.backend);
+	if (!conn->cursor_dirty || conn->crtc == NULL || !drm->session->active) {
+		return;
+	}
+	conn->cursor_dirty = false;
+	if (!drm->iface->crtc_move_cursor(drm, conn->crtc, conn->cursor_x,
+			conn->cursor_y)) {
+		wlr_log(WLR_ERROR, "%s: Failed to move cursor", conn->output.name);
+	}
+}
+
+/**
+ * Cursor moves are applied at most once per vblank: the position is committed
+ * along with the next pageflip if there's one in flight, otherwise it's
+ * applied on its own when the next vblank event is received. Moving the
+ * cursor doesn't require rendering a new frame.
+ *
+ * The position isn't applied on its own while a frame is about to be
+ * rendered: a cursor-only atomic commit would make the next pageflip fail
+ * with EBUSY. The frame carries the position instead, and the cursor is only
+ * staged again if the compositor doesn't render, see drm_connector_send_frame.
+ */
+static void drm_connector_stage_cursor(struct wlr_drm_connector *conn) {
+	struct wlr_drm_backend *drm =
+		get_drm_backend_from_backend(conn->output.backend);
+	conn->cursor_dirty = true;
+	if (!drm->session->active) {
+		return; // will be committed when session is resumed
+	}
+	if (conn->pageflip_pending || conn->cursor_vblank_pending) {
+		return; // will be committed by the event handler
+	}
+
+	uint32_t pipe = conn->crtc - drm->crtcs;
+	drmVBlank vbl = {
+		.request = {
+			.type = DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT |
+				((pipe << DRM_VBLANK_HIGH_CRTC_SHIFT) &
+				DRM_VBLANK_HIGH_CRTC_MASK),
+			.sequence = 1,
+			.signal = (unsigned long)conn,
+		},
+	};
+	if (drmWaitVBlank(drm->fd, &vbl) != 0) {
+		wlr_log_errno(WLR_DEBUG, "%s: Failed to request vblank event",
+			conn->output.name);
+		drm_connector_flush_cursor(conn);
+		return;
+	}
+	conn->cursor_vblank_pending = true;
+}
+
 static bool drm_connector_set_cursor(struct wlr_output *output,
 		struct wlr_texture *texture, int32_t scale,
 		enum wl_output_transform transform,
@@ -621,6 +973,7 @@ static bool drm_connector_set_cursor(struct wlr_output *output,
 			wlr_log_errno(WLR_ERROR, "Allocation failed");
 			return false;
 		}
+		plane->in_fence_fd = -1;
 		crtc->cursor = plane;
 	}
 
@@ -670,12 +1023,7 @@ static bool drm_connector_set_cursor(struct wlr_output *output,
 		plane->cursor_hotspot_x = hotspot.x;
 		plane->cursor_hotspot_y = hotspot.y;
 
-		if (!drm->iface->crtc_move_cursor(drm, conn->crtc, conn->cursor_x,
-				conn->cursor_y)) {
-			return false;
-		}
-
-		wlr_output_update_needs_swap(output);
+		drm_connector_stage_cursor(conn);
 	}
 
 	if (!update_texture) {
@@ -705,6 +1053,9 @@ static bool drm_connector_set_cursor(struct wlr_output *output,
 		float matrix[9];
 		wlr_matrix_project_box(matrix, &cursor_box, transform, 0, plane->matrix);
 
+		// The cursor plane isn't affected by the gamma ramp of the primary
+		// plane's render pass
+		drm_crtc_set_render_gamma(crtc, rend);
 		wlr_renderer_begin(rend, plane->surf.width, plane->surf.height);
 		wlr_renderer_clear(rend, (float[]){ 0.0, 0.0, 0.0, 0.0 });
 		wlr_render_texture_with_matrix(rend, texture, matrix, 1.0);
@@ -721,16 +1072,18 @@ static bool drm_connector_set_cursor(struct wlr_output *output,
 
 	struct gbm_bo *bo = plane->cursor_enabled ? plane->surf.back : NULL;
 	if (bo && drm->parent) {
-		bo = copy_drm_surface_mgpu(&plane->mgpu_surf, bo);
+		bo = copy_drm_surface_mgpu(&plane->mgpu_surf, bo, NULL);
 	}
 
-	if (bo) {
+	struct wlr_egl *egl = drm->parent ?
+		&plane->mgpu_surf.renderer->egl : &plane->surf.renderer->egl;
+	if (bo && !drm_plane_attach_fence(drm, plane, egl)) {
 		// workaround for nouveau
 		// Buffers created with GBM_BO_USER_LINEAR are placed in NOUVEAU_GEM_DOMAIN_GART.
 		// When the bo is attached to the cursor plane it is moved to NOUVEAU_GEM_DOMAIN_VRAM.
 		// However, this does not wait for the render operations to complete, leaving an empty surface.
 		// see https://bugs.freedesktop.org/show_bug.cgi?id=109631
-		// The render operations can be waited for using:
+		// Without an explicit fence, the render operations can be waited for using:
 		glFinish();
 	}
 	bool ok = drm->iface->crtc_set_cursor(drm, crtc, bo);
@@ -743,7 +1096,6 @@ static bool drm_connector_set_cursor(struct wlr_output *output,
 static bool drm_connector_move_cursor(struct wlr_output *output,
 		int x, int y) {
 	struct wlr_drm_connector *conn = get_drm_connector_from_output(output);
-	struct wlr_drm_backend *drm = get_drm_backend_from_backend(output->backend);
 	if (!conn->crtc) {
 		return false;
 	}
@@ -766,17 +1118,30 @@ static bool drm_connector_move_cursor(struct wlr_output *output,
 	conn->cursor_x = box.x;
 	conn->cursor_y = box.y;
 
-	if (!drm->session->active) {
-		return true; // will be committed when session is resumed
+	drm_connector_stage_cursor(conn);
+	return true;
+}
+
+static bool drm_connector_set_adaptive_sync(struct wlr_output *output,
+		bool enabled) {
+	struct wlr_drm_connector *conn = get_drm_connector_from_output(output);
+	struct wlr_drm_backend *drm = get_drm_backend_from_backend(output->backend);
+	if (conn->crtc == NULL) {
+		return false;
 	}
 
-	bool ok = drm->iface->crtc_move_cursor(drm, conn->crtc, box.x, box.y);
-	if (ok) {
-		wlr_output_update_needs_swap(output);
+	if (!drm->iface->crtc_set_vrr(drm, conn->crtc, enabled)) {
+		wlr_log(WLR_ERROR, "Failed to %s adaptive sync on '%s'",
+			enabled ? "enable" : "disable", conn->output.name);
+		return false;
 	}
-	return ok;
+	wlr_log(WLR_DEBUG, "Adaptive sync %s on '%s'",
+		enabled ? "enabled" : "disabled", conn->output.name);
+	return true;
 }
 
+static void drm_connector_send_frame(struct wlr_drm_connector *conn);
+
 static bool drm_connector_schedule_frame(struct wlr_output *output) {
 	struct wlr_drm_connector *conn = get_drm_connector_from_output(output);
 	struct wlr_drm_backend *drm = get_drm_backend_from_backend(output->backend);
@@ -798,17 +1163,30 @@ static bool drm_connector_schedule_frame(struct wlr_output *output) {
 		wlr_output_send_frame(output);
 		return true;
 	}
-	if (drm->parent) {
-		bo = copy_drm_surface_mgpu(&plane->mgpu_surf, bo);
+	if (output->adaptive_sync_enabled && !conn->pageflip_pending &&
+			crtc->pending_gamma_lut == 0) {
+		// With adaptive sync the display waits for the next frame, so there
+		// is no vblank to synchronize to: let the content drive the timing.
+		// The frame has already been sent, no other one is pending. A gamma
+		// LUT waiting for a pageflip goes through the pageflip below.
+		drm_connector_send_frame(conn);
+		return false;
 	}
-
 	if (conn->pageflip_pending) {
 		wlr_log(WLR_ERROR, "Skipping pageflip on output '%s'",
 			conn->output.name);
 		return true;
 	}
 
-	uint32_t fb_id = get_fb_for_bo(bo, plane->drm_format);
+	uint32_t fb_id;
+	if (drm->parent && plane->mgpu_copy && plane->mgpu_surf.back) {
+		// The last copy is still up to date
+		fb_id = get_fb_for_bo(plane->mgpu_surf.back, plane->drm_format);
+	} else if (drm->parent) {
+		fb_id = get_fb_for_mgpu_bo(drm, plane, bo, NULL);
+	} else {
+		fb_id = get_fb_for_bo(bo, plane->drm_format);
+	}
 	if (!drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, NULL)) {
 		return false;
 	}
@@ -823,6 +1201,9 @@ static void drm_connector_destroy(struct wlr_output *output) {
 	drm_connector_cleanup(conn);
 	drmModeFreeCrtc(conn->old_crtc);
 	wl_event_source_remove(conn->retry_pageflip);
+	if (conn->frame_timer != NULL) {
+		wl_event_source_remove(conn->frame_timer);
+	}
 	wl_list_remove(&conn->link);
 	free(conn);
 }
@@ -840,6 +1221,7 @@ static const struct wlr_output_impl output_impl = {
 	.get_gamma_size = drm_connector_get_gamma_size,
 	.export_dmabuf = drm_connector_export_dmabuf,
 	.schedule_frame = drm_connector_schedule_frame,
+	.set_adaptive_sync = drm_connector_set_adaptive_sync,
 };
 
 bool wlr_output_is_drm(struct wlr_output *output) {
@@ -853,6 +1235,37 @@ static int retry_pageflip(void *data) {
 	return 0;
 }
 
+static void drm_connector_send_frame(struct wlr_drm_connector *conn) {
+	// Render times are measured from the first make_current after the frame
+	// event, drop a make_current which wasn't followed by a buffer swap
+	conn->rendering = false;
+	wlr_output_send_frame(&conn->output);
+
+	// The compositor didn't render, the cursor can't wait for a pageflip
+	if (conn->cursor_dirty && !conn->pageflip_pending) {
+		drm_connector_stage_cursor(conn);
+	}
+
+	// A gamma LUT is waiting for a pageflip, but the compositor didn't render
+	struct wlr_drm_crtc *crtc = conn->crtc;
+	if (crtc != NULL && crtc->pending_gamma_lut != 0 &&
+			!conn->pageflip_pending) {
+		wlr_output_schedule_frame(&conn->output);
+	}
+}
+
+static int frame_timer_handler(void *data) {
+	struct wlr_drm_connector *conn = data;
+	struct wlr_drm_backend *drm =
+		get_drm_backend_from_backend(conn->output.backend);
+
+	if (conn->state == WLR_DRM_CONN_CONNECTED && drm->session->active &&
+			!conn->pageflip_pending) {
+		drm_connector_send_frame(conn);
+	}
+	return 0;
+}
+
 static const int32_t subpixel_map[] = {
 	[DRM_MODE_SUBPIXEL_UNKNOWN] = WL_OUTPUT_SUBPIXEL_UNKNOWN,
 	[DRM_MODE_SUBPIXEL_HORIZONTAL_RGB] = WL_OUTPUT_SUBPIXEL_HORIZONTAL_RGB,
@@ -872,7 +1285,28 @@ static void dealloc_crtc(struct wlr_drm_connector *conn) {
 	wlr_log(WLR_DEBUG, "De-allocating CRTC %zu for output '%s'",
 		conn->crtc - drm->crtcs, conn->output.name);
 
+	struct wlr_drm_crtc *crtc = conn->crtc;
+	if (crtc->batch_conn != NULL) {
+		// Drop the pageflip queued in the current batch
+		drmModeAtomicSetCursor(crtc->atomic, crtc->batch_cursor);
+		if (crtc->batch_mode_id != 0) {
+			drmModeDestroyPropertyBlob(drm->fd, crtc->batch_mode_id);
+		}
+		if (crtc->batch_gamma_lut != 0 &&
+				crtc->batch_gamma_lut != crtc->pending_gamma_lut) {
+			drmModeDestroyPropertyBlob(drm->fd, crtc->batch_gamma_lut);
+		}
+		crtc->batch_conn->pageflip_pending = false;
+		crtc->batch_conn = NULL;
+		crtc->batch_mode_id = 0;
+		crtc->batch_gamma_lut = 0;
+	}
+
 	set_drm_connector_gamma(&conn->output, 0, NULL, NULL, NULL);
+	if (conn->output.adaptive_sync_enabled) {
+		drm->iface->crtc_set_vrr(drm, conn->crtc, false);
+		conn->output.adaptive_sync_enabled = false;
+	}
 
 	for (size_t type = 0; type < 3; ++type) {
 		struct wlr_drm_plane *plane = conn->crtc->planes[type];
@@ -881,6 +1315,10 @@ static void dealloc_crtc(struct wlr_drm_connector *conn) {
 		}
 
 		finish_drm_surface(&plane->surf);
+		if (plane->in_fence_fd >= 0) {
+			close(plane->in_fence_fd);
+			plane->in_fence_fd = -1;
+		}
 		conn->crtc->planes[type] = NULL;
 	}
 
@@ -909,6 +1347,8 @@ static void realloc_crtcs(struct wlr_drm_backend *drm, bool *changed_outputs) {
 	}
 
 	struct wlr_drm_connector *connectors[num_outputs + 1];
+	// Adaptive sync is disabled along with the old CRTC, see dealloc_crtc
+	bool adaptive_sync[num_outputs + 1];
 
 	uint32_t possible_crtc[num_outputs + 1];
 	memset(possible_crtc, 0, sizeof(possible_crtc));
@@ -919,6 +1359,7 @@ static void realloc_crtcs(struct wlr_drm_backend *drm, bool *changed_outputs) {
 	wl_list_for_each(conn, &drm->outputs, link) {
 		i++;
 		connectors[i] = conn;
+		adaptive_sync[i] = conn->output.adaptive_sync_enabled;
 
 		wlr_log(WLR_DEBUG, "  '%s' crtc=%d state=%d desired_enabled=%d",
 			conn->output.name,
@@ -981,6 +1422,11 @@ static void realloc_crtcs(struct wlr_drm_backend *drm, bool *changed_outputs) {
 
 			wlr_log(WLR_DEBUG, "Assigning CRTC %zu to output %d -> %d '%s'",
 				i, crtc[i], crtc_res[i], conn->output.name);
+
+			if (adaptive_sync[crtc_res[i]]) {
+				conn->output.adaptive_sync_enabled =
+					drm->iface->crtc_set_vrr(drm, conn->crtc, true);
+			}
 		}
 	}
 
@@ -994,6 +1440,9 @@ static void realloc_crtcs(struct wlr_drm_backend *drm, bool *changed_outputs) {
 
 	realloc_planes(drm, crtc_res, changed_outputs);
 
+	// Modeset all changed outputs at once
+	bool batch = drm_begin_batch(drm);
+
 	// We need to reinitialize any plane that has changed
 	i = -1;
 	wl_list_for_each(conn, &drm->outputs, link) {
@@ -1026,6 +1475,10 @@ static void realloc_crtcs(struct wlr_drm_backend *drm, bool *changed_outputs) {
 		wlr_output_damage_whole(&conn->output);
 	}
 
+	if (batch) {
+		drm_commit_batch(drm, true);
+	}
+
 free_changed_outputs:
 	if (changed_local) {
 		free(changed_outputs);
@@ -1071,8 +1524,35 @@ static uint32_t get_possible_crtcs(int fd, drmModeRes *res,
 	return ret;
 }
 
-void scan_drm_connectors(struct wlr_drm_backend *drm) {
-	wlr_log(WLR_INFO, "Scanning DRM connectors");
+/**
+ * Probing a connector is slow, since the kernel reads the EDID of the monitor
+ * again. When the kernel has already probed the connectors, their current
+ * state can be used instead, except to read the modes of a newly connected
+ * monitor.
+ */
+static drmModeConnector *get_drm_connector(struct wlr_drm_backend *drm,
+		uint32_t id, struct wlr_drm_connector *wlr_conn, bool probe) {
+	if (!probe) {
+		drmModeConnector *drm_conn = drmModeGetConnectorCurrent(drm->fd, id);
+		bool newly_connected = drm_conn != NULL &&
+			drm_conn->connection == DRM_MODE_CONNECTED &&
+			(wlr_conn == NULL || wlr_conn->state == WLR_DRM_CONN_DISCONNECTED);
+		if (!newly_connected) {
+			return drm_conn;
+		}
+		drmModeFreeConnector(drm_conn);
+	}
+	return drmModeGetConnector(drm->fd, id);
+}
+
+void scan_drm_connectors(struct wlr_drm_backend *drm,
+		struct wlr_device_hotplug_event *event) {
+	uint32_t changed_id = event != NULL ? event->connector_id : 0;
+	if (changed_id != 0) {
+		wlr_log(WLR_INFO, "Scanning DRM connector %"PRIu32, changed_id);
+	} else {
+		wlr_log(WLR_INFO, "Scanning DRM connectors");
+	}
 
 	drmModeRes *res = drmModeGetResources(drm->fd);
 	if (!res) {
@@ -1089,25 +1569,35 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 	struct wlr_drm_connector *new_outputs[res->count_connectors + 1];
 
 	for (int i = 0; i < res->count_connectors; ++i) {
-		drmModeConnector *drm_conn = drmModeGetConnector(drm->fd,
-			res->connectors[i]);
-		if (!drm_conn) {
-			wlr_log_errno(WLR_ERROR, "Failed to get DRM connector");
-			continue;
-		}
-		drmModeEncoder *curr_enc = drmModeGetEncoder(drm->fd,
-			drm_conn->encoder_id);
+		uint32_t conn_id = res->connectors[i];
 
 		ssize_t index = -1;
 		struct wlr_drm_connector *c, *wlr_conn = NULL;
 		wl_list_for_each(c, &drm->outputs, link) {
 			index++;
-			if (c->id == drm_conn->connector_id) {
+			if (c->id == conn_id) {
 				wlr_conn = c;
 				break;
 			}
 		}
 
+		if (wlr_conn != NULL && changed_id != 0 && conn_id != changed_id) {
+			seen[index] = true;
+			continue;
+		}
+
+		drmModeConnector *drm_conn =
+			get_drm_connector(drm, conn_id, wlr_conn, event == NULL);
+		if (!drm_conn) {
+			wlr_log_errno(WLR_ERROR, "Failed to get DRM connector");
+			if (wlr_conn != NULL) {
+				seen[index] = true;
+			}
+			continue;
+		}
+		drmModeEncoder *curr_enc = drmModeGetEncoder(drm->fd,
+			drm_conn->encoder_id);
+
 		if (!wlr_conn) {
 			wlr_conn = calloc(1, sizeof(*wlr_conn));
 			if (!wlr_conn) {
@@ -1122,10 +1612,17 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 			struct wl_event_loop *ev = wl_display_get_event_loop(drm->display);
 			wlr_conn->retry_pageflip = wl_event_loop_add_timer(ev, retry_pageflip,
 				wlr_conn);
+			if (drm->frame_margin_ns >= 0) {
+				wlr_conn->frame_timer = wl_event_loop_add_timer(ev,
+					frame_timer_handler, wlr_conn);
+			}
 
 			wlr_conn->state = WLR_DRM_CONN_DISCONNECTED;
 			wlr_conn->id = drm_conn->connector_id;
 
+			// Property IDs don't change during the connector's lifetime
+			get_drm_connector_props(drm->fd, wlr_conn->id, &wlr_conn->props);
+
 			snprintf(wlr_conn->output.name, sizeof(wlr_conn->output.name),
 				"%s-%"PRIu32, conn_get_name(drm_conn->connector_type),
 				drm_conn->connector_type_id);
@@ -1133,6 +1630,11 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 			if (curr_enc) {
 				wlr_conn->old_crtc = drmModeGetCrtc(drm->fd, curr_enc->crtc_id);
 			}
+			wlr_conn->boot_mode_pending = drm->adopt_boot_mode &&
+				wlr_conn->old_crtc != NULL && wlr_conn->old_crtc->mode_valid &&
+				wlr_conn->old_crtc->buffer_id != 0;
+			// Only the time to first frame after startup is logged
+			wlr_conn->first_frame_presented = event != NULL;
 
 			wl_list_insert(drm->outputs.prev, &wlr_conn->link);
 			wlr_log(WLR_INFO, "Found connector '%s'", wlr_conn->output.name);
@@ -1151,9 +1653,8 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 			wlr_conn->crtc = NULL;
 		}
 
-		// This can only happen *after* hotplug, since we haven't read the
-		// connector properties yet
-		if (wlr_conn->props.link_status != 0) {
+		if (wlr_conn->props.link_status != 0 &&
+				wlr_conn->state != WLR_DRM_CONN_DISCONNECTED) {
 			uint64_t link_status;
 			if (!get_drm_prop(drm->fd, wlr_conn->id,
 					wlr_conn->props.link_status, &link_status)) {
@@ -1181,14 +1682,21 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 				wlr_conn->output.phys_width, wlr_conn->output.phys_height);
 			wlr_conn->output.subpixel = subpixel_map[drm_conn->subpixel];
 
-			get_drm_connector_props(drm->fd, wlr_conn->id, &wlr_conn->props);
-
 			size_t edid_len = 0;
 			uint8_t *edid = get_drm_prop_blob(drm->fd,
 				wlr_conn->id, wlr_conn->props.edid, &edid_len);
 			parse_edid(&wlr_conn->output, edid_len, edid);
 			free(edid);
 
+			uint64_t vrr_capable = 0;
+			if (wlr_conn->props.vrr_capable != 0) {
+				get_drm_prop(drm->fd, wlr_conn->id, wlr_conn->props.vrr_capable,
+					&vrr_capable);
+			}
+			wlr_conn->output.adaptive_sync_capable = vrr_capable;
+			wlr_log(WLR_INFO, "Adaptive sync: %s",
+				vrr_capable ? "supported" : "unsupported");
+
 			wlr_log(WLR_INFO, "Detected modes:");
 
 			for (int i = 0; i < drm_conn->count_modes; ++i) {
@@ -1257,7 +1765,7 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 		wlr_log(WLR_INFO, "'%s' disappeared", conn->output.name);
 		drm_connector_cleanup(conn);
 
-		if (conn->pageflip_pending) {
+		if (conn->pageflip_pending || conn->cursor_vblank_pending) {
 			conn->state = WLR_DRM_CONN_DISAPPEARED;
 		} else {
 			wlr_output_destroy(&conn->output);
@@ -1282,6 +1790,10 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 		changed_outputs[pos] = true;
 	}
 
+	// Apply the modesets of all new outputs at once, instead of one after
+	// the other
+	bool batch = drm_begin_batch(drm);
+
 	realloc_crtcs(drm, changed_outputs);
 
 	for (size_t i = 0; i < new_outputs_len; ++i) {
@@ -1294,22 +1806,81 @@ void scan_drm_connectors(struct wlr_drm_backend *drm) {
 	}
 
 	attempt_enable_needs_modeset(drm);
+
+	if (batch) {
+		drm_commit_batch(drm, true);
+	}
 }
 
 static int mhz_to_nsec(int mhz) {
 	return 1000000000000LL / mhz;
 }
 
+/**
+ * Sends the frame event of the vblank which happened at `vblank` as late as
+ * possible: the compositor should be done rendering right before the next
+ * vblank, minus the safety margin. The render time is predicted from the
+ * slowest of the recent frames.
+ */
+static void drm_connector_schedule_frame_event(struct wlr_drm_connector *conn,
+		const struct timespec *vblank) {
+	struct wlr_drm_backend *drm =
+		get_drm_backend_from_backend(conn->output.backend);
+
+	int64_t predicted = 0;
+	for (size_t i = 0; i < DRM_RENDER_TIME_HISTORY_LEN; ++i) {
+		if (conn->render_times[i] > predicted) {
+			predicted = conn->render_times[i];
+		}
+	}
+
+	// With adaptive sync, the next refresh happens when we submit a frame
+	if (drm->frame_margin_ns < 0 || conn->output.refresh <= 0 ||
+			conn->output.adaptive_sync_enabled || predicted == 0 ||
+			conn->frame_timer == NULL) {
+		drm_connector_send_frame(conn);
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(drm->clock, &now);
+
+	int64_t deadline = timespec_to_nsec(vblank) +
+		mhz_to_nsec(conn->output.refresh) - predicted - drm->frame_margin_ns;
+	int64_t delay_ms = (deadline - timespec_to_nsec(&now)) / 1000000;
+	if (delay_ms <= 0) {
+		drm_connector_send_frame(conn);
+		return;
+	}
+
+	wl_event_source_timer_update(conn->frame_timer, delay_ms);
+}
+
 static void page_flip_handler(int fd, unsigned seq,
-		unsigned tv_sec, unsigned tv_usec, void *data) {
+		unsigned tv_sec, unsigned tv_usec, unsigned crtc_id, void *data) {
 	struct wlr_drm_connector *conn = data;
 	struct wlr_drm_backend *drm =
 		get_drm_backend_from_backend(conn->output.backend);
 
+	if (conn->crtc != NULL && conn->crtc->id != crtc_id) {
+		// Batched commits send one event per CRTC, all with the same user data
+		struct wlr_drm_connector *c;
+		wl_list_for_each(c, &drm->outputs, link) {
+			if (c->crtc != NULL && c->crtc->id == crtc_id) {
+				conn = c;
+				break;
+			}
+		}
+	}
+
 	conn->pageflip_pending = false;
+	bool adopted_boot_mode = conn->adopting_boot_mode;
+	conn->adopting_boot_mode = false;
 
 	if (conn->state == WLR_DRM_CONN_DISAPPEARED) {
-		wlr_output_destroy(&conn->output);
+		if (!conn->cursor_vblank_pending) {
+			wlr_output_destroy(&conn->output);
+		}
 		return;
 	}
 
@@ -1317,6 +1888,19 @@ static void page_flip_handler(int fd, unsigned seq,
 		return;
 	}
 
+	if (!conn->first_frame_presented) {
+		conn->first_frame_presented = true;
+		struct timespec now;
+		clock_gettime(drm->clock, &now);
+		wlr_log(WLR_INFO, "First frame on output '%s' after %"PRId64" ms (%s)",
+			conn->output.name, (timespec_to_nsec(&now) -
+			timespec_to_nsec(&drm->start_time)) / 1000000,
+			adopted_boot_mode ? "boot mode kept" : "modeset");
+	}
+
+	// Cursor moves received while the pageflip was in flight are committed
+	// along with the next frame, see drm_connector_stage_cursor
+
 	post_drm_surface(&conn->crtc->primary->surf);
 	if (drm->parent) {
 		post_drm_surface(&conn->crtc->primary->mgpu_surf);
@@ -1329,21 +1913,46 @@ static void page_flip_handler(int fd, unsigned seq,
 	struct wlr_output_event_present present_event = {
 		.when = &present_time,
 		.seq = seq,
-		.refresh = mhz_to_nsec(conn->output.refresh),
+		// With adaptive sync the refresh interval varies
+		.refresh = conn->output.adaptive_sync_enabled ?
+			0 : mhz_to_nsec(conn->output.refresh),
 		.flags = WLR_OUTPUT_PRESENT_VSYNC | WLR_OUTPUT_PRESENT_HW_CLOCK |
 			WLR_OUTPUT_PRESENT_HW_COMPLETION,
 	};
 	wlr_output_send_present(&conn->output, &present_event);
 
 	if (drm->session->active) {
-		wlr_output_send_frame(&conn->output);
+		drm_connector_schedule_frame_event(conn, &present_time);
+	}
+}
+
+static void vblank_handler(int fd, unsigned seq,
+		unsigned tv_sec, unsigned tv_usec, void *data) {
+	struct wlr_drm_connector *conn = data;
+	conn->cursor_vblank_pending = false;
+
+	if (conn->state == WLR_DRM_CONN_DISAPPEARED) {
+		if (!conn->pageflip_pending) {
+			wlr_output_destroy(&conn->output);
+		}
+		return;
+	}
+
+	if (conn->state != WLR_DRM_CONN_CONNECTED || conn->crtc == NULL) {
+		return;
+	}
+
+	if (conn->pageflip_pending) {
+		return; // the position is committed along with the pageflip
 	}
+	drm_connector_flush_cursor(conn);
 }
 
 int handle_drm_event(int fd, uint32_t mask, void *data) {
 	drmEventContext event = {
-		.version = 2,
-		.page_flip_handler = page_flip_handler,
+		.version = 3,
+		.vblank_handler = vblank_handler,
+		.page_flip_handler2 = page_flip_handler,
 	};
 
 	drmHandleEvent(fd, &event);
@@ -1424,6 +2033,7 @@ static void drm_connector_cleanup(struct wlr_drm_connector *conn) {
 
 		conn->output.enabled = false;
 		conn->output.width = conn->output.height = conn->output.refresh = 0;
+		conn->output.adaptive_sync_capable = false;
 
 		memset(&conn->output.make, 0, sizeof(conn->output.make));
 		memset(&conn->output.model, 0, sizeof(conn->output.model));
@@ -1452,4 +2062,6 @@ static void drm_connector_cleanup(struct wlr_drm_connector *conn) {
 	}
 
 	conn->state = WLR_DRM_CONN_DISCONNECTED;
+	conn->boot_mode_pending = false;
+	conn->adopting_boot_mode = false;
 }
@@ -1,4 +1,5 @@
 #include <gbm.h>
+#include <inttypes.h>
 #include <wlr/util/log.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -17,6 +18,12 @@ static bool legacy_crtc_pageflip(struct wlr_drm_backend *drm,
 		}
 	}
 
+	// The legacy cursor ioctl doesn't wait for the pageflip
+	if (conn->cursor_dirty && crtc->cursor != NULL) {
+		conn->cursor_dirty = drmModeMoveCursor(drm->fd, crtc->id,
+			conn->cursor_x, conn->cursor_y) != 0;
+	}
+
 	if (drmModePageFlip(drm->fd, crtc->id, fb_id, DRM_MODE_PAGE_FLIP_EVENT, conn)) {
 		wlr_log_errno(WLR_ERROR, "%s: Failed to page flip", conn->output.name);
 		return false;
@@ -73,6 +80,21 @@ size_t legacy_crtc_get_gamma_size(struct wlr_drm_backend *drm,
 	return (size_t)crtc->legacy_crtc->gamma_size;
 }
 
+static bool legacy_crtc_set_vrr(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, bool enabled) {
+	if (crtc->props.vrr_enabled == 0) {
+		return !enabled;
+	}
+
+	if (drmModeObjectSetProperty(drm->fd, crtc->id, DRM_MODE_OBJECT_CRTC,
+			crtc->props.vrr_enabled, enabled)) {
+		wlr_log_errno(WLR_ERROR, "Failed to set VRR_ENABLED on CRTC %"PRIu32,
+			crtc->id);
+		return false;
+	}
+	return true;
+}
+
 const struct wlr_drm_interface legacy_iface = {
 	.conn_enable = legacy_conn_enable,
 	.crtc_pageflip = legacy_crtc_pageflip,
@@ -80,4 +102,5 @@ const struct wlr_drm_interface legacy_iface = {
 	.crtc_move_cursor = legacy_crtc_move_cursor,
 	.crtc_set_gamma = legacy_crtc_set_gamma,
 	.crtc_get_gamma_size = legacy_crtc_get_gamma_size,
+	.crtc_set_vrr = legacy_crtc_set_vrr,
 };
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <drm_fourcc.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <gbm.h>
@@ -9,6 +10,7 @@
 #include <wlr/render/egl.h>
 #include <wlr/render/gles2.h>
 #include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/util/log.h>
 #include "backend/drm/drm.h"
@@ -68,9 +70,17 @@ bool init_drm_surface(struct wlr_drm_surface *surf,
 		return true;
 	}
 
+	if (!surf->renderer) {
+		// First setup, the surface has been zeroed
+		for (size_t i = 0; i < DRM_SURFACE_DAMAGE_HISTORY_LEN; ++i) {
+			pixman_region32_init(&surf->damage_history[i]);
+		}
+	}
+
 	surf->renderer = renderer;
 	surf->width = width;
 	surf->height = height;
+	surf->damage_history_len = 0;
 
 	if (surf->gbm) {
 		if (surf->front) {
@@ -103,6 +113,9 @@ bool init_drm_surface(struct wlr_drm_surface *surf,
 error_gbm:
 	gbm_surface_destroy(surf->gbm);
 error_zero:
+	for (size_t i = 0; i < DRM_SURFACE_DAMAGE_HISTORY_LEN; ++i) {
+		pixman_region32_fini(&surf->damage_history[i]);
+	}
 	memset(surf, 0, sizeof(*surf));
 	return false;
 }
@@ -124,6 +137,10 @@ void finish_drm_surface(struct wlr_drm_surface *surf) {
 		gbm_surface_destroy(surf->gbm);
 	}
 
+	for (size_t i = 0; i < DRM_SURFACE_DAMAGE_HISTORY_LEN; ++i) {
+		pixman_region32_fini(&surf->damage_history[i]);
+	}
+
 	memset(surf, 0, sizeof(*surf));
 }
 
@@ -152,9 +169,11 @@ struct gbm_bo *get_drm_surface_front(struct wlr_drm_surface *surf) {
 
 	make_drm_surface_current(surf, NULL);
 	struct wlr_renderer *renderer = surf->renderer->wlr_rend;
+	wlr_renderer_set_gamma(renderer, 0, NULL, NULL, NULL);
 	wlr_renderer_begin(renderer, surf->width, surf->height);
 	wlr_renderer_clear(renderer, (float[]){ 0.0, 0.0, 0.0, 1.0 });
 	wlr_renderer_end(renderer);
+	surf->damage_history_len = 0;
 	return swap_drm_surface_buffers(surf, NULL);
 }
 
@@ -193,16 +212,45 @@ bool export_drm_bo(struct gbm_bo *bo, struct wlr_dmabuf_attributes *attribs) {
 	return true;
 }
 
-static void free_tex(struct gbm_bo *bo, void *data) {
-	struct wlr_texture *tex = data;
-	wlr_texture_destroy(tex);
+// Resources derived from a buffer rendered by the parent GPU
+struct wlr_drm_mgpu_bo {
+	struct wlr_texture *tex;
+	struct gbm_bo *import;
+	bool import_failed;
+};
+
+static void free_mgpu_bo(struct gbm_bo *bo, void *data) {
+	struct wlr_drm_mgpu_bo *mgpu_bo = data;
+	wlr_texture_destroy(mgpu_bo->tex);
+	if (mgpu_bo->import != NULL) {
+		gbm_bo_destroy(mgpu_bo->import);
+	}
+	free(mgpu_bo);
+}
+
+static struct wlr_drm_mgpu_bo *get_mgpu_bo(struct gbm_bo *bo) {
+	struct wlr_drm_mgpu_bo *mgpu_bo = gbm_bo_get_user_data(bo);
+	if (mgpu_bo) {
+		return mgpu_bo;
+	}
+
+	mgpu_bo = calloc(1, sizeof(struct wlr_drm_mgpu_bo));
+	if (!mgpu_bo) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	gbm_bo_set_user_data(bo, mgpu_bo, free_mgpu_bo);
+	return mgpu_bo;
 }
 
 static struct wlr_texture *get_tex_for_bo(struct wlr_drm_renderer *renderer,
 		struct gbm_bo *bo) {
-	struct wlr_texture *tex = gbm_bo_get_user_data(bo);
-	if (tex) {
-		return tex;
+	struct wlr_drm_mgpu_bo *mgpu_bo = get_mgpu_bo(bo);
+	if (!mgpu_bo) {
+		return NULL;
+	}
+	if (mgpu_bo->tex) {
+		return mgpu_bo->tex;
 	}
 
 	struct wlr_dmabuf_attributes attribs;
@@ -210,31 +258,128 @@ static struct wlr_texture *get_tex_for_bo(struct wlr_drm_renderer *renderer,
 		return NULL;
 	}
 
-	tex = wlr_texture_from_dmabuf(renderer->wlr_rend, &attribs);
-	if (tex) {
-		gbm_bo_set_user_data(bo, tex, free_tex);
+	mgpu_bo->tex = wlr_texture_from_dmabuf(renderer->wlr_rend, &attribs);
+	wlr_dmabuf_attributes_finish(&attribs);
+	return mgpu_bo->tex;
+}
+
+struct gbm_bo *import_drm_bo_mgpu(struct wlr_drm_renderer *renderer,
+		struct gbm_bo *src) {
+	struct wlr_drm_mgpu_bo *mgpu_bo = get_mgpu_bo(src);
+	if (!mgpu_bo || mgpu_bo->import_failed) {
+		return NULL;
+	}
+	if (mgpu_bo->import) {
+		return mgpu_bo->import;
 	}
 
-	return tex;
+	struct wlr_dmabuf_attributes attribs;
+	if (!export_drm_bo(src, &attribs)) {
+		mgpu_bo->import_failed = true;
+		return NULL;
+	}
+
+	if (attribs.modifier != DRM_FORMAT_MOD_INVALID) {
+		struct gbm_import_fd_modifier_data data = {
+			.width = attribs.width,
+			.height = attribs.height,
+			.format = attribs.format,
+			.num_fds = attribs.n_planes,
+			.modifier = attribs.modifier,
+		};
+		for (int i = 0; i < attribs.n_planes; ++i) {
+			data.fds[i] = attribs.fd[i];
+			data.strides[i] = attribs.stride[i];
+			data.offsets[i] = attribs.offset[i];
+		}
+		mgpu_bo->import = gbm_bo_import(renderer->gbm,
+			GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
+	} else if (attribs.n_planes == 1 && attribs.offset[0] == 0) {
+		struct gbm_import_fd_data data = {
+			.fd = attribs.fd[0],
+			.width = attribs.width,
+			.height = attribs.height,
+			.stride = attribs.stride[0],
+			.format = attribs.format,
+		};
+		mgpu_bo->import = gbm_bo_import(renderer->gbm,
+			GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+	}
+	wlr_dmabuf_attributes_finish(&attribs);
+
+	if (!mgpu_bo->import) {
+		wlr_log(WLR_DEBUG, "Failed to import buffer into secondary GPU");
+		mgpu_bo->import_failed = true;
+		return NULL;
+	}
+
+	return mgpu_bo->import;
 }
 
 struct gbm_bo *copy_drm_surface_mgpu(struct wlr_drm_surface *dest,
-		struct gbm_bo *src) {
-	make_drm_surface_current(dest, NULL);
+		struct gbm_bo *src, pixman_region32_t *damage) {
+	int buffer_age = -1;
+	make_drm_surface_current(dest, &buffer_age);
 
 	struct wlr_texture *tex = get_tex_for_bo(dest->renderer, src);
 	assert(tex);
 
+	// Only copy what changed since the destination buffer was last used
+	pixman_region32_t copy_damage;
+	pixman_region32_init(&copy_damage);
+	if (damage == NULL || buffer_age <= 0 ||
+			buffer_age - 1 > (int)dest->damage_history_len) {
+		pixman_region32_union_rect(&copy_damage, &copy_damage, 0, 0,
+			dest->width, dest->height);
+	} else {
+		pixman_region32_copy(&copy_damage, damage);
+		for (int i = 0; i < buffer_age - 1; ++i) {
+			pixman_region32_union(&copy_damage, &copy_damage,
+				&dest->damage_history[i]);
+		}
+	}
+
+	for (size_t i = DRM_SURFACE_DAMAGE_HISTORY_LEN - 1; i > 0; --i) {
+		pixman_region32_copy(&dest->damage_history[i],
+			&dest->damage_history[i - 1]);
+	}
+	if (damage != NULL) {
+		pixman_region32_copy(&dest->damage_history[0], damage);
+	} else {
+		pixman_region32_copy(&dest->damage_history[0], &copy_damage);
+	}
+	if (dest->damage_history_len < DRM_SURFACE_DAMAGE_HISTORY_LEN) {
+		dest->damage_history_len++;
+	}
+
 	float mat[9];
 	wlr_matrix_projection(mat, 1, 1, WL_OUTPUT_TRANSFORM_NORMAL);
 
 	struct wlr_renderer *renderer = dest->renderer->wlr_rend;
+	// The source buffer already went through the gamma ramp, if any
+	wlr_renderer_set_gamma(renderer, 0, NULL, NULL, NULL);
 	wlr_renderer_begin(renderer, dest->width, dest->height);
-	wlr_renderer_clear(renderer, (float[]){ 0.0, 0.0, 0.0, 0.0 });
-	wlr_render_texture_with_matrix(renderer, tex, mat, 1.0f);
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&copy_damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		struct wlr_box box = {
+			.x = rects[i].x1,
+			.y = rects[i].y1,
+			.width = rects[i].x2 - rects[i].x1,
+			.height = rects[i].y2 - rects[i].y1,
+		};
+		wlr_renderer_scissor(renderer, &box);
+		wlr_renderer_clear(renderer, (float[]){ 0.0, 0.0, 0.0, 0.0 });
+		wlr_render_texture_with_matrix(renderer, tex, mat, 1.0f);
+	}
+	wlr_renderer_scissor(renderer, NULL);
+
 	wlr_renderer_end(renderer);
 
-	return swap_drm_surface_buffers(dest, NULL);
+	struct gbm_bo *bo = swap_drm_surface_buffers(dest, &copy_damage);
+	pixman_region32_fini(&copy_damage);
+	return bo;
 }
 
 bool init_drm_plane_surfaces(struct wlr_drm_plane *plane,
@@ -256,5 +401,7 @@ bool init_drm_plane_surfaces(struct wlr_drm_plane *plane,
 		return false;
 	}
 
+	// Try zero-copy scanout again, the new buffers might be importable
+	plane->mgpu_copy = false;
 	return true;
 }
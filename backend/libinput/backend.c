@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <libinput.h>
+#include <libudev.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/backend/interface.h>
 #include <wlr/backend/session.h>
 #include <wlr/util/log.h>
@@ -49,6 +51,45 @@ static void log_libinput(struct libinput *libinput_context,
 	_wlr_vlog(WLR_ERROR, fmt, args);
 }
 
+/**
+ * libinput opens the devices of the seat one after the other. Request them all
+ * upfront, so that the session can open them in parallel.
+ */
+static void prefetch_input_devices(struct wlr_libinput_backend *backend) {
+	struct wlr_session *session = backend->session;
+	struct udev_enumerate *en = udev_enumerate_new(session->udev);
+	if (!en) {
+		wlr_log(WLR_ERROR, "Failed to create udev enumeration");
+		return;
+	}
+
+	udev_enumerate_add_match_subsystem(en, "input");
+	udev_enumerate_add_match_sysname(en, "event[0-9]*");
+	udev_enumerate_add_match_property(en, "ID_INPUT", "1");
+	udev_enumerate_scan_devices(en);
+
+	struct udev_list_entry *entry;
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(en)) {
+		const char *path = udev_list_entry_get_name(entry);
+		struct udev_device *dev = udev_device_new_from_syspath(session->udev, path);
+		if (!dev) {
+			continue;
+		}
+
+		const char *seat = udev_device_get_property_value(dev, "ID_SEAT");
+		if (!seat) {
+			seat = "seat0";
+		}
+		const char *devnode = udev_device_get_devnode(dev);
+		if (devnode && strcmp(session->seat, seat) == 0) {
+			wlr_session_prefetch_file(session, devnode);
+		}
+		udev_device_unref(dev);
+	}
+
+	udev_enumerate_unref(en);
+}
+
 static bool backend_start(struct wlr_backend *wlr_backend) {
 	struct wlr_libinput_backend *backend =
 		get_libinput_backend_from_backend(wlr_backend);
@@ -61,6 +102,8 @@ static bool backend_start(struct wlr_backend *wlr_backend) {
 		return false;
 	}
 
+	prefetch_input_devices(backend);
+
 	if (libinput_udev_assign_seat(backend->libinput_context,
 			backend->session->seat) != 0) {
 		wlr_log(WLR_ERROR, "Failed to assign libinput seat");
@@ -87,6 +130,17 @@ static bool backend_start(struct wlr_backend *wlr_backend) {
 		}
 	}
 
+	const char *use_thread = getenv("WLR_LIBINPUT_THREAD");
+	if (use_thread && strcmp(use_thread, "1") == 0 &&
+			backend->thread == NULL) {
+		if (start_libinput_thread(backend)) {
+			wlr_log(WLR_DEBUG, "libinput successfully initialized");
+			return true;
+		}
+		wlr_log(WLR_ERROR, "Failed to start input thread, "
+			"falling back to the event loop");
+	}
+
 	struct wl_event_loop *event_loop =
 		wl_display_get_event_loop(backend->display);
 	if (backend->input_event) {
@@ -109,6 +163,8 @@ static void backend_destroy(struct wlr_backend *wlr_backend) {
 	struct wlr_libinput_backend *backend =
 		get_libinput_backend_from_backend(wlr_backend);
 
+	stop_libinput_thread(backend);
+
 	for (size_t i = 0; i < backend->wlr_device_lists.length; i++) {
 		struct wl_list *wlr_devices = backend->wlr_device_lists.items[i];
 		struct wlr_input_device *wlr_dev, *next;
@@ -149,11 +205,13 @@ static void session_signal(struct wl_listener *listener, void *data) {
 		return;
 	}
 
+	libinput_backend_lock(backend);
 	if (session->active) {
 		libinput_resume(backend->libinput_context);
 	} else {
 		libinput_suspend(backend->libinput_context);
 	}
+	libinput_backend_unlock(backend);
 }
 
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
@@ -23,7 +23,12 @@ static struct wlr_libinput_keyboard *get_libinput_keyboard_from_keyboard(
 static void keyboard_set_leds(struct wlr_keyboard *wlr_kb, uint32_t leds) {
 	struct wlr_libinput_keyboard *kb =
 		get_libinput_keyboard_from_keyboard(wlr_kb);
+	struct wlr_libinput_backend *backend = libinput_get_user_data(
+		libinput_device_get_context(kb->libinput_dev));
+	// May be called outside of an input event handler
+	libinput_backend_lock(backend);
 	libinput_device_led_update(kb->libinput_dev, leds);
+	libinput_backend_unlock(backend);
 }
 
 static void keyboard_destroy(struct wlr_keyboard *wlr_kb) {
@@ -22,22 +22,31 @@ struct wlr_pointer *create_libinput_pointer(
 
 void handle_pointer_motion(struct libinput_event *event,
 		struct libinput_device *libinput_dev) {
+	handle_pointer_motion_batch(&event, 1, libinput_dev);
+}
+
+void handle_pointer_motion_batch(struct libinput_event **events, size_t len,
+		struct libinput_device *libinput_dev) {
 	struct wlr_input_device *wlr_dev =
 		get_appropriate_device(WLR_INPUT_DEVICE_POINTER, libinput_dev);
 	if (!wlr_dev) {
 		wlr_log(WLR_DEBUG, "Got a pointer event for a device with no pointers?");
 		return;
 	}
-	struct libinput_event_pointer *pevent =
-		libinput_event_get_pointer_event(event);
 	struct wlr_event_pointer_motion wlr_event = { 0 };
 	wlr_event.device = wlr_dev;
-	wlr_event.time_msec =
-		usec_to_msec(libinput_event_pointer_get_time_usec(pevent));
-	wlr_event.delta_x = libinput_event_pointer_get_dx(pevent);
-	wlr_event.delta_y = libinput_event_pointer_get_dy(pevent);
-	wlr_event.unaccel_dx = libinput_event_pointer_get_dx_unaccelerated(pevent);
-	wlr_event.unaccel_dy = libinput_event_pointer_get_dy_unaccelerated(pevent);
+	for (size_t i = 0; i < len; ++i) {
+		struct libinput_event_pointer *pevent =
+			libinput_event_get_pointer_event(events[i]);
+		wlr_event.time_msec =
+			usec_to_msec(libinput_event_pointer_get_time_usec(pevent));
+		wlr_event.delta_x += libinput_event_pointer_get_dx(pevent);
+		wlr_event.delta_y += libinput_event_pointer_get_dy(pevent);
+		wlr_event.unaccel_dx +=
+			libinput_event_pointer_get_dx_unaccelerated(pevent);
+		wlr_event.unaccel_dy +=
+			libinput_event_pointer_get_dy_unaccelerated(pevent);
+	}
 	wlr_signal_emit_safe(&wlr_dev->pointer->events.motion, &wlr_event);
 	wlr_signal_emit_safe(&wlr_dev->pointer->events.frame, wlr_dev->pointer);
 }
@@ -91,14 +100,20 @@ void handle_pointer_button(struct libinput_event *event,
 
 void handle_pointer_axis(struct libinput_event *event,
 		struct libinput_device *libinput_dev) {
+	handle_pointer_axis_batch(&event, 1, libinput_dev);
+}
+
+void handle_pointer_axis_batch(struct libinput_event **events, size_t len,
+		struct libinput_device *libinput_dev) {
 	struct wlr_input_device *wlr_dev =
 		get_appropriate_device(WLR_INPUT_DEVICE_POINTER, libinput_dev);
 	if (!wlr_dev) {
 		wlr_log(WLR_DEBUG, "Got a pointer event for a device with no pointers?");
 		return;
 	}
+	// All events of a batch have the same source and axes
 	struct libinput_event_pointer *pevent =
-		libinput_event_get_pointer_event(event);
+		libinput_event_get_pointer_event(events[len - 1]);
 	struct wlr_event_pointer_axis wlr_event = { 0 };
 	wlr_event.device = wlr_dev;
 	wlr_event.time_msec =
@@ -131,10 +146,16 @@ void handle_pointer_axis(struct libinput_event *event,
 				wlr_event.orientation = WLR_AXIS_ORIENTATION_HORIZONTAL;
 				break;
 			}
-			wlr_event.delta =
-				libinput_event_pointer_get_axis_value(pevent, axes[i]);
-			wlr_event.delta_discrete =
-				libinput_event_pointer_get_axis_value_discrete(pevent, axes[i]);
+			wlr_event.delta = 0;
+			wlr_event.delta_discrete = 0;
+			for (size_t j = 0; j < len; ++j) {
+				struct libinput_event_pointer *ev =
+					libinput_event_get_pointer_event(events[j]);
+				wlr_event.delta +=
+					libinput_event_pointer_get_axis_value(ev, axes[i]);
+				wlr_event.delta_discrete +=
+					libinput_event_pointer_get_axis_value_discrete(ev, axes[i]);
+			}
 			wlr_signal_emit_safe(&wlr_dev->pointer->events.axis, &wlr_event);
 		}
 	}
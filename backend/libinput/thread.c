@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <errno.h>
+#include <libinput.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "backend/libinput.h"
+
+static bool queue_is_full(struct wlr_libinput_thread *thread) {
+	size_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_relaxed);
+	return tail - head == LIBINPUT_THREAD_QUEUE_SIZE;
+}
+
+static void queue_push(struct wlr_libinput_thread *thread,
+		struct libinput_event *event) {
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_relaxed);
+	thread->events[tail % LIBINPUT_THREAD_QUEUE_SIZE] = event;
+	atomic_store_explicit(&thread->tail, tail + 1, memory_order_release);
+}
+
+static void signal_fd(int fd) {
+	uint64_t one = 1;
+	if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		wlr_log_errno(WLR_ERROR, "Failed to write to eventfd");
+	}
+}
+
+static void *input_thread_run(void *data) {
+	struct wlr_libinput_thread *thread = data;
+	struct libinput *libinput = thread->backend->libinput_context;
+
+	struct pollfd fds[] = {
+		{ .fd = libinput_get_fd(libinput), .events = POLLIN },
+		{ .fd = thread->control_fd, .events = POLLIN },
+	};
+	bool full = false;
+	while (true) {
+		// Don't read more events until the main thread makes room for them
+		fds[0].fd = full ? -1 : libinput_get_fd(libinput);
+		if (poll(fds, sizeof(fds) / sizeof(fds[0]), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			wlr_log_errno(WLR_ERROR, "poll failed");
+			break;
+		}
+		if (fds[1].revents & POLLIN) {
+			uint64_t count;
+			if (read(thread->control_fd, &count, sizeof(count)) < 0 &&
+					errno != EAGAIN) {
+				wlr_log_errno(WLR_ERROR, "Failed to read from eventfd");
+			}
+		}
+		if (atomic_load(&thread->stop)) {
+			break;
+		}
+
+		pthread_mutex_lock(&thread->lock);
+		if (libinput_dispatch(libinput) != 0) {
+			wlr_log(WLR_ERROR, "Failed to dispatch libinput");
+		}
+		size_t queued = 0;
+		while (!(full = queue_is_full(thread))) {
+			struct libinput_event *event = libinput_get_event(libinput);
+			if (event == NULL) {
+				break;
+			}
+			queue_push(thread, event);
+			++queued;
+		}
+		pthread_mutex_unlock(&thread->lock);
+
+		if (full) {
+			atomic_store(&thread->blocked, true);
+			// The main thread may have drained the queue in the meantime
+			full = queue_is_full(thread);
+		}
+		if (queued > 0) {
+			signal_fd(thread->event_fd);
+		}
+	}
+
+	return NULL;
+}
+
+static bool event_is_axis_stop(struct libinput_event_pointer *pevent) {
+	const enum libinput_pointer_axis axes[] = {
+		LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
+		LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL,
+	};
+	for (size_t i = 0; i < sizeof(axes) / sizeof(axes[0]); ++i) {
+		if (libinput_event_pointer_has_axis(pevent, axes[i]) &&
+				libinput_event_pointer_get_axis_value(pevent, axes[i]) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Returns whether `next` can be merged into a batch of events ending with
+ * `last`. Relative motion is summed and scroll values of the same source and
+ * axes are added up, everything else is handled one event at a time.
+ */
+static bool events_can_coalesce(struct libinput_event *last,
+		struct libinput_event *next) {
+	enum libinput_event_type type = libinput_event_get_type(last);
+	if (libinput_event_get_type(next) != type ||
+			libinput_event_get_device(next) != libinput_event_get_device(last)) {
+		return false;
+	}
+
+	switch (type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		return true;
+	case LIBINPUT_EVENT_POINTER_AXIS: {
+		struct libinput_event_pointer *a = libinput_event_get_pointer_event(last);
+		struct libinput_event_pointer *b = libinput_event_get_pointer_event(next);
+		return libinput_event_pointer_get_axis_source(a) ==
+				libinput_event_pointer_get_axis_source(b) &&
+			libinput_event_pointer_has_axis(a,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL) ==
+				libinput_event_pointer_has_axis(b,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL) &&
+			libinput_event_pointer_has_axis(a,
+				LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL) ==
+				libinput_event_pointer_has_axis(b,
+				LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL) &&
+			!event_is_axis_stop(a) && !event_is_axis_stop(b);
+	}
+	default:
+		return false;
+	}
+}
+
+static void handle_event_batch(struct wlr_libinput_backend *backend,
+		struct libinput_event **events, size_t len) {
+	struct libinput_device *libinput_dev = libinput_event_get_device(events[0]);
+	switch (libinput_event_get_type(events[0])) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		handle_pointer_motion_batch(events, len, libinput_dev);
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		handle_pointer_axis_batch(events, len, libinput_dev);
+		break;
+	default:
+		assert(len == 1);
+		handle_libinput_event(backend, events[0]);
+		break;
+	}
+}
+
+static int handle_thread_events(int fd, uint32_t mask, void *data) {
+	struct wlr_libinput_backend *backend = data;
+	struct wlr_libinput_thread *thread = backend->thread;
+
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+		wlr_log_errno(WLR_ERROR, "Failed to read from eventfd");
+	}
+
+	struct libinput_event *batch[LIBINPUT_THREAD_MAX_BATCH];
+	libinput_backend_lock(backend);
+	thread->dispatching = true;
+	size_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_acquire);
+	while (head != tail) {
+		size_t len = 0;
+		batch[len++] = thread->events[head++ % LIBINPUT_THREAD_QUEUE_SIZE];
+		while (head != tail && len < LIBINPUT_THREAD_MAX_BATCH) {
+			struct libinput_event *next =
+				thread->events[head % LIBINPUT_THREAD_QUEUE_SIZE];
+			if (!events_can_coalesce(batch[len - 1], next)) {
+				break;
+			}
+			batch[len++] = next;
+			++head;
+		}
+
+		handle_event_batch(backend, batch, len);
+		for (size_t i = 0; i < len; ++i) {
+			libinput_event_destroy(batch[i]);
+		}
+
+		atomic_store_explicit(&thread->head, head, memory_order_release);
+		tail = atomic_load_explicit(&thread->tail, memory_order_acquire);
+	}
+	thread->dispatching = false;
+	libinput_backend_unlock(backend);
+
+	if (atomic_exchange(&thread->blocked, false)) {
+		signal_fd(thread->control_fd);
+	}
+	return 0;
+}
+
+bool start_libinput_thread(struct wlr_libinput_backend *backend) {
+	assert(backend->thread == NULL);
+
+	struct wlr_libinput_thread *thread =
+		calloc(1, sizeof(struct wlr_libinput_thread));
+	if (thread == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	thread->backend = backend;
+	atomic_init(&thread->head, 0);
+	atomic_init(&thread->tail, 0);
+	atomic_init(&thread->stop, false);
+	atomic_init(&thread->blocked, false);
+
+	// Device handlers may call back into libinput with the lock held
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	int ret = pthread_mutex_init(&thread->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+	if (ret != 0) {
+		wlr_log(WLR_ERROR, "Failed to create mutex: %s", strerror(ret));
+		goto error_thread;
+	}
+
+	thread->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (thread->event_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create eventfd");
+		goto error_lock;
+	}
+	thread->control_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (thread->control_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create eventfd");
+		goto error_event_fd;
+	}
+
+	struct wl_event_loop *event_loop =
+		wl_display_get_event_loop(backend->display);
+	thread->event_source = wl_event_loop_add_fd(event_loop, thread->event_fd,
+		WL_EVENT_READABLE, handle_thread_events, backend);
+	if (thread->event_source == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create input event on event loop");
+		goto error_control_fd;
+	}
+
+	backend->thread = thread;
+	ret = pthread_create(&thread->thread, NULL, input_thread_run, thread);
+	if (ret != 0) {
+		wlr_log(WLR_ERROR, "Failed to create input thread: %s", strerror(ret));
+		backend->thread = NULL;
+		goto error_event_source;
+	}
+
+	wlr_log(WLR_DEBUG, "Started libinput input thread");
+	return true;
+
+error_event_source:
+	wl_event_source_remove(thread->event_source);
+error_control_fd:
+	close(thread->control_fd);
+error_event_fd:
+	close(thread->event_fd);
+error_lock:
+	pthread_mutex_destroy(&thread->lock);
+error_thread:
+	free(thread);
+	return false;
+}
+
+void stop_libinput_thread(struct wlr_libinput_backend *backend) {
+	struct wlr_libinput_thread *thread = backend->thread;
+	if (thread == NULL) {
+		return;
+	}
+
+	// The join would never return: the input thread can't stop itself, and
+	// it may be waiting for the lock held while its events are handled. The
+	// events being handled would also be destroyed under the handler's feet.
+	assert(!pthread_equal(pthread_self(), thread->thread));
+	assert(!thread->dispatching);
+
+	atomic_store(&thread->stop, true);
+	signal_fd(thread->control_fd);
+	pthread_join(thread->thread, NULL);
+	backend->thread = NULL;
+
+	// Events which haven't been handled yet are dropped
+	size_t head = atomic_load(&thread->head);
+	size_t tail = atomic_load(&thread->tail);
+	for (; head != tail; ++head) {
+		libinput_event_destroy(
+			thread->events[head % LIBINPUT_THREAD_QUEUE_SIZE]);
+	}
+
+	wl_event_source_remove(thread->event_source);
+	close(thread->control_fd);
+	close(thread->event_fd);
+	pthread_mutex_destroy(&thread->lock);
+	free(thread);
+}
+
+void libinput_backend_lock(struct wlr_libinput_backend *backend) {
+	if (backend->thread != NULL) {
+		pthread_mutex_lock(&backend->thread->lock);
+	}
+}
+
+void libinput_backend_unlock(struct wlr_libinput_backend *backend) {
+	if (backend->thread != NULL) {
+		pthread_mutex_unlock(&backend->thread->lock);
+	}
+}
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,6 +32,7 @@ struct logind_session {
 	struct wlr_session base;
 
 	sd_bus *bus;
+	struct wl_event_loop *event_loop;
 	struct wl_event_source *event;
 
 	char *id;
@@ -40,6 +42,35 @@ struct logind_session {
 	// if so, the session will be (de)activated with the drm fd,
 	// otherwise with the dbus PropertiesChanged on "active" signal
 	bool has_drm;
+
+	struct wl_list prefetches; // logind_prefetch::link
+	struct wl_event_source *prefetch_idle;
+
+	// Signals received while waiting for a prefetched device are dispatched
+	// from an idle callback, so that they don't fire inside open_file
+	bool defer_signals;
+	struct wl_list deferred_signals; // logind_deferred_signal::link
+	struct wl_event_source *deferred_idle;
+};
+
+/**
+ * A device requested with an asynchronous TakeDevice call, see
+ * wlr_session_prefetch_file.
+ */
+struct logind_prefetch {
+	struct logind_session *session;
+	dev_t dev;
+	sd_bus_slot *slot;
+	bool done; // the reply has been received
+	bool discarded; // released as soon as the reply is received
+	int fd; // -1 if the device couldn't be taken
+	struct wl_list link;
+};
+
+struct logind_deferred_signal {
+	sd_bus_message *msg;
+	sd_bus_message_handler_t handler;
+	struct wl_list link;
 };
 
 static struct logind_session *logind_session_from_session(
@@ -48,6 +79,181 @@ static struct logind_session *logind_session_from_session(
 	return (struct logind_session *)base;
 }
 
+static void update_event_mask(struct logind_session *session) {
+	// Messages are only written right away if the socket isn't full
+	uint32_t mask = WL_EVENT_READABLE;
+	if (sd_bus_get_events(session->bus) & POLLOUT) {
+		mask |= WL_EVENT_WRITABLE;
+	}
+	wl_event_source_fd_update(session->event, mask);
+}
+
+static int release_device_handler(sd_bus_message *msg, void *userdata,
+		sd_bus_error *ret_error) {
+	const sd_bus_error *error = sd_bus_message_get_error(msg);
+	if (error != NULL) {
+		wlr_log(WLR_ERROR, "Failed to release device: %s", error->message);
+	}
+	return 0;
+}
+
+static void release_device(struct logind_session *session, dev_t dev) {
+	// The reply isn't waited for, logind handles requests in order
+	int ret = sd_bus_call_method_async(session->bus, NULL,
+		"org.freedesktop.login1", session->path,
+		"org.freedesktop.login1.Session", "ReleaseDevice",
+		release_device_handler, NULL, "uu", major(dev), minor(dev));
+	if (ret < 0) {
+		wlr_log(WLR_ERROR, "Failed to release device %u:%u: %s",
+			major(dev), minor(dev), strerror(-ret));
+	}
+	update_event_mask(session);
+}
+
+static void prefetch_destroy(struct logind_prefetch *prefetch) {
+	if (prefetch->fd >= 0) {
+		release_device(prefetch->session, prefetch->dev);
+		close(prefetch->fd);
+	}
+	sd_bus_slot_unref(prefetch->slot);
+	wl_list_remove(&prefetch->link);
+	free(prefetch);
+}
+
+static int take_device_handler(sd_bus_message *msg, void *userdata,
+		sd_bus_error *ret_error) {
+	struct logind_prefetch *prefetch = userdata;
+	prefetch->done = true;
+
+	const sd_bus_error *error = sd_bus_message_get_error(msg);
+	if (error != NULL) {
+		wlr_log(WLR_ERROR, "Failed to take device %u:%u: %s",
+			major(prefetch->dev), minor(prefetch->dev), error->message);
+		goto out;
+	}
+
+	int fd, paused;
+	int ret = sd_bus_message_read(msg, "hb", &fd, &paused);
+	if (ret < 0) {
+		wlr_log(WLR_ERROR, "Failed to parse D-Bus response for %u:%u: %s",
+			major(prefetch->dev), minor(prefetch->dev), strerror(-ret));
+		goto out;
+	}
+
+	// The fd is closed when the message is freed
+	prefetch->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (prefetch->fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to clone file descriptor");
+		// The device has been taken nonetheless
+		release_device(prefetch->session, prefetch->dev);
+	}
+
+out:
+	if (prefetch->discarded) {
+		prefetch_destroy(prefetch);
+	}
+	return 0;
+}
+
+static void handle_prefetch_idle(void *data) {
+	struct logind_session *session = data;
+	session->prefetch_idle = NULL;
+
+	struct logind_prefetch *prefetch, *tmp;
+	wl_list_for_each_safe(prefetch, tmp, &session->prefetches, link) {
+		if (prefetch->done) {
+			prefetch_destroy(prefetch);
+		} else {
+			prefetch->discarded = true;
+		}
+	}
+}
+
+static struct logind_prefetch *find_prefetch(struct logind_session *session,
+		dev_t dev) {
+	struct logind_prefetch *prefetch;
+	wl_list_for_each(prefetch, &session->prefetches, link) {
+		if (prefetch->dev == dev) {
+			return prefetch;
+		}
+	}
+	return NULL;
+}
+
+static void logind_prefetch_device(struct wlr_session *base, const char *path) {
+	struct logind_session *session = logind_session_from_session(base);
+
+	// The reply can't be waited for while D-Bus messages are being dispatched,
+	// e.g. when devices are re-opened from the ResumeDevice handler
+	if (sd_bus_get_current_message(session->bus) != NULL) {
+		return;
+	}
+
+	struct stat st;
+	if (stat(path, &st) < 0) {
+		wlr_log(WLR_ERROR, "Failed to stat '%s'", path);
+		return;
+	}
+	struct logind_prefetch *prefetch = find_prefetch(session, st.st_rdev);
+	if (prefetch != NULL) {
+		prefetch->discarded = false;
+	} else {
+		prefetch = calloc(1, sizeof(*prefetch));
+		if (prefetch == NULL) {
+			wlr_log_errno(WLR_ERROR, "Allocation failed");
+			return;
+		}
+		prefetch->session = session;
+		prefetch->dev = st.st_rdev;
+		prefetch->fd = -1;
+
+		int ret = sd_bus_call_method_async(session->bus, &prefetch->slot,
+			"org.freedesktop.login1", session->path,
+			"org.freedesktop.login1.Session", "TakeDevice",
+			take_device_handler, prefetch, "uu",
+			major(st.st_rdev), minor(st.st_rdev));
+		if (ret < 0) {
+			wlr_log(WLR_ERROR, "Failed to take device '%s': %s", path,
+				strerror(-ret));
+			free(prefetch);
+			return;
+		}
+		wl_list_insert(session->prefetches.prev, &prefetch->link);
+		update_event_mask(session);
+	}
+
+	if (session->prefetch_idle == NULL) {
+		session->prefetch_idle = wl_event_loop_add_idle(session->event_loop,
+			handle_prefetch_idle, session);
+	}
+}
+
+static int take_prefetched_device(struct logind_session *session,
+		struct logind_prefetch *prefetch) {
+	prefetch->discarded = false;
+	session->defer_signals = true;
+	while (!prefetch->done) {
+		int ret = sd_bus_process(session->bus, NULL);
+		if (ret == 0) {
+			ret = sd_bus_wait(session->bus, UINT64_MAX);
+		}
+		if (ret < 0) {
+			wlr_log(WLR_ERROR, "Failed to wait for device %u:%u: %s",
+				major(prefetch->dev), minor(prefetch->dev), strerror(-ret));
+			// Released once the reply is received
+			prefetch->discarded = true;
+			session->defer_signals = false;
+			return -1;
+		}
+	}
+	session->defer_signals = false;
+
+	int fd = prefetch->fd;
+	prefetch->fd = -1;
+	prefetch_destroy(prefetch);
+	return fd;
+}
+
 static int logind_take_device(struct wlr_session *base, const char *path) {
 	struct logind_session *session = logind_session_from_session(base);
 
@@ -66,6 +272,11 @@ static int logind_take_device(struct wlr_session *base, const char *path) {
 		session->has_drm = true;
 	}
 
+	struct logind_prefetch *prefetch = find_prefetch(session, st.st_rdev);
+	if (prefetch != NULL) {
+		return take_prefetched_device(session, prefetch);
+	}
+
 	ret = sd_bus_call_method(session->bus, "org.freedesktop.login1",
 		session->path, "org.freedesktop.login1.Session", "TakeDevice",
 		&error, &msg, "uu", major(st.st_rdev), minor(st.st_rdev));
@@ -108,18 +319,7 @@ static void logind_release_device(struct wlr_session *base, int fd) {
 		return;
 	}
 
-	sd_bus_message *msg = NULL;
-	sd_bus_error error = SD_BUS_ERROR_NULL;
-	int ret = sd_bus_call_method(session->bus, "org.freedesktop.login1",
-		session->path, "org.freedesktop.login1.Session", "ReleaseDevice",
-		&error, &msg, "uu", major(st.st_rdev), minor(st.st_rdev));
-	if (ret < 0) {
-		wlr_log(WLR_ERROR, "Failed to release device '%d': %s", fd,
-			error.message);
-	}
-
-	sd_bus_error_free(&error);
-	sd_bus_message_unref(msg);
+	release_device(session, st.st_rdev);
 	close(fd);
 }
 
@@ -230,6 +430,25 @@ static void release_control(struct logind_session *session) {
 static void logind_session_destroy(struct wlr_session *base) {
 	struct logind_session *session = logind_session_from_session(base);
 
+	struct logind_prefetch *prefetch, *tmp;
+	wl_list_for_each_safe(prefetch, tmp, &session->prefetches, link) {
+		prefetch_destroy(prefetch);
+	}
+	if (session->prefetch_idle != NULL) {
+		wl_event_source_remove(session->prefetch_idle);
+	}
+
+	struct logind_deferred_signal *signal, *signal_tmp;
+	wl_list_for_each_safe(signal, signal_tmp, &session->deferred_signals,
+			link) {
+		sd_bus_message_unref(signal->msg);
+		wl_list_remove(&signal->link);
+		free(signal);
+	}
+	if (session->deferred_idle != NULL) {
+		wl_event_source_remove(session->deferred_idle);
+	}
+
 	release_control(session);
 
 	wl_event_source_remove(session->event);
@@ -239,8 +458,61 @@ static void logind_session_destroy(struct wlr_session *base) {
 	free(session);
 }
 
+static void handle_deferred_idle(void *data) {
+	struct logind_session *session = data;
+	session->deferred_idle = NULL;
+
+	// Handlers may take devices and defer more signals
+	struct wl_list deferred;
+	wl_list_init(&deferred);
+	wl_list_insert_list(&deferred, &session->deferred_signals);
+	wl_list_init(&session->deferred_signals);
+
+	struct logind_deferred_signal *signal, *tmp;
+	wl_list_for_each_safe(signal, tmp, &deferred, link) {
+		sd_bus_error error = SD_BUS_ERROR_NULL;
+		signal->handler(signal->msg, session, &error);
+		sd_bus_error_free(&error);
+		sd_bus_message_unref(signal->msg);
+		wl_list_remove(&signal->link);
+		free(signal);
+	}
+}
+
+/**
+ * Queues the signal if it can't be handled right away. Signals already queued
+ * are waited for, so that they are handled in order.
+ */
+static bool defer_signal(struct logind_session *session, sd_bus_message *msg,
+		sd_bus_message_handler_t handler) {
+	if (!session->defer_signals && wl_list_empty(&session->deferred_signals)) {
+		return false;
+	}
+
+	struct logind_deferred_signal *signal =
+		calloc(1, sizeof(struct logind_deferred_signal));
+	if (signal == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	signal->msg = sd_bus_message_ref(msg);
+	signal->handler = handler;
+	wl_list_insert(session->deferred_signals.prev, &signal->link);
+
+	if (session->deferred_idle == NULL) {
+		session->deferred_idle = wl_event_loop_add_idle(session->event_loop,
+			handle_deferred_idle, session);
+	}
+	return true;
+}
+
 static int session_removed(sd_bus_message *msg, void *userdata,
 		sd_bus_error *ret_error) {
+	struct logind_session *session = userdata;
+	if (defer_signal(session, msg, session_removed)) {
+		return 0;
+	}
+
 	wlr_log(WLR_INFO, "SessionRemoved signal received");
 	return 0;
 }
@@ -263,6 +535,9 @@ static struct wlr_device *find_device(struct wlr_session *session,
 static int pause_device(sd_bus_message *msg, void *userdata,
 		sd_bus_error *ret_error) {
 	struct logind_session *session = userdata;
+	if (defer_signal(session, msg, pause_device)) {
+		return 0;
+	}
 	int ret;
 
 	uint32_t major, minor;
@@ -297,6 +572,9 @@ error:
 static int resume_device(sd_bus_message *msg, void *userdata,
 		sd_bus_error *ret_error) {
 	struct logind_session *session = userdata;
+	if (defer_signal(session, msg, resume_device)) {
+		return 0;
+	}
 	int ret;
 
 	int fd;
@@ -330,6 +608,9 @@ error:
 static int properties_changed(sd_bus_message *msg, void *userdata,
 		sd_bus_error *ret_error) {
 	struct logind_session *session = userdata;
+	if (defer_signal(session, msg, properties_changed)) {
+		return 0;
+	}
 	int ret = 0;
 
 	// if we have a drm fd we don't depend on this
@@ -480,10 +761,11 @@ static bool add_signal_matches(struct logind_session *session) {
 }
 
 static int dbus_event(int fd, uint32_t mask, void *data) {
-	sd_bus *bus = data;
-	while (sd_bus_process(bus, NULL) > 0) {
+	struct logind_session *session = data;
+	while (sd_bus_process(session->bus, NULL) > 0) {
 		// Do nothing.
 	}
+	update_event_mask(session);
 	return 1;
 }
 
@@ -648,9 +930,11 @@ static struct wlr_session *logind_session_create(struct wl_display *disp) {
 		goto error_bus;
 	}
 
-	struct wl_event_loop *event_loop = wl_display_get_event_loop(disp);
-	session->event = wl_event_loop_add_fd(event_loop, sd_bus_get_fd(session->bus),
-		WL_EVENT_READABLE, dbus_event, session->bus);
+	wl_list_init(&session->prefetches);
+	wl_list_init(&session->deferred_signals);
+	session->event_loop = wl_display_get_event_loop(disp);
+	session->event = wl_event_loop_add_fd(session->event_loop,
+		sd_bus_get_fd(session->bus), WL_EVENT_READABLE, dbus_event, session);
 
 	if (!session_activate(session)) {
 		goto error_bus;
@@ -680,4 +964,5 @@ const struct session_impl session_logind = {
 	.open = logind_take_device,
 	.close = logind_release_device,
 	.change_vt = logind_change_vt,
+	.prefetch = logind_prefetch_device,
 };
@@ -44,12 +44,23 @@ static int udev_event(int fd, uint32_t mask, void *data) {
 		goto out;
 	}
 
+	struct wlr_device_hotplug_event event = {
+		.session = session,
+	};
+	// Set by the kernel when a single connector has changed
+	const char *connector = udev_device_get_property_value(udev_dev,
+		"CONNECTOR");
+	if (connector != NULL) {
+		event.connector_id = strtoul(connector, NULL, 10);
+	}
+
 	dev_t devnum = udev_device_get_devnum(udev_dev);
 	struct wlr_device *dev;
 
 	wl_list_for_each(dev, &session->devices, link) {
 		if (dev->dev == devnum) {
 			wlr_signal_emit_safe(&dev->signal, session);
+			wlr_signal_emit_safe(&dev->events.hotplug, &event);
 			break;
 		}
 	}
@@ -177,6 +188,7 @@ int wlr_session_open_file(struct wlr_session *session, const char *path) {
 	dev->fd = fd;
 	dev->dev = st.st_rdev;
 	wl_signal_init(&dev->signal);
+	wl_signal_init(&dev->events.hotplug);
 	wl_list_insert(&session->devices, &dev->link);
 
 	return fd;
@@ -186,6 +198,12 @@ error:
 	return fd;
 }
 
+void wlr_session_prefetch_file(struct wlr_session *session, const char *path) {
+	if (session->impl->prefetch != NULL) {
+		session->impl->prefetch(session, path);
+	}
+}
+
 static struct wlr_device *find_device(struct wlr_session *session, int fd) {
 	struct wlr_device *dev;
 
@@ -214,6 +232,13 @@ void wlr_session_signal_add(struct wlr_session *session, int fd,
 	wl_signal_add(&dev->signal, listener);
 }
 
+void wlr_session_hotplug_add(struct wlr_session *session, int fd,
+		struct wl_listener *listener) {
+	struct wlr_device *dev = find_device(session, fd);
+
+	wl_signal_add(&dev->events.hotplug, listener);
+}
+
 bool wlr_session_change_vt(struct wlr_session *session, unsigned vt) {
 	if (!session) {
 		return false;
@@ -277,6 +302,38 @@ static size_t explicit_find_gpus(struct wlr_session *session,
 	return i;
 }
 
+#ifndef __FreeBSD__
+static bool device_is_on_seat(struct wlr_session *session,
+		struct udev_device *dev) {
+	const char *seat = udev_device_get_property_value(dev, "ID_SEAT");
+	if (!seat) {
+		seat = "seat0";
+	}
+	return !session->seat[0] || strcmp(session->seat, seat) == 0;
+}
+
+/* Requests all GPUs at once, since opening them can take a round-trip to the
+ * session manager each.
+ */
+static void prefetch_gpus(struct wlr_session *session,
+		struct udev_enumerate *en) {
+	struct udev_list_entry *entry;
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(en)) {
+		const char *path = udev_list_entry_get_name(entry);
+		struct udev_device *dev = udev_device_new_from_syspath(session->udev, path);
+		if (!dev) {
+			continue;
+		}
+
+		const char *devnode = udev_device_get_devnode(dev);
+		if (devnode && device_is_on_seat(session, dev)) {
+			wlr_session_prefetch_file(session, devnode);
+		}
+		udev_device_unref(dev);
+	}
+}
+#endif
+
 /* Tries to find the primary GPU by checking for the "boot_vga" attribute.
  * If it's not found, it returns the first valid GPU it finds.
  */
@@ -302,6 +359,8 @@ size_t wlr_session_find_gpus(struct wlr_session *session,
 	udev_enumerate_add_match_sysname(en, "card[0-9]*");
 	udev_enumerate_scan_devices(en);
 
+	prefetch_gpus(session, en);
+
 	struct udev_list_entry *entry;
 	size_t i = 0;
 
@@ -318,11 +377,7 @@ size_t wlr_session_find_gpus(struct wlr_session *session,
 			continue;
 		}
 
-		const char *seat = udev_device_get_property_value(dev, "ID_SEAT");
-		if (!seat) {
-			seat = "seat0";
-		}
-		if (session->seat[0] && strcmp(session->seat, seat) != 0) {
+		if (!device_is_on_seat(session, dev)) {
 			udev_device_unref(dev);
 			continue;
 		}
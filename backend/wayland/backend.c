@@ -1,4 +1,6 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <drm_fourcc.h>
 #include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -17,6 +19,8 @@
 #include <wlr/util/log.h>
 
 #include "backend/wayland.h"
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 #include "util/signal.h"
 #include "xdg-shell-client-protocol.h"
 
@@ -58,6 +62,61 @@ static const struct xdg_wm_base_listener xdg_wm_base_listener = {
 	xdg_wm_base_handle_ping,
 };
 
+static void add_dmabuf_format(struct wlr_wl_backend *wl, uint32_t format,
+		uint64_t modifier) {
+	struct wlr_wl_dmabuf_format *fmt =
+		wl_array_add(&wl->dmabuf_formats, sizeof(*fmt));
+	if (fmt == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	fmt->format = format;
+	fmt->modifier = modifier;
+}
+
+static void linux_dmabuf_v1_handle_format(void *data,
+		struct zwp_linux_dmabuf_v1 *linux_dmabuf_v1, uint32_t format) {
+	// Buffers with an implicit modifier
+	add_dmabuf_format(data, format, DRM_FORMAT_MOD_INVALID);
+}
+
+static void linux_dmabuf_v1_handle_modifier(void *data,
+		struct zwp_linux_dmabuf_v1 *linux_dmabuf_v1, uint32_t format,
+		uint32_t modifier_hi, uint32_t modifier_lo) {
+	uint64_t modifier = ((uint64_t)modifier_hi << 32) | modifier_lo;
+	add_dmabuf_format(data, format, modifier);
+}
+
+static const struct zwp_linux_dmabuf_v1_listener linux_dmabuf_v1_listener = {
+	.format = linux_dmabuf_v1_handle_format,
+	.modifier = linux_dmabuf_v1_handle_modifier,
+};
+
+static void shm_handle_format(void *data, struct wl_shm *shm,
+		uint32_t format) {
+	struct wlr_wl_backend *wl = data;
+	uint32_t *fmt = wl_array_add(&wl->shm_formats, sizeof(*fmt));
+	if (fmt == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	*fmt = format;
+}
+
+static const struct wl_shm_listener shm_listener = {
+	.format = shm_handle_format,
+};
+
+static void presentation_handle_clock_id(void *data,
+		struct wp_presentation *presentation, uint32_t clock) {
+	struct wlr_wl_backend *wl = data;
+	wl->presentation_clock = clock;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+	.clock_id = presentation_handle_clock_id,
+};
+
 static void registry_global(void *data, struct wl_registry *registry,
 		uint32_t name, const char *iface, uint32_t version) {
 	struct wlr_wl_backend *wl = data;
@@ -74,6 +133,21 @@ static void registry_global(void *data, struct wl_registry *registry,
 	} else if (strcmp(iface, wl_shm_interface.name) == 0) {
 		wl->shm = wl_registry_bind(registry, name,
 			&wl_shm_interface, 1);
+		wl_shm_add_listener(wl->shm, &shm_listener, wl);
+	} else if (strcmp(iface, wl_subcompositor_interface.name) == 0) {
+		wl->subcompositor = wl_registry_bind(registry, name,
+			&wl_subcompositor_interface, 1);
+	} else if (strcmp(iface, wp_presentation_interface.name) == 0) {
+		wl->presentation = wl_registry_bind(registry, name,
+			&wp_presentation_interface, 1);
+		wp_presentation_add_listener(wl->presentation,
+			&presentation_listener, wl);
+	} else if (strcmp(iface, zwp_linux_dmabuf_v1_interface.name) == 0 &&
+			version >= 3) {
+		wl->zwp_linux_dmabuf_v1 = wl_registry_bind(registry, name,
+			&zwp_linux_dmabuf_v1_interface, 3);
+		zwp_linux_dmabuf_v1_add_listener(wl->zwp_linux_dmabuf_v1,
+			&linux_dmabuf_v1_listener, wl);
 	} else if (strcmp(iface, xdg_wm_base_interface.name) == 0) {
 		wl->xdg_wm_base = wl_registry_bind(registry, name,
 			&xdg_wm_base_interface, 1);
@@ -132,6 +206,11 @@ static void backend_destroy(struct wlr_backend *backend) {
 
 	wlr_signal_emit_safe(&wl->backend.events.destroy, &wl->backend);
 
+	struct wlr_wl_dmabuf_buffer *buffer, *tmp_buffer;
+	wl_list_for_each_safe(buffer, tmp_buffer, &wl->dmabuf_buffers, link) {
+		destroy_wl_dmabuf_buffer(buffer);
+	}
+
 	wl_list_remove(&wl->local_display_destroy.link);
 
 	free(wl->seat_name);
@@ -144,12 +223,26 @@ static void backend_destroy(struct wlr_backend *backend) {
 	if (wl->pointer) {
 		wl_pointer_destroy(wl->pointer);
 	}
+	if (wl->touch) {
+		wl_touch_destroy(wl->touch);
+	}
 	if (wl->seat) {
 		wl_seat_destroy(wl->seat);
 	}
 	if (wl->shm) {
 		wl_shm_destroy(wl->shm);
 	}
+	if (wl->zwp_linux_dmabuf_v1) {
+		zwp_linux_dmabuf_v1_destroy(wl->zwp_linux_dmabuf_v1);
+	}
+	if (wl->subcompositor) {
+		wl_subcompositor_destroy(wl->subcompositor);
+	}
+	if (wl->presentation) {
+		wp_presentation_destroy(wl->presentation);
+	}
+	wl_array_release(&wl->dmabuf_formats);
+	wl_array_release(&wl->shm_formats);
 	xdg_wm_base_destroy(wl->xdg_wm_base);
 	wl_compositor_destroy(wl->compositor);
 	wl_registry_destroy(wl->registry);
@@ -162,10 +255,16 @@ static struct wlr_renderer *backend_get_renderer(struct wlr_backend *backend) {
 	return wl->renderer;
 }
 
+static clockid_t backend_get_presentation_clock(struct wlr_backend *backend) {
+	struct wlr_wl_backend *wl = get_wl_backend_from_backend(backend);
+	return wl->presentation_clock;
+}
+
 static struct wlr_backend_impl backend_impl = {
 	.start = backend_start,
 	.destroy = backend_destroy,
 	.get_renderer = backend_get_renderer,
+	.get_presentation_clock = backend_get_presentation_clock,
 };
 
 bool wlr_backend_is_wl(struct wlr_backend *b) {
@@ -193,6 +292,11 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
 	wl->local_display = display;
 	wl_list_init(&wl->devices);
 	wl_list_init(&wl->outputs);
+	wl_list_init(&wl->touch_points);
+	wl_list_init(&wl->dmabuf_buffers);
+	wl_array_init(&wl->dmabuf_formats);
+	wl_array_init(&wl->shm_formats);
+	wl->presentation_clock = CLOCK_MONOTONIC;
 
 	wl->remote_display = wl_display_connect(remote);
 	if (!wl->remote_display) {
@@ -267,6 +371,17 @@ error_registry:
 	if (wl->xdg_wm_base) {
 		xdg_wm_base_destroy(wl->xdg_wm_base);
 	}
+	if (wl->subcompositor) {
+		wl_subcompositor_destroy(wl->subcompositor);
+	}
+	if (wl->zwp_linux_dmabuf_v1) {
+		zwp_linux_dmabuf_v1_destroy(wl->zwp_linux_dmabuf_v1);
+	}
+	if (wl->presentation) {
+		wp_presentation_destroy(wl->presentation);
+	}
+	wl_array_release(&wl->dmabuf_formats);
+	wl_array_release(&wl->shm_formats);
 	wl_registry_destroy(wl->registry);
 error_display:
 	wl_display_disconnect(wl->remote_display);
@@ -15,10 +15,11 @@
 #include <wlr/util/log.h>
 
 #include "backend/wayland.h"
+#include "presentation-time-client-protocol.h"
 #include "util/signal.h"
 #include "xdg-shell-client-protocol.h"
 
-static struct wlr_wl_output *get_wl_output_from_output(
+struct wlr_wl_output *get_wl_output_from_output(
 		struct wlr_output *wlr_output) {
 	assert(wlr_output_is_wl(wlr_output));
 	return (struct wlr_wl_output *)wlr_output;
@@ -58,26 +59,96 @@ static bool output_make_current(struct wlr_output *wlr_output,
 		buffer_age);
 }
 
+static void presentation_feedback_destroy(
+		struct wlr_wl_presentation_feedback *feedback) {
+	wl_list_remove(&feedback->link);
+	wp_presentation_feedback_destroy(feedback->feedback);
+	free(feedback);
+}
+
+static void presentation_feedback_handle_sync_output(void *data,
+		struct wp_presentation_feedback *feedback, struct wl_output *output) {
+	// This is one of our own windows
+}
+
+static void presentation_feedback_handle_presented(void *data,
+		struct wp_presentation_feedback *wp_feedback, uint32_t tv_sec_hi,
+		uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh_ns,
+		uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+	struct wlr_wl_presentation_feedback *feedback = data;
+
+	struct timespec t = {
+		.tv_sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo,
+		.tv_nsec = tv_nsec,
+	};
+	// The flags have the same values as the protocol ones
+	struct wlr_output_event_present event = {
+		.when = &t,
+		.seq = ((uint64_t)seq_hi << 32) | seq_lo,
+		.refresh = refresh_ns,
+		.flags = flags,
+	};
+	wlr_output_send_present(&feedback->output->wlr_output, &event);
+
+	presentation_feedback_destroy(feedback);
+}
+
+static void presentation_feedback_handle_discarded(void *data,
+		struct wp_presentation_feedback *wp_feedback) {
+	struct wlr_wl_presentation_feedback *feedback = data;
+	// The frame has never been shown, its content will be presented with the
+	// next one
+	presentation_feedback_destroy(feedback);
+}
+
+static const struct wp_presentation_feedback_listener
+		presentation_feedback_listener = {
+	.sync_output = presentation_feedback_handle_sync_output,
+	.presented = presentation_feedback_handle_presented,
+	.discarded = presentation_feedback_handle_discarded,
+};
+
 static bool output_swap_buffers(struct wlr_output *wlr_output,
 		pixman_region32_t *damage) {
 	struct wlr_wl_output *output =
 		get_wl_output_from_output(wlr_output);
+	struct wlr_wl_backend *backend = output->backend;
 
 	if (output->frame_callback != NULL) {
 		wlr_log(WLR_ERROR, "Skipping buffer swap");
 		return false;
 	}
 
+	// Applies to the commit made by the buffer swap
+	struct wlr_wl_presentation_feedback *feedback = NULL;
+	if (backend->presentation != NULL) {
+		feedback = calloc(1, sizeof(struct wlr_wl_presentation_feedback));
+		if (feedback == NULL) {
+			wlr_log(WLR_ERROR, "Allocation failed");
+			return false;
+		}
+		feedback->output = output;
+		feedback->feedback =
+			wp_presentation_feedback(backend->presentation, output->surface);
+		wp_presentation_feedback_add_listener(feedback->feedback,
+			&presentation_feedback_listener, feedback);
+		wl_list_insert(&output->presentation_feedbacks, &feedback->link);
+	}
+
 	output->frame_callback = wl_surface_frame(output->surface);
 	wl_callback_add_listener(output->frame_callback, &frame_listener, output);
 
-	if (!wlr_egl_swap_buffers(&output->backend->egl,
-			output->egl_surface, damage)) {
+	if (!wlr_egl_swap_buffers(&backend->egl, output->egl_surface, damage)) {
+		if (feedback != NULL) {
+			presentation_feedback_destroy(feedback);
+		}
 		return false;
 	}
 
-	// TODO: if available, use the presentation-time protocol
-	wlr_output_send_present(wlr_output, NULL);
+	if (feedback == NULL) {
+		// The parent compositor doesn't support presentation-time
+		wlr_output_send_present(wlr_output, NULL);
+	}
 	return true;
 }
 
@@ -170,6 +241,18 @@ static void output_destroy(struct wlr_output *wlr_output) {
 
 	wl_list_remove(&output->link);
 
+	struct wlr_wl_subsurface *subsurface, *tmp_subsurface;
+	wl_list_for_each_safe(subsurface, tmp_subsurface, &output->subsurfaces,
+			link) {
+		wlr_wl_subsurface_destroy(subsurface);
+	}
+
+	struct wlr_wl_presentation_feedback *feedback, *tmp_feedback;
+	wl_list_for_each_safe(feedback, tmp_feedback,
+			&output->presentation_feedbacks, link) {
+		presentation_feedback_destroy(feedback);
+	}
+
 	if (output->cursor.egl_window != NULL) {
 		wl_egl_window_destroy(output->cursor.egl_window);
 	}
@@ -286,6 +369,8 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *wlr_backend) {
 	wlr_output_init(&output->wlr_output, &backend->backend, &output_impl,
 		backend->local_display);
 	struct wlr_output *wlr_output = &output->wlr_output;
+	wl_list_init(&output->subsurfaces);
+	wl_list_init(&output->presentation_feedbacks);
 
 	wlr_output_update_custom_mode(wlr_output, 1280, 720, 0);
 	strncpy(wlr_output->make, "wayland", sizeof(wlr_output->make));
@@ -356,6 +441,9 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *wlr_backend) {
 	if (backend->pointer != NULL) {
 		create_wl_pointer(backend->pointer, output);
 	}
+	if (backend->touch != NULL) {
+		create_wl_touch(backend->touch, output);
+	}
 
 	return wlr_output;
 
@@ -0,0 +1,474 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wayland-client.h>
+
+#include <wlr/interfaces/wlr_output.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+
+#include "backend/wayland.h"
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "util/shm.h"
+#include "util/signal.h"
+
+static void subsurface_update(struct wlr_wl_subsurface *subsurface);
+
+void destroy_wl_dmabuf_buffer(struct wlr_wl_dmabuf_buffer *buffer) {
+	wl_list_remove(&buffer->resource_destroy.link);
+	wl_list_remove(&buffer->link);
+	if (buffer->params != NULL) {
+		zwp_linux_buffer_params_v1_destroy(buffer->params);
+	}
+	if (buffer->wl_buffer != NULL) {
+		wl_buffer_destroy(buffer->wl_buffer);
+	}
+	if (buffer->locked != NULL) {
+		wlr_buffer_unref(buffer->locked);
+	}
+	free(buffer);
+}
+
+static void dmabuf_buffer_handle_release(void *data,
+		struct wl_buffer *wl_buffer) {
+	struct wlr_wl_dmabuf_buffer *buffer = data;
+	if (buffer->locked != NULL) {
+		wlr_buffer_unref(buffer->locked);
+		buffer->locked = NULL;
+	}
+}
+
+static const struct wl_buffer_listener dmabuf_buffer_listener = {
+	.release = dmabuf_buffer_handle_release,
+};
+
+static void dmabuf_params_handle_created(void *data,
+		struct zwp_linux_buffer_params_v1 *params,
+		struct wl_buffer *wl_buffer) {
+	struct wlr_wl_dmabuf_buffer *buffer = data;
+	zwp_linux_buffer_params_v1_destroy(buffer->params);
+	buffer->params = NULL;
+	buffer->wl_buffer = wl_buffer;
+	wl_buffer_add_listener(buffer->wl_buffer, &dmabuf_buffer_listener,
+		buffer);
+
+	// The import is asynchronous: the subsurfaces showing this buffer have
+	// been rendered by the compositor so far, forward it now
+	struct wlr_wl_output *output;
+	wl_list_for_each(output, &buffer->backend->outputs, link) {
+		struct wlr_wl_subsurface *subsurface;
+		wl_list_for_each(subsurface, &output->subsurfaces, link) {
+			struct wlr_buffer *current = subsurface->surface->buffer;
+			if (current == NULL || current->resource != buffer->resource) {
+				continue;
+			}
+			bool forwarded = subsurface->forwarded;
+			subsurface_update(subsurface);
+			if (!forwarded && subsurface->forwarded) {
+				// The compositor must stop rendering the surface itself
+				wlr_output_damage_whole(subsurface->output);
+			}
+		}
+	}
+}
+
+static void dmabuf_params_handle_failed(void *data,
+		struct zwp_linux_buffer_params_v1 *params) {
+	struct wlr_wl_dmabuf_buffer *buffer = data;
+	wlr_log(WLR_DEBUG, "Parent compositor failed to import DMA-BUF, "
+		"falling back to rendering");
+	zwp_linux_buffer_params_v1_destroy(buffer->params);
+	buffer->params = NULL;
+}
+
+static const struct zwp_linux_buffer_params_v1_listener
+	dmabuf_params_listener = {
+	.created = dmabuf_params_handle_created,
+	.failed = dmabuf_params_handle_failed,
+};
+
+static void dmabuf_buffer_handle_resource_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_wl_dmabuf_buffer *buffer =
+		wl_container_of(listener, buffer, resource_destroy);
+	destroy_wl_dmabuf_buffer(buffer);
+}
+
+static bool backend_supports_dmabuf(struct wlr_wl_backend *wl,
+		const struct wlr_dmabuf_attributes *attribs) {
+	struct wlr_wl_dmabuf_format *fmt;
+	wl_array_for_each(fmt, &wl->dmabuf_formats) {
+		if (fmt->format == attribs->format &&
+				fmt->modifier == attribs->modifier) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static struct wl_buffer *get_dmabuf_buffer(struct wlr_wl_backend *wl,
+		struct wlr_buffer *wlr_buffer) {
+	struct wl_listener *listener = wl_resource_get_destroy_listener(
+		wlr_buffer->resource, dmabuf_buffer_handle_resource_destroy);
+	struct wlr_wl_dmabuf_buffer *buffer;
+	if (listener != NULL) {
+		buffer = wl_container_of(listener, buffer, resource_destroy);
+	} else {
+		struct wlr_dmabuf_v1_buffer *dmabuf =
+			wlr_dmabuf_v1_buffer_from_buffer_resource(wlr_buffer->resource);
+		struct wlr_dmabuf_attributes *attribs = &dmabuf->attributes;
+		if (wl->zwp_linux_dmabuf_v1 == NULL ||
+				!backend_supports_dmabuf(wl, attribs)) {
+			return NULL;
+		}
+
+		buffer = calloc(1, sizeof(struct wlr_wl_dmabuf_buffer));
+		if (buffer == NULL) {
+			wlr_log(WLR_ERROR, "Allocation failed");
+			return NULL;
+		}
+
+		// Failures are reported with an event rather than with a protocol
+		// error, which would disconnect the whole backend
+		buffer->params =
+			zwp_linux_dmabuf_v1_create_params(wl->zwp_linux_dmabuf_v1);
+		zwp_linux_buffer_params_v1_add_listener(buffer->params,
+			&dmabuf_params_listener, buffer);
+		for (int i = 0; i < attribs->n_planes; ++i) {
+			zwp_linux_buffer_params_v1_add(buffer->params, attribs->fd[i], i,
+				attribs->offset[i], attribs->stride[i],
+				attribs->modifier >> 32, attribs->modifier & 0xFFFFFFFF);
+		}
+		// The attributes flags have the same values as the protocol ones
+		zwp_linux_buffer_params_v1_create(buffer->params, attribs->width,
+			attribs->height, attribs->format, attribs->flags);
+
+		buffer->backend = wl;
+		buffer->resource = wlr_buffer->resource;
+		buffer->resource_destroy.notify = dmabuf_buffer_handle_resource_destroy;
+		wl_resource_add_destroy_listener(wlr_buffer->resource,
+			&buffer->resource_destroy);
+		wl_list_insert(&wl->dmabuf_buffers, &buffer->link);
+	}
+
+	if (buffer->wl_buffer == NULL) {
+		// Still being imported, or failed to
+		return NULL;
+	}
+
+	// The client must not reuse the buffer while the parent compositor reads
+	// from it
+	if (buffer->locked != wlr_buffer) {
+		wlr_buffer_ref(wlr_buffer);
+		if (buffer->locked != NULL) {
+			wlr_buffer_unref(buffer->locked);
+		}
+		buffer->locked = wlr_buffer;
+	}
+	return buffer->wl_buffer;
+}
+
+static void shm_buffer_destroy(struct wlr_wl_shm_buffer *buffer) {
+	wl_list_remove(&buffer->link);
+	wl_buffer_destroy(buffer->wl_buffer);
+	munmap(buffer->data, buffer->stride * buffer->height);
+	free(buffer);
+}
+
+static void shm_buffer_handle_release(void *data,
+		struct wl_buffer *wl_buffer) {
+	struct wlr_wl_shm_buffer *buffer = data;
+	buffer->busy = false;
+}
+
+static const struct wl_buffer_listener shm_buffer_listener = {
+	.release = shm_buffer_handle_release,
+};
+
+static bool backend_supports_shm(struct wlr_wl_backend *wl, uint32_t format) {
+	uint32_t *fmt;
+	wl_array_for_each(fmt, &wl->shm_formats) {
+		if (*fmt == format) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static struct wlr_wl_shm_buffer *shm_buffer_create(struct wlr_wl_backend *wl,
+		int32_t width, int32_t height, int32_t stride, uint32_t format) {
+	struct wlr_wl_shm_buffer *buffer =
+		calloc(1, sizeof(struct wlr_wl_shm_buffer));
+	if (buffer == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	size_t size = stride * height;
+	int fd = allocate_shm_file(size);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create shm file");
+		free(buffer);
+		return NULL;
+	}
+
+	buffer->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (buffer->data == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "mmap failed");
+		close(fd);
+		free(buffer);
+		return NULL;
+	}
+
+	struct wl_shm_pool *pool = wl_shm_create_pool(wl->shm, fd, size);
+	buffer->wl_buffer =
+		wl_shm_pool_create_buffer(pool, 0, width, height, stride, format);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	buffer->width = width;
+	buffer->height = height;
+	buffer->stride = stride;
+	buffer->format = format;
+	wl_buffer_add_listener(buffer->wl_buffer, &shm_buffer_listener, buffer);
+	return buffer;
+}
+
+/**
+ * The client's shared memory pool can't be shared with the parent compositor,
+ * so its content is copied to one of our own buffers.
+ */
+static struct wl_buffer *subsurface_get_shm_buffer(
+		struct wlr_wl_subsurface *subsurface,
+		struct wl_shm_buffer *shm_buf) {
+	struct wlr_wl_backend *wl =
+		get_wl_backend_from_backend(subsurface->output->backend);
+	int32_t width = wl_shm_buffer_get_width(shm_buf);
+	int32_t height = wl_shm_buffer_get_height(shm_buf);
+	int32_t stride = wl_shm_buffer_get_stride(shm_buf);
+	uint32_t format = wl_shm_buffer_get_format(shm_buf);
+	if (wl->shm == NULL || !backend_supports_shm(wl, format)) {
+		return NULL;
+	}
+
+	struct wlr_wl_shm_buffer *buffer = NULL, *b, *tmp;
+	wl_list_for_each_safe(b, tmp, &subsurface->shm_buffers, link) {
+		if (b->busy) {
+			continue;
+		}
+		if (b->width == width && b->height == height &&
+				b->stride == stride && b->format == format) {
+			buffer = b;
+			break;
+		}
+		// Buffers from before a resize won't be used anymore
+		shm_buffer_destroy(b);
+	}
+
+	if (buffer == NULL) {
+		buffer = shm_buffer_create(wl, width, height, stride, format);
+		if (buffer == NULL) {
+			return NULL;
+		}
+		wl_list_insert(&subsurface->shm_buffers, &buffer->link);
+	}
+
+	wl_shm_buffer_begin_access(shm_buf);
+	memcpy(buffer->data, wl_shm_buffer_get_data(shm_buf), stride * height);
+	wl_shm_buffer_end_access(shm_buf);
+
+	buffer->busy = true;
+	return buffer->wl_buffer;
+}
+
+static void subsurface_frame_callback(void *data, struct wl_callback *cb,
+		uint32_t time) {
+	struct wlr_wl_subsurface *subsurface = data;
+	wl_callback_destroy(cb);
+	subsurface->frame_callback = NULL;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wlr_surface_send_frame_done(subsurface->surface, &now);
+}
+
+static const struct wl_callback_listener subsurface_frame_listener = {
+	.done = subsurface_frame_callback,
+};
+
+static struct wl_buffer *subsurface_get_buffer(
+		struct wlr_wl_subsurface *subsurface) {
+	struct wlr_output *output = subsurface->output;
+	if (output->scale != 1 || output->transform != WL_OUTPUT_TRANSFORM_NORMAL) {
+		// The output's window uses buffer coordinates
+		return NULL;
+	}
+	struct wlr_surface_state *current = &subsurface->surface->current;
+	if (current->viewport.has_src || current->viewport.has_dst) {
+		// The viewport is applied by the compositor
+		return NULL;
+	}
+
+	struct wlr_buffer *buffer = subsurface->surface->buffer;
+	if (buffer->resource == NULL) {
+		return NULL;
+	}
+
+	struct wlr_wl_backend *wl = get_wl_backend_from_backend(output->backend);
+	struct wl_shm_buffer *shm_buf;
+	if (wlr_dmabuf_v1_resource_is_buffer(buffer->resource)) {
+		return get_dmabuf_buffer(wl, buffer);
+	} else if ((shm_buf = wl_shm_buffer_get(buffer->resource)) != NULL) {
+		return subsurface_get_shm_buffer(subsurface, shm_buf);
+	}
+	return NULL;
+}
+
+static void subsurface_update(struct wlr_wl_subsurface *subsurface) {
+	struct wlr_surface *surface = subsurface->surface;
+	struct wlr_wl_backend *wl =
+		get_wl_backend_from_backend(subsurface->output->backend);
+
+	struct wl_buffer *wl_buffer = NULL;
+	if (surface->buffer != NULL) {
+		wl_buffer = subsurface_get_buffer(subsurface);
+	}
+
+	if (wl_buffer == NULL) {
+		// Unmapped, or to be rendered by the compositor
+		subsurface->forwarded = surface->buffer == NULL;
+		wl_surface_attach(subsurface->wl_surface, NULL, 0, 0);
+		wl_surface_commit(subsurface->wl_surface);
+		wl_display_flush(wl->remote_display);
+		return;
+	}
+	subsurface->forwarded = true;
+
+	wl_surface_attach(subsurface->wl_surface, wl_buffer, 0, 0);
+	wl_surface_set_buffer_scale(subsurface->wl_surface, surface->current.scale);
+	wl_surface_set_buffer_transform(subsurface->wl_surface,
+		surface->current.transform);
+
+	int nrects;
+	pixman_box32_t *rects =
+		pixman_region32_rectangles(&surface->buffer_damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		wl_surface_damage_buffer(subsurface->wl_surface, rects[i].x1,
+			rects[i].y1, rects[i].x2 - rects[i].x1, rects[i].y2 - rects[i].y1);
+	}
+
+	// Let the parent compositor throttle the client
+	if (subsurface->frame_callback == NULL) {
+		subsurface->frame_callback = wl_surface_frame(subsurface->wl_surface);
+		wl_callback_add_listener(subsurface->frame_callback,
+			&subsurface_frame_listener, subsurface);
+	}
+
+	wl_surface_commit(subsurface->wl_surface);
+	wl_display_flush(wl->remote_display);
+}
+
+static void subsurface_handle_surface_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_wl_subsurface *subsurface =
+		wl_container_of(listener, subsurface, surface_commit);
+	subsurface_update(subsurface);
+}
+
+static void subsurface_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_wl_subsurface *subsurface =
+		wl_container_of(listener, subsurface, surface_destroy);
+	wlr_wl_subsurface_destroy(subsurface);
+}
+
+struct wlr_wl_subsurface *wlr_wl_output_create_subsurface(
+		struct wlr_output *wlr_output, struct wlr_surface *surface) {
+	struct wlr_wl_output *output = get_wl_output_from_output(wlr_output);
+	struct wlr_wl_backend *wl = output->backend;
+	if (wl->subcompositor == NULL) {
+		wlr_log(WLR_DEBUG,
+			"Remote Wayland compositor does not support wl_subcompositor");
+		return NULL;
+	}
+
+	struct wlr_wl_subsurface *subsurface =
+		calloc(1, sizeof(struct wlr_wl_subsurface));
+	if (subsurface == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	subsurface->output = wlr_output;
+	subsurface->surface = surface;
+	wl_signal_init(&subsurface->events.destroy);
+	wl_list_init(&subsurface->shm_buffers);
+
+	subsurface->wl_surface = wl_compositor_create_surface(wl->compositor);
+	subsurface->wl_subsurface = wl_subcompositor_get_subsurface(
+		wl->subcompositor, subsurface->wl_surface, output->surface);
+	// Forwarded buffers are shown right away instead of waiting for the
+	// next frame of the output
+	wl_subsurface_set_desync(subsurface->wl_subsurface);
+
+	// Input events are received by the output's window
+	struct wl_region *input_region =
+		wl_compositor_create_region(wl->compositor);
+	wl_surface_set_input_region(subsurface->wl_surface, input_region);
+	wl_region_destroy(input_region);
+
+	subsurface->surface_commit.notify = subsurface_handle_surface_commit;
+	wl_signal_add(&surface->events.commit, &subsurface->surface_commit);
+	subsurface->surface_destroy.notify = subsurface_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &subsurface->surface_destroy);
+
+	wl_list_insert(output->subsurfaces.prev, &subsurface->link);
+
+	subsurface_update(subsurface);
+	return subsurface;
+}
+
+void wlr_wl_subsurface_set_position(struct wlr_wl_subsurface *subsurface,
+		int x, int y) {
+	if (subsurface->x == x && subsurface->y == y) {
+		return;
+	}
+	subsurface->x = x;
+	subsurface->y = y;
+
+	struct wlr_wl_output *output = get_wl_output_from_output(subsurface->output);
+	wl_subsurface_set_position(subsurface->wl_subsurface, x, y);
+	// The position is applied on the next commit of the output's window
+	wl_surface_commit(output->surface);
+	wl_display_flush(output->backend->remote_display);
+}
+
+void wlr_wl_subsurface_destroy(struct wlr_wl_subsurface *subsurface) {
+	if (subsurface == NULL) {
+		return;
+	}
+
+	wlr_signal_emit_safe(&subsurface->events.destroy, subsurface);
+
+	wl_list_remove(&subsurface->surface_commit.link);
+	wl_list_remove(&subsurface->surface_destroy.link);
+	wl_list_remove(&subsurface->link);
+
+	struct wlr_wl_shm_buffer *buffer, *tmp;
+	wl_list_for_each_safe(buffer, tmp, &subsurface->shm_buffers, link) {
+		shm_buffer_destroy(buffer);
+	}
+	if (subsurface->frame_callback != NULL) {
+		wl_callback_destroy(subsurface->frame_callback);
+	}
+	wl_subsurface_destroy(subsurface->wl_subsurface);
+	wl_surface_destroy(subsurface->wl_surface);
+	free(subsurface);
+}
@@ -189,9 +189,30 @@ static const struct wl_pointer_listener pointer_listener = {
 	.axis_discrete = pointer_handle_axis_discrete,
 };
 
-static void keyboard_handle_keymap(void *data, struct wl_keyboard *wl_keyboard,
-		uint32_t format, int32_t fd, uint32_t size) {
-	// TODO: set keymap
+static struct wlr_wl_touch *output_get_touch(struct wlr_wl_output *output) {
+	struct wlr_input_device *wlr_dev;
+	wl_list_for_each(wlr_dev, &output->backend->devices, link) {
+		if (wlr_dev->type != WLR_INPUT_DEVICE_TOUCH) {
+			continue;
+		}
+		struct wlr_wl_touch *touch = touch_get_wl(wlr_dev->touch);
+		if (touch->output == output) {
+			return touch;
+		}
+	}
+
+	return NULL;
+}
+
+static struct wlr_wl_touch_point *backend_get_touch_point(
+		struct wlr_wl_backend *backend, int32_t id) {
+	struct wlr_wl_touch_point *point;
+	wl_list_for_each(point, &backend->touch_points, link) {
+		if (point->id == id) {
+			return point;
+		}
+	}
+	return NULL;
 }
 
 static uint32_t get_current_time_msec(void) {
@@ -200,6 +221,141 @@ static uint32_t get_current_time_msec(void) {
 	return now.tv_nsec / 1000;
 }
 
+static void touch_point_destroy(struct wlr_wl_touch_point *point) {
+	wl_list_remove(&point->link);
+	free(point);
+}
+
+static void touch_handle_down(void *data, struct wl_touch *wl_touch,
+		uint32_t serial, uint32_t time, struct wl_surface *surface,
+		int32_t id, wl_fixed_t x, wl_fixed_t y) {
+	struct wlr_wl_backend *backend = data;
+	if (surface == NULL) {
+		return;
+	}
+
+	struct wlr_wl_output *output = wl_surface_get_user_data(surface);
+	assert(output);
+	struct wlr_wl_touch *touch = output_get_touch(output);
+	if (touch == NULL) {
+		return;
+	}
+
+	struct wlr_wl_touch_point *point = calloc(1, sizeof(*point));
+	if (point == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	point->id = id;
+	point->touch = touch;
+	wl_list_insert(&backend->touch_points, &point->link);
+
+	struct wlr_output *wlr_output = &output->wlr_output;
+	struct wlr_event_touch_down event = {
+		.device = &touch->input_device->wlr_input_device,
+		.time_msec = time,
+		.touch_id = id,
+		.x = wl_fixed_to_double(x) / wlr_output->width,
+		.y = wl_fixed_to_double(y) / wlr_output->height,
+	};
+	touch->needs_frame = true;
+	wlr_signal_emit_safe(&touch->wlr_touch.events.down, &event);
+}
+
+static void touch_handle_up(void *data, struct wl_touch *wl_touch,
+		uint32_t serial, uint32_t time, int32_t id) {
+	struct wlr_wl_backend *backend = data;
+	struct wlr_wl_touch_point *point = backend_get_touch_point(backend, id);
+	if (point == NULL) {
+		return;
+	}
+
+	struct wlr_wl_touch *touch = point->touch;
+	touch_point_destroy(point);
+
+	struct wlr_event_touch_up event = {
+		.device = &touch->input_device->wlr_input_device,
+		.time_msec = time,
+		.touch_id = id,
+	};
+	touch->needs_frame = true;
+	wlr_signal_emit_safe(&touch->wlr_touch.events.up, &event);
+}
+
+static void touch_handle_motion(void *data, struct wl_touch *wl_touch,
+		uint32_t time, int32_t id, wl_fixed_t x, wl_fixed_t y) {
+	struct wlr_wl_backend *backend = data;
+	struct wlr_wl_touch_point *point = backend_get_touch_point(backend, id);
+	if (point == NULL) {
+		return;
+	}
+
+	struct wlr_wl_touch *touch = point->touch;
+	struct wlr_output *wlr_output = &touch->output->wlr_output;
+	struct wlr_event_touch_motion event = {
+		.device = &touch->input_device->wlr_input_device,
+		.time_msec = time,
+		.touch_id = id,
+		.x = wl_fixed_to_double(x) / wlr_output->width,
+		.y = wl_fixed_to_double(y) / wlr_output->height,
+	};
+	touch->needs_frame = true;
+	wlr_signal_emit_safe(&touch->wlr_touch.events.motion, &event);
+}
+
+static void touch_handle_frame(void *data, struct wl_touch *wl_touch) {
+	struct wlr_wl_backend *backend = data;
+
+	struct wlr_input_device *wlr_dev;
+	wl_list_for_each(wlr_dev, &backend->devices, link) {
+		if (wlr_dev->type != WLR_INPUT_DEVICE_TOUCH) {
+			continue;
+		}
+		struct wlr_wl_touch *touch = touch_get_wl(wlr_dev->touch);
+		if (!touch->needs_frame) {
+			continue;
+		}
+		touch->needs_frame = false;
+		wlr_signal_emit_safe(&touch->wlr_touch.events.frame,
+			&touch->wlr_touch);
+	}
+}
+
+static void touch_handle_cancel(void *data, struct wl_touch *wl_touch) {
+	struct wlr_wl_backend *backend = data;
+
+	// The parent compositor doesn't send a time for cancel events
+	uint32_t time = get_current_time_msec();
+
+	struct wlr_wl_touch_point *point, *tmp;
+	wl_list_for_each_safe(point, tmp, &backend->touch_points, link) {
+		struct wlr_wl_touch *touch = point->touch;
+		struct wlr_event_touch_cancel event = {
+			.device = &touch->input_device->wlr_input_device,
+			.time_msec = time,
+			.touch_id = point->id,
+		};
+		touch_point_destroy(point);
+		touch->needs_frame = true;
+		wlr_signal_emit_safe(&touch->wlr_touch.events.cancel, &event);
+	}
+
+	touch_handle_frame(data, wl_touch);
+}
+
+static const struct wl_touch_listener touch_listener = {
+	.down = touch_handle_down,
+	.up = touch_handle_up,
+	.motion = touch_handle_motion,
+	.frame = touch_handle_frame,
+	.cancel = touch_handle_cancel,
+};
+
+static void keyboard_handle_keymap(void *data, struct wl_keyboard *wl_keyboard,
+		uint32_t format, int32_t fd, uint32_t size) {
+	// TODO: set keymap
+}
+
 static void keyboard_handle_enter(void *data, struct wl_keyboard *wl_keyboard,
 		uint32_t serial, struct wl_surface *surface, struct wl_array *keys) {
 	struct wlr_input_device *dev = data;
@@ -410,6 +566,74 @@ void create_wl_keyboard(struct wl_keyboard *wl_keyboard, struct wlr_wl_backend *
 	wlr_signal_emit_safe(&wl->backend.events.new_input, wlr_dev);
 }
 
+static struct wlr_touch_impl touch_impl;
+
+struct wlr_wl_touch *touch_get_wl(struct wlr_touch *wlr_touch) {
+	assert(wlr_touch->impl == &touch_impl);
+	return (struct wlr_wl_touch *)wlr_touch;
+}
+
+static void touch_destroy(struct wlr_touch *wlr_touch) {
+	struct wlr_wl_touch *touch = touch_get_wl(wlr_touch);
+	struct wlr_wl_backend *backend = touch->input_device->backend;
+
+	struct wlr_wl_touch_point *point, *tmp;
+	wl_list_for_each_safe(point, tmp, &backend->touch_points, link) {
+		if (point->touch == touch) {
+			touch_point_destroy(point);
+		}
+	}
+
+	wl_list_remove(&touch->output_destroy.link);
+	free(touch);
+}
+
+static struct wlr_touch_impl touch_impl = {
+	.destroy = touch_destroy,
+};
+
+static void touch_handle_output_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_wl_touch *touch =
+		wl_container_of(listener, touch, output_destroy);
+	wlr_input_device_destroy(&touch->input_device->wlr_input_device);
+}
+
+void create_wl_touch(struct wl_touch *wl_touch, struct wlr_wl_output *output) {
+	struct wlr_wl_backend *backend = output->backend;
+
+	if (output_get_touch(output) != NULL) {
+		return;
+	}
+
+	struct wlr_wl_touch *touch = calloc(1, sizeof(struct wlr_wl_touch));
+	if (touch == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	touch->output = output;
+
+	wl_signal_add(&output->wlr_output.events.destroy, &touch->output_destroy);
+	touch->output_destroy.notify = touch_handle_output_destroy;
+
+	struct wlr_wl_input_device *dev =
+		create_wl_input_device(backend, WLR_INPUT_DEVICE_TOUCH);
+	if (dev == NULL) {
+		wl_list_remove(&touch->output_destroy.link);
+		free(touch);
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	touch->input_device = dev;
+
+	struct wlr_input_device *wlr_dev = &dev->wlr_input_device;
+	wlr_dev->touch = &touch->wlr_touch;
+	wlr_dev->output_name = strdup(output->wlr_output.name);
+	wlr_touch_init(wlr_dev->touch, &touch_impl);
+
+	wlr_signal_emit_safe(&backend->backend.events.new_input, wlr_dev);
+}
+
 static void seat_handle_capabilities(void *data, struct wl_seat *wl_seat,
 		enum wl_seat_capability caps) {
 	struct wlr_wl_backend *backend = data;
@@ -438,6 +662,19 @@ static void seat_handle_capabilities(void *data, struct wl_seat *wl_seat,
 			create_wl_keyboard(wl_keyboard, backend);
 		}
 	}
+	if ((caps & WL_SEAT_CAPABILITY_TOUCH)) {
+		wlr_log(WLR_DEBUG, "seat %p offered touch", (void*) wl_seat);
+
+		struct wl_touch *wl_touch = wl_seat_get_touch(wl_seat);
+		backend->touch = wl_touch;
+
+		struct wlr_wl_output *output;
+		wl_list_for_each(output, &backend->outputs, link) {
+			create_wl_touch(wl_touch, output);
+		}
+
+		wl_touch_add_listener(wl_touch, &touch_listener, backend);
+	}
 }
 
 static void seat_handle_name(void *data, struct wl_seat *wl_seat,
@@ -250,7 +250,7 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 	x11->xinput_opcode = ext->major_opcode;
 
 	xcb_input_xi_query_version_cookie_t xi_cookie =
-		xcb_input_xi_query_version(x11->xcb, 2, 0);
+		xcb_input_xi_query_version(x11->xcb, 2, 2);
 	xcb_input_xi_query_version_reply_t *xi_reply =
 		xcb_input_xi_query_version_reply(x11->xcb, xi_cookie, NULL);
 
@@ -259,6 +259,8 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 		free(xi_reply);
 		goto error_display;
 	}
+	x11->has_touch = xi_reply->major_version > 2 ||
+		xi_reply->minor_version >= 2;
 	free(xi_reply);
 
 	int fd = xcb_get_file_descriptor(x11->xcb);
@@ -11,6 +11,7 @@
 #include <wlr/interfaces/wlr_input_device.h>
 #include <wlr/interfaces/wlr_keyboard.h>
 #include <wlr/interfaces/wlr_pointer.h>
+#include <wlr/interfaces/wlr_touch.h>
 #include <wlr/util/log.h>
 
 #include "backend/x11.h"
@@ -65,6 +66,43 @@ static void send_pointer_position_event(struct wlr_x11_output *output,
 	wlr_signal_emit_safe(&output->pointer.events.frame, &output->pointer);
 }
 
+static void send_touch_down_event(struct wlr_x11_output *output,
+		int32_t touch_id, int16_t x, int16_t y, xcb_timestamp_t time) {
+	struct wlr_event_touch_down ev = {
+		.device = &output->touch_dev,
+		.time_msec = time,
+		.touch_id = touch_id,
+		.x = (double)x / output->wlr_output.width,
+		.y = (double)y / output->wlr_output.height,
+	};
+	wlr_signal_emit_safe(&output->touch.events.down, &ev);
+	wlr_signal_emit_safe(&output->touch.events.frame, &output->touch);
+}
+
+static void send_touch_motion_event(struct wlr_x11_output *output,
+		int32_t touch_id, int16_t x, int16_t y, xcb_timestamp_t time) {
+	struct wlr_event_touch_motion ev = {
+		.device = &output->touch_dev,
+		.time_msec = time,
+		.touch_id = touch_id,
+		.x = (double)x / output->wlr_output.width,
+		.y = (double)y / output->wlr_output.height,
+	};
+	wlr_signal_emit_safe(&output->touch.events.motion, &ev);
+	wlr_signal_emit_safe(&output->touch.events.frame, &output->touch);
+}
+
+static void send_touch_up_event(struct wlr_x11_output *output,
+		int32_t touch_id, xcb_timestamp_t time) {
+	struct wlr_event_touch_up ev = {
+		.device = &output->touch_dev,
+		.time_msec = time,
+		.touch_id = touch_id,
+	};
+	wlr_signal_emit_safe(&output->touch.events.up, &ev);
+	wlr_signal_emit_safe(&output->touch.events.frame, &output->touch);
+}
+
 void handle_x11_xinput_event(struct wlr_x11_backend *x11,
 		xcb_ge_generic_event_t *event) {
 	struct wlr_x11_output *output;
@@ -163,6 +201,46 @@ void handle_x11_xinput_event(struct wlr_x11_backend *x11,
 		x11->time = ev->time;
 		break;
 	}
+	case XCB_INPUT_TOUCH_BEGIN: {
+		xcb_input_touch_begin_event_t *ev =
+			(xcb_input_touch_begin_event_t *)event;
+
+		output = get_x11_output_from_window_id(x11, ev->event);
+		if (!output) {
+			return;
+		}
+
+		send_touch_down_event(output, ev->detail, ev->event_x >> 16,
+			ev->event_y >> 16, ev->time);
+		x11->time = ev->time;
+		break;
+	}
+	case XCB_INPUT_TOUCH_UPDATE: {
+		xcb_input_touch_update_event_t *ev =
+			(xcb_input_touch_update_event_t *)event;
+
+		output = get_x11_output_from_window_id(x11, ev->event);
+		if (!output) {
+			return;
+		}
+
+		send_touch_motion_event(output, ev->detail, ev->event_x >> 16,
+			ev->event_y >> 16, ev->time);
+		x11->time = ev->time;
+		break;
+	}
+	case XCB_INPUT_TOUCH_END: {
+		xcb_input_touch_end_event_t *ev = (xcb_input_touch_end_event_t *)event;
+
+		output = get_x11_output_from_window_id(x11, ev->event);
+		if (!output) {
+			return;
+		}
+
+		send_touch_up_event(output, ev->detail, ev->time);
+		x11->time = ev->time;
+		break;
+	}
 	case XCB_INPUT_ENTER: {
 		xcb_input_enter_event_t *ev = (xcb_input_enter_event_t *)event;
 
@@ -220,6 +298,14 @@ const struct wlr_pointer_impl pointer_impl = {
 	.destroy = pointer_destroy,
 };
 
+static void touch_destroy(struct wlr_touch *wlr_touch) {
+	// Don't free the touch, it's on the stack
+}
+
+const struct wlr_touch_impl touch_impl = {
+	.destroy = touch_destroy,
+};
+
 void update_x11_pointer_position(struct wlr_x11_output *output,
 		xcb_timestamp_t time) {
 	struct wlr_x11_backend *x11 = output->x11;
@@ -9,6 +9,7 @@
 
 #include <wlr/interfaces/wlr_output.h>
 #include <wlr/interfaces/wlr_pointer.h>
+#include <wlr/interfaces/wlr_touch.h>
 #include <wlr/util/log.h>
 
 #include "backend/x11.h"
@@ -86,6 +87,9 @@ static void output_destroy(struct wlr_output *wlr_output) {
 	struct wlr_x11_backend *x11 = output->x11;
 
 	wlr_input_device_destroy(&output->pointer_dev);
+	if (x11->has_touch) {
+		wlr_input_device_destroy(&output->touch_dev);
+	}
 
 	wl_list_remove(&output->link);
 	wl_event_source_remove(output->frame_timer);
@@ -172,6 +176,11 @@ struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend) {
 			XCB_INPUT_XI_EVENT_MASK_ENTER |
 			XCB_INPUT_XI_EVENT_MASK_LEAVE,
 	};
+	if (x11->has_touch) {
+		xinput_mask.mask |= XCB_INPUT_XI_EVENT_MASK_TOUCH_BEGIN |
+			XCB_INPUT_XI_EVENT_MASK_TOUCH_UPDATE |
+			XCB_INPUT_XI_EVENT_MASK_TOUCH_END;
+	}
 	xcb_input_xi_select_events(x11->xcb, output->win, 1, &xinput_mask.head);
 
 	output->surf = wlr_egl_create_surface(&x11->egl, &output->win);
@@ -204,8 +213,20 @@ struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend) {
 	output->pointer_dev.pointer = &output->pointer;
 	output->pointer_dev.output_name = strdup(wlr_output->name);
 
+	if (x11->has_touch) {
+		wlr_input_device_init(&output->touch_dev, WLR_INPUT_DEVICE_TOUCH,
+			&input_device_impl, "X11 touch", 0, 0);
+		wlr_touch_init(&output->touch, &touch_impl);
+		output->touch_dev.touch = &output->touch;
+		output->touch_dev.output_name = strdup(wlr_output->name);
+	}
+
 	wlr_signal_emit_safe(&x11->backend.events.new_output, wlr_output);
 	wlr_signal_emit_safe(&x11->backend.events.new_input, &output->pointer_dev);
+	if (x11->has_touch) {
+		wlr_signal_emit_safe(&x11->backend.events.new_input,
+			&output->touch_dev);
+	}
 
 	return wlr_output;
 }
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pixman.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/util/region.h>
+
+/**
+ * Counts the heap allocations made by the region helpers and by a
+ * wl_surface.commit. The allocator is interposed by defining malloc and
+ * friends here, which also catches the allocations made by pixman,
+ * libwayland and libwlroots. This relies on glibc exposing its allocator as
+ * __libc_malloc and friends.
+ */
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static size_t allocs = 0;
+
+void *malloc(size_t size) {
+	allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+	allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+	__libc_free(ptr);
+}
+
+#define ITERATIONS 10000
+
+enum region_op {
+	OP_SCALE,
+	OP_SCALE_IN_PLACE,
+	OP_TRANSFORM,
+	OP_EXPAND,
+	OP_ROTATED_BOUNDS,
+	OP_SIMPLIFY,
+};
+
+static const char *op_names[] = {
+	[OP_SCALE] = "scale",
+	[OP_SCALE_IN_PLACE] = "scale (in place)",
+	[OP_TRANSFORM] = "transform",
+	[OP_EXPAND] = "expand",
+	[OP_ROTATED_BOUNDS] = "rotated_bounds",
+	[OP_SIMPLIFY] = "simplify",
+};
+
+static void run_op(enum region_op op, pixman_region32_t *dst,
+		pixman_region32_t *src) {
+	switch (op) {
+	case OP_SCALE:
+		wlr_region_scale(dst, src, 2);
+		break;
+	case OP_SCALE_IN_PLACE:
+		// dst already has room for src, so the copy doesn't allocate
+		pixman_region32_copy(dst, src);
+		wlr_region_scale(dst, dst, 2);
+		break;
+	case OP_TRANSFORM:
+		wlr_region_transform(dst, src, WL_OUTPUT_TRANSFORM_90, 1920, 1080);
+		break;
+	case OP_EXPAND:
+		wlr_region_expand(dst, src, 4);
+		break;
+	case OP_ROTATED_BOUNDS:
+		wlr_region_rotated_bounds(dst, src, 0.5, 960, 540);
+		break;
+	case OP_SIMPLIFY:
+		wlr_region_simplify(dst, src, 4);
+		break;
+	}
+}
+
+/**
+ * Builds a region made of `n_rects` disjoint rectangles.
+ */
+static void init_region(pixman_region32_t *region, int n_rects) {
+	pixman_region32_init(region);
+	for (int i = 0; i < n_rects; ++i) {
+		pixman_region32_union_rect(region, region,
+			(i % 8) * 200, (i / 8) * 100, 100, 50);
+	}
+}
+
+static void bench_op(enum region_op op, int n_rects) {
+	pixman_region32_t src, dst;
+	init_region(&src, n_rects);
+	pixman_region32_init(&dst);
+
+	// Warm up, so that dst has already grown to its final size
+	run_op(op, &dst, &src);
+
+	size_t before = allocs;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		run_op(op, &dst, &src);
+	}
+	size_t count = allocs - before;
+
+	printf("%-18s %4d rects: %8.2f allocations per call\n", op_names[op],
+		n_rects, (double)count / ITERATIONS);
+
+	pixman_region32_fini(&dst);
+	pixman_region32_fini(&src);
+}
+
+static void registry_handle_global(void *data, struct wl_registry *registry,
+		uint32_t name, const char *interface, uint32_t version) {
+	struct wl_compositor **compositor = data;
+	if (strcmp(interface, wl_compositor_interface.name) == 0) {
+		*compositor = wl_registry_bind(registry, name,
+			&wl_compositor_interface, 1);
+	}
+}
+
+static void registry_handle_global_remove(void *data,
+		struct wl_registry *registry, uint32_t name) {
+	// Who cares?
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = registry_handle_global,
+	.global_remove = registry_handle_global_remove,
+};
+
+static void sync_handle_done(void *data, struct wl_callback *callback,
+		uint32_t serial) {
+	bool *done = data;
+	*done = true;
+	wl_callback_destroy(callback);
+}
+
+static const struct wl_callback_listener sync_listener = {
+	.done = sync_handle_done,
+};
+
+/**
+ * Dispatches the requests the client has sent so far. Returns the number of
+ * allocations made by the compositor while doing so.
+ */
+static size_t server_dispatch(struct wl_display *server,
+		struct wl_display *client) {
+	wl_display_flush(client);
+	size_t before = allocs;
+	wl_event_loop_dispatch(wl_display_get_event_loop(server), 0);
+	size_t count = allocs - before;
+	wl_display_flush_clients(server);
+	return count;
+}
+
+/**
+ * The client and the compositor live in the same process, so
+ * wl_display_roundtrip would block forever.
+ */
+static void roundtrip(struct wl_display *server, struct wl_display *client) {
+	bool done = false;
+	struct wl_callback *callback = wl_display_sync(client);
+	wl_callback_add_listener(callback, &sync_listener, &done);
+	while (!done) {
+		server_dispatch(server, client);
+		wl_display_dispatch(client);
+	}
+}
+
+/**
+ * Counts the allocations made by the compositor for each damage + commit
+ * sequence. Only the compositor side is counted, but that includes the
+ * closure libwayland allocates for each request. There is no renderer, so no
+ * buffer is attached: this measures the surface state handling only.
+ */
+static void bench_commit(void) {
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+
+	struct wl_display *server = wl_display_create();
+	wlr_compositor_create(server, NULL);
+	struct wl_client *wl_client = wl_client_create(server, fds[0]);
+	if (wl_client == NULL) {
+		fprintf(stderr, "Failed to create client\n");
+		exit(EXIT_FAILURE);
+	}
+
+	struct wl_display *client = wl_display_connect_to_fd(fds[1]);
+	if (client == NULL) {
+		fprintf(stderr, "Failed to connect to the compositor\n");
+		exit(EXIT_FAILURE);
+	}
+
+	struct wl_compositor *compositor = NULL;
+	struct wl_registry *registry = wl_display_get_registry(client);
+	wl_registry_add_listener(registry, &registry_listener, &compositor);
+	roundtrip(server, client);
+	if (compositor == NULL) {
+		fprintf(stderr, "wl_compositor not available\n");
+		exit(EXIT_FAILURE);
+	}
+
+	struct wl_surface *surface = wl_compositor_create_surface(compositor);
+
+	// Warm up, so that the surface regions have already grown
+	wl_surface_damage(surface, 0, 0, 64, 64);
+	wl_surface_commit(surface);
+	roundtrip(server, client);
+
+	size_t count = 0;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		wl_surface_damage(surface, (i % 8) * 8, 0, 64, 64);
+		wl_surface_commit(surface);
+		count += server_dispatch(server, client);
+	}
+	roundtrip(server, client);
+
+	printf("%-18s           %8.2f allocations per call\n",
+		"wl_surface.commit", (double)count / ITERATIONS);
+
+	wl_surface_destroy(surface);
+	wl_compositor_destroy(compositor);
+	wl_registry_destroy(registry);
+	wl_display_disconnect(client);
+	wl_client_destroy(wl_client);
+	wl_display_destroy(server);
+}
+
+int main(int argc, char *argv[]) {
+	const int n_rects[] = { 1, 8, 64 };
+	for (size_t op = 0; op < sizeof(op_names) / sizeof(op_names[0]); ++op) {
+		for (size_t i = 0; i < sizeof(n_rects) / sizeof(n_rects[0]); ++i) {
+			bench_op(op, n_rects[i]);
+		}
+	}
+	bench_commit();
+	return EXIT_SUCCESS;
+}
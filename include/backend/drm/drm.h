@@ -17,6 +17,11 @@
 #include "properties.h"
 #include "renderer.h"
 
+// Number of frames used to predict the render time of the next one
+#define DRM_RENDER_TIME_HISTORY_LEN 8
+// Size of the gamma ramps of CRTCs without hardware gamma support
+#define DRM_SHADER_GAMMA_SIZE 256
+
 struct wlr_drm_plane {
 	uint32_t type;
 	uint32_t id;
@@ -25,9 +30,16 @@ struct wlr_drm_plane {
 
 	struct wlr_drm_surface surf;
 	struct wlr_drm_surface mgpu_surf;
+	// Set when buffers rendered by the parent GPU can't be scanned out
+	// directly and need to be copied into mgpu_surf
+	bool mgpu_copy;
 
 	uint32_t drm_format; // ARGB8888 or XRGB8888
 
+	// Sync file the kernel waits on before scanning out the next buffer, -1
+	// if none. Atomic modesetting only.
+	int in_fence_fd;
+
 	// Only used by cursor
 	float matrix[9];
 	bool cursor_enabled;
@@ -42,7 +54,15 @@ struct wlr_drm_crtc {
 	// Atomic modesetting only
 	uint32_t mode_id;
 	uint32_t gamma_lut;
+	// Committed along with the next pageflip, 0 if none
+	uint32_t pending_gamma_lut;
+	bool vrr_enabled;
 	drmModeAtomicReq *atomic;
+	// Pending in the current batch, see wlr_drm_backend_begin_batch
+	struct wlr_drm_connector *batch_conn;
+	int batch_cursor;
+	uint32_t batch_mode_id;
+	uint32_t batch_gamma_lut;
 
 	// Legacy only
 	drmModeCrtc *legacy_crtc;
@@ -62,6 +82,8 @@ struct wlr_drm_crtc {
 
 	uint16_t *gamma_table;
 	size_t gamma_table_size;
+	// The CRTC has no gamma LUT, gamma_table is applied by the renderer
+	bool shader_gamma;
 };
 
 struct wlr_drm_backend {
@@ -105,6 +127,16 @@ struct wlr_drm_backend {
 
 	struct wl_list outputs;
 
+	// Safety margin for adaptive frame scheduling, negative if disabled
+	int frame_margin_ns;
+	// Pageflips and modesets are queued until the batch is committed
+	bool batching;
+	// Keep the mode set by the firmware or the boot splash when it matches,
+	// see drm_connector_start_renderer
+	bool adopt_boot_mode;
+	// When the backend has been started, to measure the time to first frame
+	struct timespec start_time;
+
 	struct wlr_drm_renderer renderer;
 	struct wlr_session *session;
 };
@@ -140,11 +172,29 @@ struct wlr_drm_connector {
 
 	uint32_t width, height;
 	int32_t cursor_x, cursor_y;
+	// The cursor position hasn't been applied yet, see
+	// drm_connector_move_cursor
+	bool cursor_dirty;
+	bool cursor_vblank_pending;
 
 	drmModeCrtc *old_crtc;
+	// old_crtc is still lit and hasn't been modeset by us yet
+	bool boot_mode_pending;
+	// The pending pageflip keeps the boot mode instead of modesetting
+	bool adopting_boot_mode;
+	bool first_frame_presented;
 
 	bool pageflip_pending;
 	struct wl_event_source *retry_pageflip;
+
+	// Adaptive frame scheduling: frame events are delayed so that rendering
+	// finishes right before the next vblank
+	struct wl_event_source *frame_timer;
+	bool rendering;
+	struct timespec render_start;
+	int render_times[DRM_RENDER_TIME_HISTORY_LEN]; // nsec
+	size_t render_times_idx;
+
 	struct wl_list link;
 };
 
@@ -154,7 +204,13 @@ bool check_drm_features(struct wlr_drm_backend *drm);
 bool init_drm_resources(struct wlr_drm_backend *drm);
 void finish_drm_resources(struct wlr_drm_backend *drm);
 void restore_drm_outputs(struct wlr_drm_backend *drm);
-void scan_drm_connectors(struct wlr_drm_backend *state);
+/**
+ * Updates the connectors. If `event` is NULL, all connectors are probed.
+ * Otherwise the kernel has already probed them, and only the connector which
+ * has changed is updated if the event specifies it.
+ */
+void scan_drm_connectors(struct wlr_drm_backend *drm,
+	struct wlr_device_hotplug_event *event);
 int handle_drm_event(int fd, uint32_t mask, void *data);
 bool enable_drm_connector(struct wlr_output *output, bool enable);
 bool set_drm_connector_gamma(struct wlr_output *output, size_t size,
@@ -33,6 +33,13 @@ struct wlr_drm_interface {
 	// Get the gamma lut size of a crtc
 	size_t (*crtc_get_gamma_size)(struct wlr_drm_backend *drm,
 		struct wlr_drm_crtc *crtc);
+	// Enable or disable variable refresh rate on crtc
+	bool (*crtc_set_vrr)(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, bool enabled);
+	// Apply the pageflips and modesets queued while the backend was batching
+	// in a single commit. Either all or none of them are applied. NULL if
+	// batching isn't supported.
+	bool (*commit_batch)(struct wlr_drm_backend *drm);
 };
 
 extern const struct wlr_drm_interface atomic_iface;
@@ -21,6 +21,9 @@ struct wlr_drm_renderer {
 	struct wlr_renderer *wlr_rend;
 };
 
+// Number of previous frames whose damage is tracked for multi-GPU copies
+#define DRM_SURFACE_DAMAGE_HISTORY_LEN 2
+
 struct wlr_drm_surface {
 	struct wlr_drm_renderer *renderer;
 
@@ -32,6 +35,13 @@ struct wlr_drm_surface {
 
 	struct gbm_bo *front;
 	struct gbm_bo *back;
+
+	// Damage of the last multi-GPU copies, most recent first. Only
+	// damage_history_len entries are valid. The regions are initialized
+	// while renderer is set, i.e. between init_drm_surface and
+	// finish_drm_surface.
+	pixman_region32_t damage_history[DRM_SURFACE_DAMAGE_HISTORY_LEN];
+	size_t damage_history_len;
 };
 
 bool init_drm_renderer(struct wlr_drm_backend *drm,
@@ -52,8 +62,19 @@ struct gbm_bo *swap_drm_surface_buffers(struct wlr_drm_surface *surf,
 	pixman_region32_t *damage);
 struct gbm_bo *get_drm_surface_front(struct wlr_drm_surface *surf);
 void post_drm_surface(struct wlr_drm_surface *surf);
-struct gbm_bo *copy_drm_surface_mgpu(struct wlr_drm_surface *dest,
+/**
+ * Imports a buffer rendered by the parent GPU into the secondary GPU, so that
+ * it can be scanned out without a copy. Returns NULL if that's not possible.
+ * The imported buffer is owned by `src`.
+ */
+struct gbm_bo *import_drm_bo_mgpu(struct wlr_drm_renderer *renderer,
 	struct gbm_bo *src);
+/**
+ * Copies a buffer rendered by the parent GPU into `dest`. Only the damaged
+ * region is copied if `damage` isn't NULL.
+ */
+struct gbm_bo *copy_drm_surface_mgpu(struct wlr_drm_surface *dest,
+	struct gbm_bo *src, pixman_region32_t *damage);
 bool export_drm_bo(struct gbm_bo *bo, struct wlr_dmabuf_attributes *attribs);
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef BACKEND_DRM_UTIL_H
 #define BACKEND_DRM_UTIL_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <wlr/types/wlr_output.h>
 #include <xf86drm.h>
@@ -8,6 +9,8 @@
 
 // Calculates a more accurate refresh rate (mHz) than what mode itself provides
 int32_t calculate_refresh_rate(const drmModeModeInfo *mode);
+// Returns whether both modes have the same timings, ignoring their name and type
+bool drm_mode_equal(const drmModeModeInfo *a, const drmModeModeInfo *b);
 // Populates the make/model/phys_{width,height} of output from the edid data
 void parse_edid(struct wlr_output *restrict output, size_t len,
 	const uint8_t *data);
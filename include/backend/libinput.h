@@ -2,6 +2,8 @@
 #define BACKEND_LIBINPUT_H
 
 #include <libinput.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <wayland-server-core.h>
 #include <wlr/backend/interface.h>
 #include <wlr/backend/libinput.h>
@@ -9,6 +11,36 @@
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_list.h>
 
+// Must be a power of two
+#define LIBINPUT_THREAD_QUEUE_SIZE 256
+// Maximum number of events coalesced into a single one
+#define LIBINPUT_THREAD_MAX_BATCH 64
+
+/**
+ * Reads libinput events on a dedicated thread, so that evdev devices are
+ * drained even when the main loop is busy. Events are passed to the main
+ * thread through a single-producer single-consumer queue.
+ */
+struct wlr_libinput_thread {
+	struct wlr_libinput_backend *backend;
+	pthread_t thread;
+	// Held by the input thread while it calls into libinput, and by the main
+	// thread while it handles events or otherwise uses libinput
+	pthread_mutex_t lock;
+
+	int event_fd; // signaled by the input thread when events are queued
+	int control_fd; // signaled by the main thread to wake up the input thread
+	struct wl_event_source *event_source;
+
+	struct libinput_event *events[LIBINPUT_THREAD_QUEUE_SIZE];
+	atomic_size_t head; // written by the main thread
+	atomic_size_t tail; // written by the input thread
+	atomic_bool blocked; // the input thread waits for room in the queue
+	atomic_bool stop;
+	// The main thread is handling queued events, with the lock held
+	bool dispatching;
+};
+
 struct wlr_libinput_backend {
 	struct wlr_backend backend;
 
@@ -17,6 +49,7 @@ struct wlr_libinput_backend {
 
 	struct libinput *libinput_context;
 	struct wl_event_source *input_event;
+	struct wlr_libinput_thread *thread; // NULL unless WLR_LIBINPUT_THREAD=1
 
 	struct wl_listener display_destroy;
 	struct wl_listener session_signal;
@@ -32,6 +65,20 @@ struct wlr_libinput_input_device {
 
 uint32_t usec_to_msec(uint64_t usec);
 
+bool start_libinput_thread(struct wlr_libinput_backend *backend);
+/**
+ * Joins the input thread and drops the events it has queued. Must be called
+ * from the main thread, and not while its events are being handled.
+ */
+void stop_libinput_thread(struct wlr_libinput_backend *backend);
+/**
+ * Serializes calls into libinput with the input thread. Doesn't do anything if
+ * the input thread isn't used. The lock is recursive, and is already held
+ * while events are handled.
+ */
+void libinput_backend_lock(struct wlr_libinput_backend *backend);
+void libinput_backend_unlock(struct wlr_libinput_backend *backend);
+
 void handle_libinput_event(struct wlr_libinput_backend *state,
 		struct libinput_event *event);
 
@@ -54,6 +101,14 @@ void handle_pointer_button(struct libinput_event *event,
 		struct libinput_device *device);
 void handle_pointer_axis(struct libinput_event *event,
 		struct libinput_device *device);
+/**
+ * Handles consecutive events of the same device as a single one. The events
+ * must have been accepted by the coalescing policy of the input thread.
+ */
+void handle_pointer_motion_batch(struct libinput_event **events, size_t len,
+		struct libinput_device *device);
+void handle_pointer_axis_batch(struct libinput_event **events, size_t len,
+		struct libinput_device *device);
 void handle_pointer_swipe_begin(struct libinput_event *event,
 		struct libinput_device *device);
 void handle_pointer_swipe_update(struct libinput_event *event,
@@ -82,6 +137,8 @@ void handle_touch_motion(struct libinput_event *event,
 		struct libinput_device *device);
 void handle_touch_cancel(struct libinput_event *event,
 		struct libinput_device *device);
+void handle_touch_frame(struct libinput_event *event,
+		struct libinput_device *device);
 
 struct wlr_tablet *create_libinput_tablet(
 		struct libinput_device *device);
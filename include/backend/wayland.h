@@ -2,6 +2,7 @@
 #define BACKEND_WAYLAND_H
 
 #include <stdbool.h>
+#include <time.h>
 
 #include <wayland-client.h>
 #include <wayland-egl.h>
@@ -32,11 +33,20 @@ struct wlr_wl_backend {
 	struct wl_registry *registry;
 	struct wl_compositor *compositor;
 	struct xdg_wm_base *xdg_wm_base;
+	struct wl_subcompositor *subcompositor;
+	struct zwp_linux_dmabuf_v1 *zwp_linux_dmabuf_v1;
+	struct wl_array dmabuf_formats; // struct wlr_wl_dmabuf_format
 	struct wl_shm *shm;
+	struct wl_array shm_formats; // uint32_t
+	struct wl_list dmabuf_buffers; // wlr_wl_dmabuf_buffer::link
+	struct wp_presentation *presentation;
+	clockid_t presentation_clock;
 	struct wl_seat *seat;
 	struct wl_pointer *pointer;
 	struct wl_keyboard *keyboard;
+	struct wl_touch *touch;
 	struct wlr_wl_pointer *current_pointer;
+	struct wl_list touch_points; // wlr_wl_touch_point::link
 	char *seat_name;
 };
 
@@ -55,6 +65,9 @@ struct wlr_wl_output {
 
 	uint32_t enter_serial;
 
+	struct wl_list subsurfaces; // wlr_wl_subsurface::link
+	struct wl_list presentation_feedbacks; // wlr_wl_presentation_feedback::link
+
 	struct {
 		struct wl_surface *surface;
 		struct wl_egl_window *egl_window;
@@ -63,6 +76,48 @@ struct wlr_wl_output {
 	} cursor;
 };
 
+struct wlr_wl_presentation_feedback {
+	struct wlr_wl_output *output;
+	struct wp_presentation_feedback *feedback;
+	struct wl_list link; // wlr_wl_output::presentation_feedbacks
+};
+
+struct wlr_wl_dmabuf_format {
+	uint32_t format;
+	uint64_t modifier;
+};
+
+/**
+ * A client DMA-BUF buffer imported in the parent compositor. The import is
+ * asynchronous: the surface is rendered by the compositor until the parent
+ * compositor has created the wl_buffer, and for good if the import failed.
+ * Subsurfaces still showing the buffer are updated once it has been created.
+ */
+struct wlr_wl_dmabuf_buffer {
+	struct wlr_wl_backend *backend;
+	struct wl_resource *resource;
+	struct zwp_linux_buffer_params_v1 *params; // while the import is pending
+	struct wl_buffer *wl_buffer; // NULL until imported
+	// Referenced until the parent compositor releases the buffer
+	struct wlr_buffer *locked;
+
+	struct wl_listener resource_destroy;
+	struct wl_list link; // wlr_wl_backend::dmabuf_buffers
+};
+
+/**
+ * A copy of a client shared memory buffer.
+ */
+struct wlr_wl_shm_buffer {
+	struct wl_buffer *wl_buffer;
+	void *data;
+	int32_t width, height, stride;
+	uint32_t format;
+	bool busy;
+
+	struct wl_list link; // wlr_wl_subsurface::shm_buffers
+};
+
 struct wlr_wl_input_device {
 	struct wlr_input_device wlr_input_device;
 
@@ -82,11 +137,33 @@ struct wlr_wl_pointer {
 	struct wl_listener output_destroy;
 };
 
+struct wlr_wl_touch {
+	struct wlr_touch wlr_touch;
+
+	struct wlr_wl_input_device *input_device;
+	struct wlr_wl_output *output;
+	// Whether events were emitted since the last frame
+	bool needs_frame;
+
+	struct wl_listener output_destroy;
+};
+
+struct wlr_wl_touch_point {
+	int32_t id;
+	struct wlr_wl_touch *touch;
+	struct wl_list link; // wlr_wl_backend::touch_points
+};
+
 struct wlr_wl_backend *get_wl_backend_from_backend(struct wlr_backend *backend);
+struct wlr_wl_output *get_wl_output_from_output(struct wlr_output *wlr_output);
 void update_wl_output_cursor(struct wlr_wl_output *output);
 struct wlr_wl_pointer *pointer_get_wl(struct wlr_pointer *wlr_pointer);
 void create_wl_pointer(struct wl_pointer *wl_pointer, struct wlr_wl_output *output);
 void create_wl_keyboard(struct wl_keyboard *wl_keyboard, struct wlr_wl_backend *wl);
+struct wlr_wl_touch *touch_get_wl(struct wlr_touch *wlr_touch);
+void create_wl_touch(struct wl_touch *wl_touch, struct wlr_wl_output *output);
+
+void destroy_wl_dmabuf_buffer(struct wlr_wl_dmabuf_buffer *buffer);
 
 extern const struct wl_seat_listener seat_listener;
 
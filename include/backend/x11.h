@@ -31,6 +31,10 @@ struct wlr_x11_output {
 	struct wlr_pointer pointer;
 	struct wlr_input_device pointer_dev;
 
+	// Only initialized if the X server supports XInput 2.2
+	struct wlr_touch touch;
+	struct wlr_input_device touch_dev;
+
 	struct wl_event_source *frame_timer;
 	int frame_delay;
 
@@ -68,6 +72,8 @@ struct wlr_x11_backend {
 	xcb_timestamp_t time;
 
 	uint8_t xinput_opcode;
+	// Whether the X server supports XInput 2.2 touch events
+	bool has_touch;
 
 	struct wl_listener display_destroy;
 };
@@ -79,6 +85,7 @@ struct wlr_x11_output *get_x11_output_from_window_id(
 
 extern const struct wlr_keyboard_impl keyboard_impl;
 extern const struct wlr_pointer_impl pointer_impl;
+extern const struct wlr_touch_impl touch_impl;
 extern const struct wlr_input_device_impl input_device_impl;
 
 void handle_x11_xinput_event(struct wlr_x11_backend *x11,
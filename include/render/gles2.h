@@ -23,12 +23,49 @@ struct wlr_gles2_pixel_format {
 	bool has_alpha;
 };
 
+// Number of entries of the gamma ramp texture
+#define GLES2_GAMMA_LUT_SIZE 256
+
+// Pixel textures at most this large are packed into shared atlas pages
+#define GLES2_ATLAS_MAX_TEXTURE_SIZE 256
+#define GLES2_ATLAS_PAGE_SIZE 1024
+// Maximum number of pages per pixel format, larger textures are used beyond
+#define GLES2_ATLAS_MAX_PAGES 4
+
+struct wlr_gles2_atlas_shelf {
+	int y, height;
+	int x; // first free column
+	size_t allocs;
+	struct wl_list link; // wlr_gles2_atlas_page::shelves
+};
+
+/**
+ * A texture shared by small pixel textures of the same format. Textures are
+ * packed in rows, called shelves, with a one pixel border duplicating their
+ * edges so that filtering doesn't sample the neighbouring textures. Space is
+ * only reclaimed once a whole shelf is unused.
+ *
+ * Textures may outlive the renderer, so pages are only destroyed once they
+ * don't hold any texture anymore.
+ */
+struct wlr_gles2_atlas_page {
+	struct wlr_gles2_renderer *renderer; // NULL once destroyed
+	GLuint tex;
+	GLint gl_format, gl_type;
+	size_t allocs;
+	int shelves_height;
+	struct wl_list shelves; // wlr_gles2_atlas_shelf::link
+	struct wl_list link; // wlr_gles2_renderer::atlas_pages
+};
+
 struct wlr_gles2_tex_shader {
 	GLuint program;
 	GLint proj;
 	GLint invert_y;
 	GLint tex;
 	GLint alpha;
+	GLint gamma;
+	GLint gamma_lut;
 };
 
 struct wlr_gles2_renderer {
@@ -41,6 +78,8 @@ struct wlr_gles2_renderer {
 		bool read_format_bgra_ext;
 		bool debug_khr;
 		bool egl_image_external_oes;
+		bool disjoint_timer_query_ext;
+		bool get_program_binary_oes;
 	} exts;
 
 	struct {
@@ -59,7 +98,17 @@ struct wlr_gles2_renderer {
 		struct wlr_gles2_tex_shader tex_ext;
 	} shaders;
 
+	// Gamma ramp applied to rendered colors, see wlr_renderer_set_gamma
+	struct {
+		bool enabled; // for the current render pass
+		bool pending; // for the next render pass
+		GLuint tex; // 0 until a ramp has been uploaded
+		uint8_t lut[GLES2_GAMMA_LUT_SIZE * 4]; // RGBA
+	} gamma;
+
 	uint32_t viewport_width, viewport_height;
+
+	struct wl_list atlas_pages; // wlr_gles2_atlas_page::link
 };
 
 enum wlr_gles2_texture_type {
@@ -87,6 +136,20 @@ struct wlr_gles2_texture {
 		GLuint gl_tex;
 		struct wl_resource *wl_drm;
 	};
+
+	// Set if the texture is part of an atlas page, which owns gl_tex
+	struct wlr_gles2_atlas_page *atlas_page;
+	struct wlr_gles2_atlas_shelf *atlas_shelf;
+	int atlas_x, atlas_y;
+};
+
+struct wlr_gles2_render_timer {
+	struct wlr_render_timer wlr_timer;
+
+	struct wlr_gles2_renderer *renderer;
+	GLuint queries[2]; // begin and end timestamps
+	bool pending;
+	int64_t duration_ns; // -1 if unknown
 };
 
 const struct wlr_gles2_pixel_format *get_gles2_format_from_wl(
@@ -97,6 +160,34 @@ const enum wl_shm_format *get_gles2_wl_formats(size_t *len);
 
 struct wlr_gles2_texture *gles2_get_texture(
 	struct wlr_texture *wlr_texture);
+/**
+ * Creates a texture in an atlas page. Returns NULL if the texture is too large
+ * or if there is no room left.
+ */
+struct wlr_texture *gles2_texture_from_pixels_in_atlas(
+	struct wlr_gles2_renderer *renderer, enum wl_shm_format wl_fmt,
+	uint32_t stride, uint32_t width, uint32_t height, const void *data);
+
+bool gles2_atlas_alloc(struct wlr_gles2_renderer *renderer,
+	const struct wlr_gles2_pixel_format *fmt,
+	struct wlr_gles2_texture *texture);
+void gles2_atlas_free(struct wlr_gles2_texture *texture);
+void gles2_atlas_write_pixels(struct wlr_gles2_texture *texture,
+	uint32_t stride, uint32_t width, uint32_t height,
+	uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y,
+	const void *data);
+void finish_gles2_atlas(struct wlr_gles2_renderer *renderer);
+
+/**
+ * Shader programs are cached on disk with GL_OES_get_program_binary, since
+ * compiling them takes most of the renderer creation time with some drivers.
+ * Returns 0 if the program isn't in the cache or if the cached binary can't be
+ * used anymore.
+ */
+GLuint load_gles2_cached_program(const GLchar *vert_src,
+	const GLchar *frag_src);
+void save_gles2_cached_program(GLuint prog, const GLchar *vert_src,
+	const GLchar *frag_src);
 
 void push_gles2_marker(const char *file, const char *func);
 void pop_gles2_marker(void);
@@ -19,6 +19,7 @@ struct roots_output_config {
 	enum wl_output_transform transform;
 	int x, y;
 	float scale;
+	bool adaptive_sync;
 	struct wl_list link;
 	struct {
 		int width, height;
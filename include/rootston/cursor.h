@@ -49,6 +49,7 @@ struct roots_cursor {
 	struct wl_listener touch_down;
 	struct wl_listener touch_up;
 	struct wl_listener touch_motion;
+	struct wl_listener touch_frame;
 
 	struct wl_listener tool_axis;
 	struct wl_listener tool_tip;
@@ -89,6 +90,8 @@ void roots_cursor_handle_touch_up(struct roots_cursor *cursor,
 void roots_cursor_handle_touch_motion(struct roots_cursor *cursor,
 	struct wlr_event_touch_motion *event);
 
+void roots_cursor_handle_touch_frame(struct roots_cursor *cursor);
+
 void roots_cursor_handle_tool_axis(struct roots_cursor *cursor,
 	struct wlr_event_tablet_tool_axis *event);
 
@@ -52,6 +52,7 @@ struct roots_desktop {
 	struct wlr_gamma_control_manager_v1 *gamma_control_manager_v1;
 	struct wlr_screenshooter *screenshooter;
 	struct wlr_export_dmabuf_manager_v1 *export_dmabuf_manager_v1;
+	struct wlr_linux_explicit_synchronization_v1 *linux_explicit_synchronization_v1;
 	struct wlr_server_decoration_manager *server_decoration_manager;
 	struct wlr_xdg_decoration_manager_v1 *xdg_decoration_manager;
 	struct wlr_gtk_primary_selection_device_manager *primary_selection_device_manager;
@@ -63,6 +64,7 @@ struct roots_desktop {
 	struct wlr_text_input_manager_v3 *text_input;
 	struct wlr_virtual_keyboard_manager_v1 *virtual_keyboard;
 	struct wlr_screencopy_manager_v1 *screencopy;
+	struct wlr_output_timing_manager_v1 *output_timing_manager_v1;
 	struct wlr_tablet_manager_v2 *tablet_v2;
 	struct wlr_pointer_constraints_v1 *pointer_constraints;
 	struct wlr_presentation *presentation;
@@ -20,4 +20,7 @@ void seat_client_create_touch(struct wlr_seat_client *seat_client,
 	uint32_t version, uint32_t id);
 void seat_client_destroy_touch(struct wl_resource *resource);
 
+void seat_emit_input_dispatch(struct wlr_seat *seat,
+	struct wlr_surface *surface, uint32_t time_msec);
+
 #endif
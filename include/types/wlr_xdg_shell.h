@@ -21,7 +21,8 @@ void unmap_xdg_surface(struct wlr_xdg_surface *surface);
 void reset_xdg_surface(struct wlr_xdg_surface *xdg_surface);
 void destroy_xdg_surface(struct wlr_xdg_surface *surface);
 void handle_xdg_surface_commit(struct wlr_surface *wlr_surface);
-void handle_xdg_surface_precommit(struct wlr_surface *wlr_surface);
+void handle_xdg_surface_precommit(struct wlr_surface *wlr_surface,
+	const struct wlr_surface_state *state);
 
 void create_xdg_positioner(struct wlr_xdg_client *client, uint32_t id);
 struct wlr_xdg_positioner_resource *get_xdg_positioner_from_resource(
@@ -41,6 +42,7 @@ void send_xdg_toplevel_configure(struct wlr_xdg_surface *surface,
 	struct wlr_xdg_surface_configure *configure);
 void handle_xdg_toplevel_ack_configure(struct wlr_xdg_surface *surface,
 	struct wlr_xdg_surface_configure *configure);
+void handle_xdg_toplevel_client_commit(struct wlr_xdg_surface *surface);
 bool compare_xdg_surface_toplevel_state(struct wlr_xdg_toplevel *state);
 void destroy_xdg_toplevel(struct wlr_xdg_surface *surface);
 
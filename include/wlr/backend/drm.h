@@ -34,4 +34,23 @@ bool wlr_output_is_drm(struct wlr_output *output);
 typedef struct _drmModeModeInfo drmModeModeInfo;
 bool wlr_drm_connector_add_mode(struct wlr_output *output, const drmModeModeInfo *mode);
 
+/**
+ * Starts queuing the updates of the backend's outputs: buffer swaps and mode
+ * sets are not applied until wlr_drm_backend_commit_batch is called. Pending
+ * cursor and gamma changes are applied along with them. This allows modesetting
+ * several outputs at once and flipping them on the same vblank.
+ *
+ * The backend can be a DRM backend or a multi backend, in which case all of its
+ * DRM backends are affected. Has no effect without atomic modesetting.
+ */
+void wlr_drm_backend_begin_batch(struct wlr_backend *backend);
+/**
+ * Applies the updates queued since wlr_drm_backend_begin_batch in a single
+ * atomic commit. The commit is tested first: if it's rejected, none of the
+ * updates are applied and false is returned. The affected outputs are then
+ * damaged as a whole and can be rendered again right away: their needs_swap
+ * event is emitted, and wlr_output_schedule_frame can be used.
+ */
+bool wlr_drm_backend_commit_batch(struct wlr_backend *backend);
+
 #endif
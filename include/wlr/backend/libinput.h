@@ -17,7 +17,12 @@
 
 struct wlr_backend *wlr_libinput_backend_create(struct wl_display *display,
 		struct wlr_session *session);
-/** Gets the underlying libinput_device handle for the given wlr_input_device */
+/**
+ * Gets the underlying libinput_device handle for the given wlr_input_device.
+ *
+ * If the input thread is enabled, the handle must only be used from input
+ * device event handlers (including the backend's new_input event).
+ */
 struct libinput_device *wlr_libinput_get_device_handle(
 		struct wlr_input_device *dev);
 
@@ -3,6 +3,7 @@
 
 #include <libudev.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <wayland-server.h>
 
@@ -11,9 +12,13 @@ struct session_impl;
 struct wlr_device {
 	int fd;
 	dev_t dev;
-	struct wl_signal signal;
+	struct wl_signal signal; // struct wlr_session *
 
 	struct wl_list link;
+
+	struct {
+		struct wl_signal hotplug; // struct wlr_device_hotplug_event *
+	} events;
 };
 
 struct wlr_session {
@@ -76,13 +81,42 @@ void wlr_session_destroy(struct wlr_session *session);
  */
 int wlr_session_open_file(struct wlr_session *session, const char *path);
 
+/*
+ * Starts opening the file at path in the background, so that a following
+ * wlr_session_open_file call for the same path doesn't have to wait for it.
+ * This allows opening many devices in parallel. Files which haven't been
+ * opened when the event loop becomes idle are closed.
+ *
+ * This is only a hint, which is ignored by sessions opening files directly.
+ */
+void wlr_session_prefetch_file(struct wlr_session *session, const char *path);
+
 /*
  * Closes a file previously opened with wlr_session_open_file.
  */
 void wlr_session_close_file(struct wlr_session *session, int fd);
 
+/**
+ * Emitted by the device's hotplug signal when the kernel reports a change.
+ */
+struct wlr_device_hotplug_event {
+	struct wlr_session *session;
+	// The DRM connector which has changed, zero if unknown
+	uint32_t connector_id;
+};
+
+/*
+ * Adds a listener to the device signal, emitted with the session when the
+ * kernel reports a change.
+ */
 void wlr_session_signal_add(struct wlr_session *session, int fd,
 	struct wl_listener *listener);
+/*
+ * Adds a listener to the device's hotplug signal, emitted along with the
+ * device signal. See struct wlr_device_hotplug_event.
+ */
+void wlr_session_hotplug_add(struct wlr_session *session, int fd,
+	struct wl_listener *listener);
 /*
  * Changes the virtual terminal.
  */
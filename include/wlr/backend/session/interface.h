@@ -17,6 +17,8 @@ struct session_impl {
 	int (*open)(struct wlr_session *session, const char *path);
 	void (*close)(struct wlr_session *session, int fd);
 	bool (*change_vt)(struct wlr_session *session, unsigned vt);
+	// Optional, see wlr_session_prefetch_file
+	void (*prefetch)(struct wlr_session *session, const char *path);
 };
 
 #endif
@@ -46,4 +46,62 @@ bool wlr_output_is_wl(struct wlr_output *output);
  */
 void wlr_wl_output_set_title(struct wlr_output *output, const char *title);
 
+struct wlr_surface;
+
+/**
+ * A surface shown by the parent compositor as a subsurface of the output's
+ * window. Each time the surface is committed, its buffer is forwarded to the
+ * parent compositor instead of being composited into the output's frame:
+ * DMA-BUF buffers are shared with the parent compositor via linux-dmabuf, and
+ * shared memory buffers are copied to a wl_shm buffer.
+ *
+ * Subsurfaces are stacked above the output's frame, in the order they have
+ * been created. They're only suitable for surfaces which aren't covered by
+ * anything the compositor renders itself.
+ */
+struct wlr_wl_subsurface {
+	struct wlr_output *output;
+	struct wlr_surface *surface;
+	int x, y;
+	/**
+	 * Whether the surface's current buffer is shown by the parent compositor.
+	 * If false, the buffer couldn't be forwarded and the compositor needs to
+	 * render the surface itself.
+	 */
+	bool forwarded;
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+
+	// private state
+
+	struct wl_surface *wl_surface;
+	struct wl_subsurface *wl_subsurface;
+	struct wl_callback *frame_callback;
+	struct wl_list shm_buffers; // wlr_wl_shm_buffer::link
+	struct wl_list link; // wlr_wl_output::subsurfaces
+
+	struct wl_listener surface_commit;
+	struct wl_listener surface_destroy;
+};
+
+/**
+ * Forwards the surface's buffers to the parent compositor. Returns NULL if the
+ * parent compositor doesn't support subsurfaces. The subsurface is destroyed
+ * along with the output or the surface.
+ *
+ * Buffers are only forwarded if the output isn't scaled nor transformed.
+ */
+struct wlr_wl_subsurface *wlr_wl_output_create_subsurface(
+	struct wlr_output *output, struct wlr_surface *surface);
+/**
+ * Sets the position of the subsurface, in output-local coordinates.
+ */
+void wlr_wl_subsurface_set_position(struct wlr_wl_subsurface *subsurface,
+	int x, int y);
+void wlr_wl_subsurface_destroy(struct wlr_wl_subsurface *subsurface);
+
 #endif
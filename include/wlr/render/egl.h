@@ -37,6 +37,7 @@ struct wlr_egl {
 		bool image_dma_buf_export_mesa;
 		bool image_dmabuf_import_ext;
 		bool image_dmabuf_import_modifiers_ext;
+		bool native_fence_sync_android;
 		bool swap_buffers_with_damage_ext;
 		bool swap_buffers_with_damage_khr;
 	} exts;
@@ -115,4 +116,19 @@ bool wlr_egl_swap_buffers(struct wlr_egl *egl, EGLSurface surface,
 
 bool wlr_egl_destroy_surface(struct wlr_egl *egl, EGLSurface surface);
 
+/**
+ * Creates a sync file descriptor which is signalled once the GPU has executed
+ * all of the commands submitted so far to the current context. Returns -1 if
+ * EGL_ANDROID_native_fence_sync isn't supported.
+ */
+int wlr_egl_create_fence(struct wlr_egl *egl);
+
+/**
+ * Makes the current context wait on the GPU for the sync file descriptor to be
+ * signalled before executing further commands. The fd isn't consumed. Returns
+ * false if EGL_ANDROID_native_fence_sync isn't supported or the fence can't
+ * be imported.
+ */
+bool wlr_egl_wait_fence(struct wlr_egl *egl, int fd);
+
 #endif
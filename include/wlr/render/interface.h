@@ -31,9 +31,9 @@ struct wlr_renderer_impl {
 	void (*end)(struct wlr_renderer *renderer);
 	void (*clear)(struct wlr_renderer *renderer, const float color[static 4]);
 	void (*scissor)(struct wlr_renderer *renderer, struct wlr_box *box);
-	bool (*render_texture_with_matrix)(struct wlr_renderer *renderer,
-		struct wlr_texture *texture, const float matrix[static 9],
-		float alpha);
+	bool (*render_subtexture_with_matrix)(struct wlr_renderer *renderer,
+		struct wlr_texture *texture, const struct wlr_fbox *box,
+		const float matrix[static 9], float alpha);
 	void (*render_quad_with_matrix)(struct wlr_renderer *renderer,
 		const float color[static 4], const float matrix[static 9]);
 	void (*render_ellipse_with_matrix)(struct wlr_renderer *renderer,
@@ -64,6 +64,12 @@ struct wlr_renderer_impl {
 	void (*destroy)(struct wlr_renderer *renderer);
 	void (*init_wl_display)(struct wlr_renderer *renderer,
 		struct wl_display *wl_display);
+	struct wlr_render_timer *(*render_timer_create)(
+		struct wlr_renderer *renderer);
+	int (*create_fence)(struct wlr_renderer *renderer);
+	bool (*wait_fence)(struct wlr_renderer *renderer, int fd);
+	bool (*set_gamma)(struct wlr_renderer *renderer, size_t size,
+		const uint16_t *r, const uint16_t *g, const uint16_t *b);
 };
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
@@ -84,4 +90,18 @@ struct wlr_texture_impl {
 void wlr_texture_init(struct wlr_texture *texture,
 	const struct wlr_texture_impl *impl);
 
+struct wlr_render_timer_impl {
+	void (*begin)(struct wlr_render_timer *timer);
+	void (*end)(struct wlr_render_timer *timer);
+	int64_t (*get_duration_ns)(struct wlr_render_timer *timer);
+	void (*destroy)(struct wlr_render_timer *timer);
+};
+
+struct wlr_render_timer {
+	const struct wlr_render_timer_impl *impl;
+};
+
+void wlr_render_timer_init(struct wlr_render_timer *timer,
+	const struct wlr_render_timer_impl *impl);
+
 #endif
@@ -20,6 +20,7 @@ enum wlr_renderer_read_pixels_flags {
 };
 
 struct wlr_renderer_impl;
+struct wlr_render_timer;
 
 struct wlr_renderer {
 	const struct wlr_renderer_impl *impl;
@@ -51,6 +52,13 @@ bool wlr_render_texture(struct wlr_renderer *r, struct wlr_texture *texture,
  */
 bool wlr_render_texture_with_matrix(struct wlr_renderer *r,
 	struct wlr_texture *texture, const float matrix[static 9], float alpha);
+/**
+ * Renders the part of the texture inside `box`, in texture-local coordinates,
+ * using the provided matrix.
+ */
+bool wlr_render_subtexture_with_matrix(struct wlr_renderer *r,
+	struct wlr_texture *texture, const struct wlr_fbox *box,
+	const float matrix[static 9], float alpha);
 /**
  * Renders a solid rectangle in the specified color.
  */
@@ -113,6 +121,46 @@ bool wlr_renderer_format_supported(struct wlr_renderer *r,
 	enum wl_shm_format fmt);
 void wlr_renderer_init_wl_display(struct wlr_renderer *r,
 	struct wl_display *wl_display);
+/**
+ * Creates a timer measuring how long the GPU spends executing the rendering
+ * commands issued between `wlr_render_timer_begin` and `wlr_render_timer_end`.
+ * Returns NULL if the renderer doesn't support GPU timestamp queries.
+ */
+struct wlr_render_timer *wlr_render_timer_create(struct wlr_renderer *r);
+/**
+ * Starts and stops the GPU timer. The rendering context the timer has been
+ * created with must be current.
+ */
+void wlr_render_timer_begin(struct wlr_render_timer *timer);
+void wlr_render_timer_end(struct wlr_render_timer *timer);
+/**
+ * Returns the GPU time in nanoseconds elapsed between the last begin and end,
+ * or -1 if the result isn't available yet or couldn't be measured. This never
+ * blocks, but might change the current rendering context.
+ */
+int64_t wlr_render_timer_get_duration_ns(struct wlr_render_timer *timer);
+void wlr_render_timer_destroy(struct wlr_render_timer *timer);
+/**
+ * Returns a sync file descriptor which is signalled once the GPU has finished
+ * executing all of the rendering commands issued so far, or -1 if the renderer
+ * doesn't support explicit synchronization. The caller owns the fd.
+ */
+int wlr_renderer_create_fence(struct wlr_renderer *r);
+/**
+ * Makes the GPU wait for the sync file descriptor to be signalled before
+ * executing the rendering commands issued from now on, without blocking the
+ * caller. The fd isn't consumed. Returns false if the renderer doesn't support
+ * explicit synchronization or if the fence is invalid.
+ */
+bool wlr_renderer_wait_fence(struct wlr_renderer *r, int fd);
+/**
+ * Sets a gamma ramp applied to everything rendered in the next render pass,
+ * started by `wlr_renderer_begin`, for outputs without hardware gamma support.
+ * Render passes without a gamma ramp set beforehand don't use any. A size of
+ * zero disables it. Returns false if the renderer doesn't support gamma ramps.
+ */
+bool wlr_renderer_set_gamma(struct wlr_renderer *r, size_t size,
+	const uint16_t *red, const uint16_t *green, const uint16_t *blue);
 /**
  * Destroys this wlr_renderer. Textures must be destroyed separately.
  */
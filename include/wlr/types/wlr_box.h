@@ -18,6 +18,11 @@ struct wlr_box {
 	int width, height;
 };
 
+struct wlr_fbox {
+	double x, y;
+	double width, height;
+};
+
 void wlr_box_closest_point(const struct wlr_box *box, double x, double y,
 	double *dest_x, double *dest_y);
 
@@ -41,4 +46,10 @@ void wlr_box_rotated_bounds(struct wlr_box *dest, const struct wlr_box *box, flo
 
 void wlr_box_from_pixman_box32(struct wlr_box *dest, const pixman_box32_t box);
 
+/**
+ * Transforms a floating-point box inside a `width` x `height` box.
+ */
+void wlr_fbox_transform(struct wlr_fbox *dest, const struct wlr_fbox *box,
+	enum wl_output_transform transform, double width, double height);
+
 #endif
@@ -10,6 +10,7 @@
 #define WLR_TYPES_WLR_EXPORT_DMABUF_V1_H
 
 #include <stdbool.h>
+#include <time.h>
 #include <wayland-server.h>
 #include <wlr/render/dmabuf.h>
 
@@ -35,6 +36,11 @@ struct wlr_export_dmabuf_frame_v1 {
 
 	bool cursor_locked;
 
+	// Signalled when the GPU is done rendering the frame, -1 if unknown
+	int fence_fd;
+	struct wl_event_source *fence_source;
+	struct timespec ready_time;
+
 	struct wl_listener output_swap_buffers;
 };
 
@@ -0,0 +1,136 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_INPUT_LATENCY_H
+#define WLR_TYPES_WLR_INPUT_LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_seat.h>
+
+/**
+ * Number of histogram buckets. Bucket i counts latencies in
+ * [2^i, 2^(i+1)) microseconds, the first and last buckets also count smaller
+ * and larger latencies.
+ */
+#define WLR_INPUT_LATENCY_HISTOGRAM_BUCKETS 24
+
+/**
+ * Stages starting at the input device timestamp are skipped for records
+ * without `has_input_time`.
+ */
+enum wlr_input_latency_stage {
+	// From the input device timestamp to the event being sent to the client
+	WLR_INPUT_LATENCY_DISPATCH,
+	// From the event being sent to the client to the next commit of the
+	// surface with new content
+	WLR_INPUT_LATENCY_CLIENT,
+	// From the surface commit to an output submitting a frame
+	WLR_INPUT_LATENCY_RENDER,
+	// From the frame submission to its presentation
+	WLR_INPUT_LATENCY_PRESENT,
+	// From the input device timestamp to the presentation
+	WLR_INPUT_LATENCY_TOTAL,
+	WLR_INPUT_LATENCY_STAGE_COUNT,
+};
+
+struct wlr_input_latency_histogram {
+	uint64_t buckets[WLR_INPUT_LATENCY_HISTOGRAM_BUCKETS];
+	uint64_t count;
+	uint64_t sum_usec, max_usec;
+};
+
+/**
+ * Timestamps of a single input event, taken with CLOCK_MONOTONIC.
+ */
+struct wlr_input_latency_record {
+	uint64_t id;
+	// The input event timestamp, converted to CLOCK_MONOTONIC. Only valid if
+	// `has_input_time` is set: input events generated by a nested backend or
+	// by a compositor may use another clock.
+	struct timespec input;
+	bool has_input_time;
+
+	struct timespec dispatch;
+	struct timespec commit;
+	struct timespec render;
+	struct timespec present;
+};
+
+/**
+ * Follows input events from the seat to the screen: each event sent to a
+ * client surface gets an ID, and is tracked until the surface commits new
+ * content, until one of the outputs added with
+ * `wlr_input_latency_add_output` submits a frame, and until this frame is
+ * presented.
+ *
+ * Since the Wayland protocol doesn't tell which input event a commit responds
+ * to, all events sent to a surface are attributed to its next commit with
+ * damage. The frame submitted right after the commit by any of the outputs is
+ * assumed to contain the new content. Compositor-only feedback, such as a
+ * cursor moved without the client redrawing, isn't measured.
+ *
+ * Presentation timestamps are assumed to use CLOCK_MONOTONIC, see
+ * `wlr_backend_get_presentation_clock`.
+ *
+ * Tracing is opt-in: it only happens while a `wlr_input_latency` is attached to
+ * the seat.
+ */
+struct wlr_input_latency {
+	struct wlr_seat *seat;
+
+	struct wlr_input_latency_histogram histograms[WLR_INPUT_LATENCY_STAGE_COUNT];
+	// Number of events discarded before being presented, e.g. because the
+	// surface has been destroyed or no output has been added
+	uint64_t dropped;
+
+	struct {
+		// Emitted when an event has been presented
+		struct wl_signal record; // struct wlr_input_latency_record *
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	uint64_t next_id;
+	FILE *trace;
+	struct wl_list surfaces; // wlr_input_latency_surface::link
+	struct wl_list outputs; // wlr_input_latency_output::link
+	struct wl_list committed; // wlr_input_latency_event::link
+	size_t committed_len;
+
+	struct wl_listener seat_input_dispatch;
+	struct wl_listener seat_destroy;
+};
+
+struct wlr_input_latency *wlr_input_latency_create(struct wlr_seat *seat);
+void wlr_input_latency_destroy(struct wlr_input_latency *latency);
+/**
+ * Tracks frames submitted and presented by the output. Events are only
+ * completed by outputs added with this function.
+ */
+bool wlr_input_latency_add_output(struct wlr_input_latency *latency,
+	struct wlr_output *output);
+/**
+ * Writes each presented event to `trace` in the Trace Event Format, which can
+ * be loaded in chrome://tracing or Perfetto. The caller keeps ownership of the
+ * file and must unset it before closing it. Pass NULL to stop tracing.
+ */
+void wlr_input_latency_set_trace_file(struct wlr_input_latency *latency,
+	FILE *trace);
+/**
+ * Writes a human-readable summary of the histograms to `f`.
+ */
+void wlr_input_latency_write_histograms(struct wlr_input_latency *latency,
+	FILE *f);
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_LINUX_EXPLICIT_SYNCHRONIZATION_H
+#define WLR_TYPES_WLR_LINUX_EXPLICIT_SYNCHRONIZATION_H
+
+#include <wayland-server.h>
+#include <wlr/render/wlr_renderer.h>
+
+struct wlr_linux_explicit_synchronization_v1 {
+	struct wl_global *global;
+	struct wlr_renderer *renderer;
+	struct wl_list resources; // wl_resource_get_link
+	struct wl_list surface_syncs; // wlr_linux_surface_synchronization_v1::link
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	struct wl_listener display_destroy;
+
+	void *data;
+};
+
+struct wlr_linux_surface_synchronization_v1 {
+	struct wl_resource *resource;
+	struct wlr_linux_explicit_synchronization_v1 *manager;
+	struct wlr_surface *surface; // NULL if the surface has been destroyed
+	struct wl_list link; // wlr_linux_explicit_synchronization_v1::surface_syncs
+
+	// Set by the client for the next commit
+	int pending_fence_fd; // -1 if unset
+	struct wl_resource *pending_release;
+
+	// Releases of committed buffers which haven't been applied yet
+	struct wl_list committed_releases; // wl_resource_get_link
+	// Releases of the buffer currently used by the surface
+	struct wl_list current_releases; // wl_resource_get_link
+	size_t committed_buffers;
+
+	struct wl_listener surface_destroy;
+	struct wl_listener surface_client_commit;
+	struct wl_listener surface_commit;
+};
+
+/**
+ * Creates the linux-explicit-synchronization global. Clients can then attach
+ * an acquire fence to their dmabuf buffers, which the renderer waits for on the
+ * GPU, and receive a release fence once the compositor is done reading them.
+ *
+ * Returns NULL if the renderer doesn't support explicit synchronization.
+ */
+struct wlr_linux_explicit_synchronization_v1 *
+	wlr_linux_explicit_synchronization_v1_create(struct wl_display *display,
+	struct wlr_renderer *renderer);
+void wlr_linux_explicit_synchronization_v1_destroy(
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync);
+
+#endif
@@ -78,6 +78,9 @@ struct wlr_output {
 	int32_t refresh; // mHz, may be zero
 
 	bool enabled;
+	// Whether the output supports adaptive sync (variable refresh rate)
+	bool adaptive_sync_capable;
+	bool adaptive_sync_enabled;
 	float scale;
 	enum wl_output_subpixel subpixel;
 	enum wl_output_transform transform;
@@ -94,8 +97,13 @@ struct wlr_output {
 		// Emitted when buffers need to be swapped (because software cursors or
 		// fullscreen damage or because of backend-specific logic)
 		struct wl_signal needs_swap;
+		// Emitted right after the rendering context has been made current
+		struct wl_signal make_current;
 		// Emitted right before buffer swap
 		struct wl_signal swap_buffers; // wlr_output_event_swap_buffers
+		// Emitted right after the buffers have been swapped and submitted to
+		// the backend
+		struct wl_signal commit; // wlr_output_event_swap_buffers
 		// Emitted right after the buffer has been presented to the user
 		struct wl_signal present; // wlr_output_event_present
 		struct wl_signal enable;
@@ -230,6 +238,13 @@ size_t wlr_output_get_gamma_size(struct wlr_output *output);
  */
 bool wlr_output_set_gamma(struct wlr_output *output, size_t size,
 	const uint16_t *r, const uint16_t *g, const uint16_t *b);
+/**
+ * Enables or disables adaptive sync (also known as variable refresh rate) on
+ * the output. When enabled, the display waits for new frames instead of
+ * refreshing at a fixed rate, so the frame rate of fullscreen content drives
+ * the refresh rate. Returns false if the output doesn't support it.
+ */
+bool wlr_output_enable_adaptive_sync(struct wlr_output *output, bool enabled);
 bool wlr_output_export_dmabuf(struct wlr_output *output,
 	struct wlr_dmabuf_attributes *attribs);
 struct wlr_output *wlr_output_from_resource(struct wl_resource *resource);
@@ -15,11 +15,13 @@
 #include <wlr/types/wlr_output.h>
 
 /**
- * Damage tracking requires to keep track of previous frames' damage. To allow
- * damage tracking to work with triple buffering, a history of two frames is
- * required.
+ * Damage tracking requires to keep track of previous frames' damage. The
+ * history starts with two frames, which is enough for triple buffering, and
+ * grows up to WLR_OUTPUT_DAMAGE_MAX_PREVIOUS_LEN frames when the output
+ * reports older buffers.
  */
 #define WLR_OUTPUT_DAMAGE_PREVIOUS_LEN 2
+#define WLR_OUTPUT_DAMAGE_MAX_PREVIOUS_LEN 8
 
 /**
  * Tracks damage for an output.
@@ -36,7 +38,8 @@ struct wlr_output_damage {
 	pixman_region32_t current; // in output-local coordinates
 
 	// circular queue for previous damage
-	pixman_region32_t previous[WLR_OUTPUT_DAMAGE_PREVIOUS_LEN];
+	pixman_region32_t *previous;
+	size_t previous_len;
 	size_t previous_idx;
 
 	struct {
@@ -58,6 +61,9 @@ void wlr_output_damage_destroy(struct wlr_output_damage *output_damage);
  * Makes the output rendering context current. `needs_swap` is set to true if
  * `wlr_output_damage_swap_buffers` needs to be called. The region of the output
  * that needs to be repainted is added to `damage`.
+ *
+ * If the damage is made of more than `max_rects` rectangles, it's simplified to
+ * `max_rects` rectangles covering it, see `wlr_region_simplify`.
  */
 bool wlr_output_damage_make_current(struct wlr_output_damage *output_damage,
 	bool *needs_swap, pixman_region32_t *damage);
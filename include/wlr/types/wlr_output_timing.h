@@ -0,0 +1,115 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_OUTPUT_TIMING_H
+#define WLR_TYPES_WLR_OUTPUT_TIMING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output.h>
+
+/**
+ * Number of complete frame records kept in the history.
+ */
+#define WLR_OUTPUT_TIMING_HISTORY_LEN 128
+
+enum wlr_output_timing_stage {
+	// The output emitted a `frame` event
+	WLR_OUTPUT_TIMING_FRAME = 1 << 0,
+	// The rendering context has been made current
+	WLR_OUTPUT_TIMING_RENDER_BEGIN = 1 << 1,
+	// Rendering has been finished on the CPU side, right before buffer swap
+	WLR_OUTPUT_TIMING_RENDER_END = 1 << 2,
+	// The buffers have been swapped and submitted to the backend
+	WLR_OUTPUT_TIMING_SUBMIT = 1 << 3,
+	// The backend reported that the frame has been presented
+	WLR_OUTPUT_TIMING_PRESENT = 1 << 4,
+	// The GPU reported how long it took to execute the rendering commands
+	WLR_OUTPUT_TIMING_GPU = 1 << 5,
+};
+
+/**
+ * Timestamps of a single frame. All timestamps are taken with the backend's
+ * presentation clock, see `wlr_backend_get_presentation_clock`.
+ */
+struct wlr_output_timing_record {
+	uint64_t seq; // frame counter
+	uint32_t stages; // enum wlr_output_timing_stage, which fields are valid
+
+	struct timespec frame;
+	struct timespec render_begin;
+	struct timespec render_end;
+	struct timespec submit;
+	struct timespec present;
+
+	int64_t gpu_duration_ns;
+
+	// Copied from wlr_output_event_present
+	unsigned present_seq;
+	int refresh; // nsec
+	uint32_t present_flags; // enum wlr_output_present_flag
+	// Number of vertical retraces between the previous presented frame and
+	// this one which didn't display new content. Zero if unknown.
+	unsigned missed_vblanks;
+};
+
+/**
+ * Records where frame time goes on an output: when the frame is requested,
+ * when rendering begins and ends (including the GPU time if the renderer
+ * supports timestamp queries), when the buffers are submitted and when the
+ * frame is presented.
+ *
+ * Timing collection is opt-in: it only happens while a `wlr_output_timing` is
+ * attached to the output.
+ */
+struct wlr_output_timing {
+	struct wlr_output *output;
+	clockid_t clock;
+
+	// circular queue of complete records
+	struct wlr_output_timing_record history[WLR_OUTPUT_TIMING_HISTORY_LEN];
+	size_t history_idx, history_len;
+
+	struct {
+		// Emitted when a record is complete and has been added to the history
+		struct wl_signal record; // struct wlr_output_timing_record *
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	uint64_t next_seq;
+	struct wlr_output_timing_record pending; // being rendered
+	struct wlr_output_timing_record submitted; // waiting for presentation
+	unsigned last_present_seq;
+
+	struct wlr_render_timer *gpu_timers[2];
+	struct wlr_render_timer *pending_timer, *submitted_timer;
+	bool gpu_timers_unsupported;
+
+	struct wl_listener output_destroy;
+	struct wl_listener output_frame;
+	struct wl_listener output_make_current;
+	struct wl_listener output_swap_buffers;
+	struct wl_listener output_commit;
+	struct wl_listener output_present;
+};
+
+struct wlr_output_timing *wlr_output_timing_create(struct wlr_output *output);
+void wlr_output_timing_destroy(struct wlr_output_timing *timing);
+/**
+ * Copies up to `len` of the most recent complete records into `records`,
+ * oldest first. Returns the number of copied records.
+ */
+size_t wlr_output_timing_get_history(struct wlr_output_timing *timing,
+	struct wlr_output_timing_record *records, size_t len);
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_OUTPUT_TIMING_V1_H
+#define WLR_TYPES_WLR_OUTPUT_TIMING_V1_H
+
+#include <wayland-server.h>
+#include <wlr/types/wlr_output_timing.h>
+
+/**
+ * Exposes per-frame output timings to profiling tools. Since this leaks
+ * information about the compositor's activity, it should only be enabled for
+ * debugging purposes.
+ */
+struct wlr_output_timing_manager_v1 {
+	struct wl_global *global;
+	struct wl_list resources; // wl_resource_get_link
+	struct wl_list timings; // wlr_output_timing_v1::link
+
+	struct wl_listener display_destroy;
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+};
+
+struct wlr_output_timing_v1 {
+	struct wl_resource *resource;
+	struct wlr_output_timing_manager_v1 *manager;
+	struct wl_list link; // wlr_output_timing_manager_v1::timings
+
+	struct wlr_output_timing *timing;
+
+	struct wl_listener timing_record;
+	struct wl_listener timing_destroy;
+};
+
+struct wlr_output_timing_manager_v1 *wlr_output_timing_manager_v1_create(
+	struct wl_display *display);
+void wlr_output_timing_manager_v1_destroy(
+	struct wlr_output_timing_manager_v1 *manager);
+
+#endif
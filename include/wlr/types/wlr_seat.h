@@ -24,6 +24,7 @@ struct wlr_seat_client {
 	struct wl_client *client;
 	struct wlr_seat *seat;
 	struct wl_list link;
+	struct wl_list table_link; // wlr_seat::client_table
 
 	// lists of wl_resource
 	struct wl_list resources;
@@ -32,6 +33,12 @@ struct wlr_seat_client {
 	struct wl_list touches;
 	struct wl_list data_devices;
 
+	// Number of resources in the lists above which aren't inert
+	size_t active_pointers, active_keyboards, active_touches;
+
+	// Whether touch events were sent since the last wl_touch.frame
+	bool needs_touch_frame;
+
 	struct {
 		struct wl_signal destroy;
 	} events;
@@ -99,6 +106,7 @@ struct wlr_touch_grab_interface {
 	// XXX this will conflict with the actual touch cancel which is different so
 	// we need to rename this
 	void (*cancel)(struct wlr_seat_touch_grab *grab);
+	void (*frame)(struct wlr_seat_touch_grab *grab);
 };
 
 /**
@@ -145,7 +153,16 @@ struct wlr_seat_pointer_state {
 	uint32_t grab_serial;
 	uint32_t grab_time;
 
+	// See wlr_seat_pointer_set_motion_coalescing
+	bool coalesce_motion;
+	bool motion_pending; // coalesced motion which hasn't been sent yet
+	uint32_t motion_time_msec;
+	bool motion_throttled; // motion_timer is armed
+	bool frame_needed; // events other than coalesced motion since last frame
+	struct wl_event_source *motion_timer;
+
 	struct wl_listener surface_destroy;
+	struct wl_listener surface_frame_done;
 
 	struct {
 		struct wl_signal focus_change; // wlr_seat_pointer_focus_change_event
@@ -183,6 +200,9 @@ struct wlr_seat_touch_state {
 
 	struct wlr_seat_touch_grab *grab;
 	struct wlr_seat_touch_grab *default_grab;
+
+	// Flushes pending frames if the compositor doesn't notify them
+	struct wl_event_source *frame_idle;
 };
 
 struct wlr_primary_selection_source;
@@ -190,7 +210,10 @@ struct wlr_primary_selection_source;
 struct wlr_seat {
 	struct wl_global *global;
 	struct wl_display *display;
-	struct wl_list clients;
+	struct wl_list clients; // wlr_seat_client::link
+	// Hash table of wlr_seat_client::table_link, keyed by wl_client
+	struct wl_list *client_table;
+	size_t client_table_size, client_table_len;
 
 	char *name;
 	uint32_t capabilities;
@@ -242,6 +265,9 @@ struct wlr_seat {
 		struct wl_signal request_start_drag;
 		struct wl_signal start_drag; // wlr_drag
 
+		// Emitted when an input event is sent to a client surface
+		struct wl_signal input_dispatch; // wlr_seat_input_dispatch_event
+
 		struct wl_signal destroy;
 	} events;
 
@@ -271,6 +297,12 @@ struct wlr_seat_request_start_drag_event {
 	uint32_t serial;
 };
 
+struct wlr_seat_input_dispatch_event {
+	struct wlr_seat *seat;
+	struct wlr_surface *surface;
+	uint32_t time_msec; // timestamp of the input event
+};
+
 struct wlr_seat_pointer_focus_change_event {
 	struct wlr_seat *seat;
 	struct wlr_surface *old_surface, *new_surface;
@@ -363,6 +395,16 @@ void wlr_seat_pointer_send_axis(struct wlr_seat *wlr_seat, uint32_t time_msec,
  */
 void wlr_seat_pointer_send_frame(struct wlr_seat *wlr_seat);
 
+/**
+ * Enable or disable pointer motion coalescing, which is disabled by default.
+ * When enabled, motion events are merged until the focused surface's next
+ * frame callback, so that clients aren't woken up for every event of high
+ * polling rate mice. Pending motion is sent first when an enter, leave, button
+ * or axis event needs to be sent. Relative pointer events are not coalesced.
+ */
+void wlr_seat_pointer_set_motion_coalescing(struct wlr_seat *wlr_seat,
+		bool enabled);
+
 /**
  * Start a grab of the pointer of this seat. The grabber is responsible for
  * handling all pointer events until the grab ends.
@@ -542,6 +584,15 @@ void wlr_seat_touch_notify_up(struct wlr_seat *seat, uint32_t time_msec,
 void wlr_seat_touch_notify_motion(struct wlr_seat *seat, uint32_t time_msec,
 		int32_t touch_id, double sx, double sy);
 
+/**
+ * Notify the seat that a set of touch events belonging to the same hardware
+ * frame has been sent. Defers to any grab of the touch device. Touch events are
+ * batched until the frame, so that clients receive all points updated at once.
+ * If the compositor never notifies frames, pending frames are sent when the
+ * event loop becomes idle.
+ */
+void wlr_seat_touch_notify_frame(struct wlr_seat *seat);
+
 /**
  * Notify the seat that the touch point given by `touch_id` has entered a new
  * surface. The surface is required. To clear focus, use
@@ -587,6 +638,13 @@ void wlr_seat_touch_send_up(struct wlr_seat *seat, uint32_t time_msec,
 void wlr_seat_touch_send_motion(struct wlr_seat *seat, uint32_t time_msec,
 		int32_t touch_id, double sx, double sy);
 
+/**
+ * Send a touch frame event to all clients which received touch events since
+ * the last frame. Compositors should use `wlr_seat_touch_notify_frame()` to
+ * respect any grabs of the touch device.
+ */
+void wlr_seat_touch_send_frame(struct wlr_seat *seat);
+
 /**
  * How many touch points are currently down for the seat.
  */
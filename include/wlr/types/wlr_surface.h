@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <time.h>
 #include <wayland-server.h>
+#include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output.h>
 
 enum wlr_surface_state_field {
@@ -25,6 +26,7 @@ enum wlr_surface_state_field {
 	WLR_SURFACE_STATE_TRANSFORM = 1 << 5,
 	WLR_SURFACE_STATE_SCALE = 1 << 6,
 	WLR_SURFACE_STATE_FRAME_CALLBACK_LIST = 1 << 7,
+	WLR_SURFACE_STATE_VIEWPORT = 1 << 8,
 };
 
 struct wlr_surface_state {
@@ -41,13 +43,25 @@ struct wlr_surface_state {
 	int width, height; // in surface-local coordinates
 	int buffer_width, buffer_height;
 
+	// Set by wp_viewporter, see wlr_viewporter
+	struct {
+		bool has_src, has_dst;
+		// In coordinates after scale and transform are applied, but before the
+		// destination rectangle is applied
+		struct wlr_fbox src;
+		int dst_width, dst_height; // in surface-local coordinates
+	} viewport;
+
 	struct wl_listener buffer_destroy;
 };
 
 struct wlr_surface_role {
 	const char *name;
 	void (*commit)(struct wlr_surface *surface);
-	void (*precommit)(struct wlr_surface *surface);
+	// Called with the state about to be applied, before it replaces the
+	// current state
+	void (*precommit)(struct wlr_surface *surface,
+		const struct wlr_surface_state *state);
 };
 
 struct wlr_surface {
@@ -94,12 +108,24 @@ struct wlr_surface {
 	 * the previous commit.
 	 */
 	struct wlr_surface_state current, pending, previous;
+	/**
+	 * State committed while commits are held, see
+	 * `wlr_surface_hold_commits`.
+	 */
+	struct wlr_surface_state held;
+	bool has_held;
+	int commit_holds;
 
 	const struct wlr_surface_role *role; // the lifetime-bound role or NULL
 	void *role_data; // role-specific data
 
 	struct {
+		// Emitted when the client commits, before the pending state is
+		// cached or applied
+		struct wl_signal client_commit;
 		struct wl_signal commit;
+		// Emitted before pending frame callbacks are signaled
+		struct wl_signal frame_done; // struct timespec
 		struct wl_signal new_subsurface;
 		struct wl_signal destroy;
 	} events;
@@ -220,7 +246,6 @@ void wlr_surface_send_leave(struct wlr_surface *surface,
 void wlr_surface_send_frame_done(struct wlr_surface *surface,
 		const struct timespec *when);
 
-struct wlr_box;
 /**
  * Get the bounding box that contains the surface and all subsurfaces in
  * surface coordinates.
@@ -230,6 +255,15 @@ void wlr_surface_get_extends(struct wlr_surface *surface, struct wlr_box *box);
 
 struct wlr_surface *wlr_surface_from_resource(struct wl_resource *resource);
 
+/**
+ * Get the source rectangle describing the region of the buffer that needs to
+ * be sampled to render this surface's current state, in buffer-local
+ * coordinates. The whole buffer is used unless the surface has a viewport
+ * source rectangle.
+ */
+void wlr_surface_get_buffer_source_box(struct wlr_surface *surface,
+	struct wlr_fbox *box);
+
 /**
  * Call `iterator` on each surface in the surface tree, with the surface's
  * position relative to the root surface. The function is called from root to
@@ -246,4 +280,13 @@ void wlr_surface_for_each_surface(struct wlr_surface *surface,
 void wlr_surface_get_effective_damage(struct wlr_surface *surface,
 	pixman_region32_t *damage);
 
+/**
+ * Defers the application of the surface's commits: committed state is
+ * accumulated until the last hold is released, and is then applied at once.
+ * Synchronized subsurfaces are applied along with their parent. Holds can't be
+ * taken on subsurfaces.
+ */
+void wlr_surface_hold_commits(struct wlr_surface *surface);
+void wlr_surface_release_commits(struct wlr_surface *surface);
+
 #endif
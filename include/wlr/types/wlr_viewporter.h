@@ -0,0 +1,48 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_VIEWPORTER_H
+#define WLR_TYPES_WLR_VIEWPORTER_H
+
+#include <wayland-server.h>
+
+/**
+ * Implements wp_viewporter: clients can crop their buffers and scale them to
+ * a destination size, e.g. to submit low-resolution buffers which are
+ * upscaled by the compositor.
+ *
+ * The viewport is stored in `wlr_surface_state.viewport` and is applied to the
+ * surface size and damage. Compositors need to render the buffer region given
+ * by `wlr_surface_get_buffer_source_box` to the surface size, e.g. with
+ * `wlr_render_subtexture_with_matrix`.
+ */
+struct wlr_viewporter {
+	struct wl_global *global;
+	struct wl_list resources; // wl_resource_get_link
+	struct wl_list viewports; // wlr_viewport::link
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	struct wl_listener display_destroy;
+};
+
+struct wlr_viewport {
+	struct wl_resource *resource;
+	struct wlr_surface *surface; // NULL if destroyed
+	struct wl_list link; // wlr_viewporter::viewports
+
+	struct wl_listener surface_client_commit;
+	struct wl_listener surface_destroy;
+};
+
+struct wlr_viewporter *wlr_viewporter_create(struct wl_display *display);
+void wlr_viewporter_destroy(struct wlr_viewporter *viewporter);
+
+#endif
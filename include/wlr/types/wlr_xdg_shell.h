@@ -122,6 +122,10 @@ struct wlr_xdg_toplevel {
 	struct wlr_xdg_toplevel_state client_pending;
 	struct wlr_xdg_toplevel_state server_pending;
 	struct wlr_xdg_toplevel_state current;
+	// Acked by the client and latched by its next commit, applied to current
+	// along with the surface state of that commit
+	struct wlr_xdg_toplevel_state acked, committed;
+	bool has_acked, has_committed;
 
 	char *title;
 	char *app_id;
@@ -183,6 +187,7 @@ struct wlr_xdg_surface {
 
 	struct wl_listener surface_destroy;
 	struct wl_listener surface_commit;
+	struct wl_listener surface_client_commit;
 
 	struct {
 		struct wl_signal destroy;
@@ -394,4 +399,69 @@ uint32_t wlr_xdg_surface_schedule_configure(struct wlr_xdg_surface *surface);
 void wlr_xdg_surface_for_each_popup(struct wlr_xdg_surface *surface,
 	wlr_surface_iterator_func_t iterator, void *user_data);
 
+/**
+ * A set of toplevel configures applied atomically. Commits of participating
+ * toplevels (and their synchronized subsurfaces) are held until each of them
+ * has committed a configure with the expected serial, or until the timeout
+ * expires. All held states are then applied together, so that the compositor
+ * can render a single frame with all the new sizes.
+ */
+struct wlr_xdg_transaction {
+	struct wl_list participants; // wlr_xdg_transaction_participant::link
+	size_t waiting; // number of participants which haven't committed yet
+
+	struct {
+		/**
+		 * Emitted after the state of all participants has been applied,
+		 * right before the transaction is destroyed.
+		 */
+		struct wl_signal apply;
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	struct wl_event_loop *event_loop;
+	struct wl_event_source *timer;
+	struct wl_event_source *apply_idle;
+	bool committed;
+
+	void *data;
+};
+
+struct wlr_xdg_transaction_participant {
+	struct wlr_xdg_transaction *transaction;
+	// The xdg_surface may be destroyed before the wlr_surface
+	struct wlr_surface *surface;
+	uint32_t serial;
+	bool ready;
+	struct wl_list link; // wlr_xdg_transaction::participants
+
+	struct wl_listener surface_client_commit;
+	struct wl_listener surface_destroy;
+};
+
+struct wlr_xdg_transaction *wlr_xdg_transaction_create(
+	struct wl_display *display);
+/**
+ * Adds a toplevel to the transaction. `serial` is the configure serial returned
+ * by e.g. `wlr_xdg_toplevel_set_size`. If it is zero, the toplevel is already
+ * in the requested state and isn't added. Commits of the toplevel are held
+ * from now on.
+ */
+bool wlr_xdg_transaction_add_toplevel(struct wlr_xdg_transaction *transaction,
+	struct wlr_xdg_surface *surface, uint32_t serial);
+/**
+ * Stops adding participants and waits for them. The transaction is applied and
+ * destroyed once all participants are ready, or after `timeout_ms`
+ * milliseconds. If `timeout_ms` is zero or negative, the transaction never
+ * times out and waits until all participants are ready or destroyed.
+ */
+void wlr_xdg_transaction_commit(struct wlr_xdg_transaction *transaction,
+	int timeout_ms);
+/**
+ * Applies the transaction right away and destroys it.
+ */
+void wlr_xdg_transaction_destroy(struct wlr_xdg_transaction *transaction);
+
 #endif
@@ -30,6 +30,13 @@
 void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
 	float scale);
 
+/**
+ * Scales a region with different factors for each axis, see
+ * `wlr_region_scale`.
+ */
+void wlr_region_scale_xy(pixman_region32_t *dst, pixman_region32_t *src,
+	float scale_x, float scale_y);
+
 /**
  * Applies a transform to a region inside a box of size `width` x `height`.
  */
@@ -50,6 +57,14 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 	float rotation, int ox, int oy);
 
+/**
+ * Approximates a region with at most `max_rects` rectangles. The resulting
+ * region contains `src`. Nearby rectangles are merged first, so that as little
+ * area as possible is added.
+ */
+void wlr_region_simplify(pixman_region32_t *dst, pixman_region32_t *src,
+	int max_rects);
+
 bool wlr_region_confine(pixman_region32_t *region, double x1, double y1, double x2,
 	double y2, double *x2_out, double *y2_out);
 
@@ -61,14 +61,24 @@ struct wlr_xcursor {
 	uint32_t total_delay; /* length of the animation in ms */
 };
 
+struct wlr_xcursor_theme_index;
+
 /**
  * Container for an Xcursor theme.
+ *
+ * Cursors are decoded lazily: `cursors` only contains the cursors which have
+ * been obtained with wlr_xcursor_theme_get_cursor so far, unless the built-in
+ * theme is used.
  */
 struct wlr_xcursor_theme {
 	unsigned int cursor_count;
 	struct wlr_xcursor **cursors;
 	char *name;
 	int size;
+
+	// private state
+
+	struct wlr_xcursor_theme_index *index; // NULL for the built-in theme
 };
 
 /**
@@ -80,10 +90,19 @@ struct wlr_xcursor_theme {
  */
 struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size);
 
+/**
+ * Loads the same xcursor theme as `theme` at another cursor size. The theme
+ * directories aren't scanned again, and cursor images are shared with all
+ * themes loaded this way when the cursor files don't provide a closer size.
+ */
+struct wlr_xcursor_theme *wlr_xcursor_theme_load_size(
+	struct wlr_xcursor_theme *theme, int size);
+
 void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme);
 
 /**
  * Obtains a wlr_xcursor image for the specified cursor name (e.g. "left_ptr").
+ * The cursor file is decoded the first time the cursor is requested.
  */
 struct wlr_xcursor *wlr_xcursor_theme_get_cursor(
 	struct wlr_xcursor_theme *theme, const char *name);
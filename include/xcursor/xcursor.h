@@ -58,8 +58,14 @@ XcursorLibraryLoadImages (const char *file, const char *theme, int size);
 void
 XcursorImagesDestroy (XcursorImages *images);
 
+unsigned int
+xcursor_file_best_size(const char *path, int size);
+
+XcursorImages *
+xcursor_file_load_images(const char *path, const char *name, int size);
+
 void
-xcursor_load_theme(const char *theme, int size,
-		    void (*load_callback)(XcursorImages *, void *),
+xcursor_index_theme(const char *theme,
+		    void (*index_callback)(const char *, const char *, void *),
 		    void *user_data);
 #endif
@@ -1,9 +1,12 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <drm_fourcc.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <wlr/render/egl.h>
 #include <wlr/util/log.h>
 #include <wlr/util/region.h>
@@ -175,6 +178,12 @@ bool wlr_egl_init(struct wlr_egl *egl, EGLenum platform, void *remote_display,
 
 	print_dmabuf_formats(egl);
 
+	egl->exts.native_fence_sync_android =
+		check_egl_ext(egl->exts_str, "EGL_ANDROID_native_fence_sync") &&
+		check_egl_ext(egl->exts_str, "EGL_KHR_wait_sync") &&
+		eglCreateSyncKHR && eglDestroySyncKHR && eglWaitSyncKHR &&
+		eglDupNativeFenceFDANDROID;
+
 	egl->exts.bind_wayland_display_wl =
 		check_egl_ext(egl->exts_str, "EGL_WL_bind_wayland_display")
 		&& eglBindWaylandDisplayWL && eglUnbindWaylandDisplayWL
@@ -607,3 +616,62 @@ bool wlr_egl_destroy_surface(struct wlr_egl *egl, EGLSurface surface) {
 	}
 	return eglDestroySurface(egl->display, surface);
 }
+
+int wlr_egl_create_fence(struct wlr_egl *egl) {
+	if (!egl->exts.native_fence_sync_android) {
+		return -1;
+	}
+
+	EGLSyncKHR sync = eglCreateSyncKHR(egl->display,
+		EGL_SYNC_NATIVE_FENCE_ANDROID, NULL);
+	if (sync == EGL_NO_SYNC_KHR) {
+		wlr_log(WLR_ERROR, "Failed to create EGL native fence");
+		return -1;
+	}
+
+	// The fence only gets a file descriptor once it has been flushed
+	glFlush();
+
+	int fd = eglDupNativeFenceFDANDROID(egl->display, sync);
+	eglDestroySyncKHR(egl->display, sync);
+	if (fd == EGL_NO_NATIVE_FENCE_FD_ANDROID) {
+		wlr_log(WLR_ERROR, "Failed to get EGL native fence file descriptor");
+		return -1;
+	}
+
+	return fd;
+}
+
+bool wlr_egl_wait_fence(struct wlr_egl *egl, int fd) {
+	if (!egl->exts.native_fence_sync_android) {
+		return false;
+	}
+
+	// EGL takes ownership of the fd on success
+	int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (dup_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to duplicate fence fd");
+		return false;
+	}
+
+	EGLint attribs[] = {
+		EGL_SYNC_NATIVE_FENCE_FD_ANDROID, dup_fd,
+		EGL_NONE,
+	};
+	EGLSyncKHR sync = eglCreateSyncKHR(egl->display,
+		EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+	if (sync == EGL_NO_SYNC_KHR) {
+		wlr_log(WLR_ERROR, "Failed to import EGL native fence");
+		close(dup_fd);
+		return false;
+	}
+
+	EGLint ret = eglWaitSyncKHR(egl->display, sync, 0);
+	eglDestroySyncKHR(egl->display, sync);
+	if (ret != EGL_TRUE) {
+		wlr_log(WLR_ERROR, "Failed to wait for EGL native fence");
+		return false;
+	}
+
+	return true;
+}
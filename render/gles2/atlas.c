@@ -0,0 +1,264 @@
+#include <assert.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <stdlib.h>
+#include <wayland-util.h>
+#include <wlr/render/egl.h>
+#include <wlr/util/log.h>
+#include "render/gles2.h"
+
+// Width of the border around each texture
+#define ATLAS_BORDER 1
+
+static struct wlr_gles2_atlas_page *atlas_page_create(
+		struct wlr_gles2_renderer *renderer,
+		const struct wlr_gles2_pixel_format *fmt) {
+	GLint max_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (max_size < GLES2_ATLAS_PAGE_SIZE) {
+		return NULL;
+	}
+
+	struct wlr_gles2_atlas_page *page =
+		calloc(1, sizeof(struct wlr_gles2_atlas_page));
+	if (page == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	page->renderer = renderer;
+	page->gl_format = fmt->gl_format;
+	page->gl_type = fmt->gl_type;
+	wl_list_init(&page->shelves);
+
+	PUSH_GLES2_DEBUG;
+	glGenTextures(1, &page->tex);
+	glBindTexture(GL_TEXTURE_2D, page->tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, fmt->gl_format, GLES2_ATLAS_PAGE_SIZE,
+		GLES2_ATLAS_PAGE_SIZE, 0, fmt->gl_format, fmt->gl_type, NULL);
+	POP_GLES2_DEBUG;
+
+	wl_list_insert(renderer->atlas_pages.prev, &page->link);
+	wlr_log(WLR_DEBUG, "Created atlas page %u", page->tex);
+	return page;
+}
+
+static void atlas_page_reset(struct wlr_gles2_atlas_page *page) {
+	struct wlr_gles2_atlas_shelf *shelf, *tmp;
+	wl_list_for_each_safe(shelf, tmp, &page->shelves, link) {
+		wl_list_remove(&shelf->link);
+		free(shelf);
+	}
+	page->shelves_height = 0;
+}
+
+static void atlas_page_destroy(struct wlr_gles2_atlas_page *page) {
+	assert(page->allocs == 0);
+	atlas_page_reset(page);
+	PUSH_GLES2_DEBUG;
+	glDeleteTextures(1, &page->tex);
+	POP_GLES2_DEBUG;
+	wl_list_remove(&page->link);
+	free(page);
+}
+
+/**
+ * Picks the lowest shelf the texture fits in, so that short textures don't
+ * waste the space of tall shelves. Opens a new shelf if needed.
+ */
+static struct wlr_gles2_atlas_shelf *atlas_page_find_shelf(
+		struct wlr_gles2_atlas_page *page, int width, int height) {
+	struct wlr_gles2_atlas_shelf *shelf, *best = NULL;
+	wl_list_for_each(shelf, &page->shelves, link) {
+		if (shelf->height < height ||
+				GLES2_ATLAS_PAGE_SIZE - shelf->x < width) {
+			continue;
+		}
+		// Unused shelves can be taken by textures of any height
+		if (shelf->allocs > 0 && shelf->height > height + height / 2) {
+			continue;
+		}
+		if (best == NULL || shelf->height < best->height) {
+			best = shelf;
+		}
+	}
+	if (best != NULL) {
+		return best;
+	}
+
+	if (page->shelves_height + height > GLES2_ATLAS_PAGE_SIZE) {
+		return NULL;
+	}
+	shelf = calloc(1, sizeof(struct wlr_gles2_atlas_shelf));
+	if (shelf == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	shelf->y = page->shelves_height;
+	shelf->height = height;
+	page->shelves_height += height;
+	wl_list_insert(page->shelves.prev, &shelf->link);
+	return shelf;
+}
+
+bool gles2_atlas_alloc(struct wlr_gles2_renderer *renderer,
+		const struct wlr_gles2_pixel_format *fmt,
+		struct wlr_gles2_texture *texture) {
+	if (texture->width > GLES2_ATLAS_MAX_TEXTURE_SIZE ||
+			texture->height > GLES2_ATLAS_MAX_TEXTURE_SIZE) {
+		return false;
+	}
+	int width = texture->width + 2 * ATLAS_BORDER;
+	int height = texture->height + 2 * ATLAS_BORDER;
+
+	size_t num_pages = 0;
+	struct wlr_gles2_atlas_page *page;
+	struct wlr_gles2_atlas_shelf *shelf = NULL;
+	wl_list_for_each(page, &renderer->atlas_pages, link) {
+		if (page->gl_format != fmt->gl_format || page->gl_type != fmt->gl_type) {
+			continue;
+		}
+		++num_pages;
+		shelf = atlas_page_find_shelf(page, width, height);
+		if (shelf != NULL) {
+			break;
+		}
+	}
+	if (shelf == NULL) {
+		if (num_pages >= GLES2_ATLAS_MAX_PAGES) {
+			return false;
+		}
+		page = atlas_page_create(renderer, fmt);
+		if (page == NULL) {
+			return false;
+		}
+		shelf = atlas_page_find_shelf(page, width, height);
+		if (shelf == NULL) {
+			atlas_page_destroy(page);
+			return false;
+		}
+	}
+
+	texture->atlas_page = page;
+	texture->atlas_shelf = shelf;
+	texture->atlas_x = shelf->x + ATLAS_BORDER;
+	texture->atlas_y = shelf->y + ATLAS_BORDER;
+	texture->gl_tex = page->tex;
+	shelf->x += width;
+	shelf->allocs++;
+	page->allocs++;
+	return true;
+}
+
+void gles2_atlas_free(struct wlr_gles2_texture *texture) {
+	struct wlr_gles2_atlas_page *page = texture->atlas_page;
+	struct wlr_gles2_atlas_shelf *shelf = texture->atlas_shelf;
+	texture->atlas_page = NULL;
+	texture->atlas_shelf = NULL;
+
+	if (--shelf->allocs == 0) {
+		shelf->x = 0;
+	}
+	if (--page->allocs > 0) {
+		return;
+	}
+
+	if (page->renderer == NULL) {
+		atlas_page_destroy(page);
+		return;
+	}
+
+	// Keep one empty page around for each format, release the others
+	struct wlr_gles2_atlas_page *other;
+	wl_list_for_each(other, &page->renderer->atlas_pages, link) {
+		if (other != page && other->allocs == 0 &&
+				other->gl_format == page->gl_format &&
+				other->gl_type == page->gl_type) {
+			atlas_page_destroy(page);
+			return;
+		}
+	}
+	atlas_page_reset(page);
+}
+
+static void upload_rect(const struct wlr_gles2_pixel_format *fmt,
+		uint32_t src_x, uint32_t src_y,
+		uint32_t width, uint32_t height, int dst_x, int dst_y,
+		const void *data) {
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, src_x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, src_y);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, dst_x, dst_y, width, height,
+		fmt->gl_format, fmt->gl_type, data);
+}
+
+void gles2_atlas_write_pixels(struct wlr_gles2_texture *texture,
+		uint32_t stride, uint32_t width, uint32_t height,
+		uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y,
+		const void *data) {
+	const struct wlr_gles2_pixel_format *fmt =
+		get_gles2_format_from_wl(texture->wl_format);
+	assert(fmt);
+	if (width == 0 || height == 0) {
+		return;
+	}
+
+	PUSH_GLES2_DEBUG;
+
+	glBindTexture(GL_TEXTURE_2D, texture->gl_tex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride / (fmt->bpp / 8));
+
+	int x = texture->atlas_x + dst_x;
+	int y = texture->atlas_y + dst_y;
+	upload_rect(fmt, src_x, src_y, width, height, x, y, data);
+
+	// Duplicate the edges of the texture into its border
+	uint32_t last_x = src_x + width - 1, last_y = src_y + height - 1;
+	bool left = dst_x == 0, top = dst_y == 0;
+	bool right = dst_x + width == (uint32_t)texture->width;
+	bool bottom = dst_y + height == (uint32_t)texture->height;
+	if (top) {
+		upload_rect(fmt, src_x, src_y, width, 1, x, y - 1, data);
+	}
+	if (bottom) {
+		upload_rect(fmt, src_x, last_y, width, 1, x, y + height, data);
+	}
+	if (left) {
+		upload_rect(fmt, src_x, src_y, 1, height, x - 1, y, data);
+	}
+	if (right) {
+		upload_rect(fmt, last_x, src_y, 1, height, x + width, y, data);
+	}
+	if (top && left) {
+		upload_rect(fmt, src_x, src_y, 1, 1, x - 1, y - 1, data);
+	}
+	if (top && right) {
+		upload_rect(fmt, last_x, src_y, 1, 1, x + width, y - 1, data);
+	}
+	if (bottom && left) {
+		upload_rect(fmt, src_x, last_y, 1, 1, x - 1, y + height, data);
+	}
+	if (bottom && right) {
+		upload_rect(fmt, last_x, last_y, 1, 1, x + width, y + height, data);
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0);
+
+	POP_GLES2_DEBUG;
+}
+
+void finish_gles2_atlas(struct wlr_gles2_renderer *renderer) {
+	struct wlr_gles2_atlas_page *page, *tmp;
+	wl_list_for_each_safe(page, tmp, &renderer->atlas_pages, link) {
+		if (page->allocs == 0) {
+			atlas_page_destroy(page);
+		} else {
+			// Destroyed along with its last texture
+			page->renderer = NULL;
+			wl_list_remove(&page->link);
+			wl_list_init(&page->link);
+		}
+	}
+}
@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "glapi.h"
+#include "render/gles2.h"
+
+#define PROGRAM_CACHE_VERSION 1
+
+static const char program_cache_magic[4] = { 'W', 'L', 'R', 'P' };
+
+struct program_cache_header {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t len;
+};
+
+static uint64_t hash_str(uint64_t hash, const char *str) {
+	// FNV-1a, including the terminating NUL byte
+	do {
+		hash ^= (uint8_t)*str;
+		hash *= 0x100000001b3;
+	} while (*str++ != '\0');
+	return hash;
+}
+
+/**
+ * Binaries can only be loaded by the same driver, so the driver strings are
+ * part of the key along with the sources.
+ */
+static uint64_t get_program_key(const GLchar *vert_src,
+		const GLchar *frag_src) {
+	const char *strs[] = {
+		(const char *)glGetString(GL_VENDOR),
+		(const char *)glGetString(GL_RENDERER),
+		(const char *)glGetString(GL_VERSION),
+		vert_src,
+		frag_src,
+	};
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < sizeof(strs) / sizeof(strs[0]); ++i) {
+		hash = hash_str(hash, strs[i] != NULL ? strs[i] : "");
+	}
+	return hash;
+}
+
+// Returns the path of the cache file in a static buffer, NULL if unavailable
+static const char *get_cache_path(uint64_t key, bool create_dir) {
+	static char path[4096];
+
+	const char *no_cache = getenv("WLR_GLES2_NO_PROGRAM_CACHE");
+	if (no_cache != NULL && strcmp(no_cache, "1") == 0) {
+		return NULL;
+	}
+
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	int n;
+	if (cache_home != NULL && cache_home[0] == '/') {
+		n = snprintf(path, sizeof(path), "%s/wlroots", cache_home);
+	} else if (home != NULL) {
+		n = snprintf(path, sizeof(path), "%s/.cache/wlroots", home);
+	} else {
+		return NULL;
+	}
+	if (n < 0 || (size_t)n >= sizeof(path)) {
+		return NULL;
+	}
+
+	if (create_dir) {
+		// The parent directory may not exist yet either
+		char *sep = strrchr(path, '/');
+		*sep = '\0';
+		if (mkdir(path, 0700) != 0 && errno != EEXIST) {
+			return NULL;
+		}
+		*sep = '/';
+		if (mkdir(path, 0700) != 0 && errno != EEXIST) {
+			wlr_log_errno(WLR_DEBUG, "Failed to create '%s'", path);
+			return NULL;
+		}
+	}
+
+	size_t len = strlen(path);
+	n = snprintf(path + len, sizeof(path) - len,
+		"/gles2-program-%016"PRIx64".bin", key);
+	if (n < 0 || (size_t)n >= sizeof(path) - len) {
+		return NULL;
+	}
+	return path;
+}
+
+GLuint load_gles2_cached_program(const GLchar *vert_src,
+		const GLchar *frag_src) {
+	uint64_t key = get_program_key(vert_src, frag_src);
+	const char *path = get_cache_path(key, false);
+	if (path == NULL) {
+		return 0;
+	}
+
+	FILE *f = fopen(path, "rbe");
+	if (f == NULL) {
+		return 0;
+	}
+
+	GLuint prog = 0;
+	void *data = NULL;
+	struct program_cache_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+			memcmp(header.magic, program_cache_magic, 4) != 0 ||
+			header.version != PROGRAM_CACHE_VERSION || header.key != key ||
+			header.len == 0) {
+		goto out;
+	}
+
+	data = malloc(header.len);
+	if (data == NULL || fread(data, header.len, 1, f) != 1) {
+		goto out;
+	}
+
+	PUSH_GLES2_DEBUG;
+	prog = glCreateProgram();
+	glProgramBinaryOES(prog, header.format, data, header.len);
+	GLint ok;
+	glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+	if (ok == GL_FALSE) {
+		// e.g. after a driver update which didn't change its version string
+		wlr_log(WLR_DEBUG, "Discarding stale shader program binary '%s'", path);
+		glDeleteProgram(prog);
+		prog = 0;
+	}
+	POP_GLES2_DEBUG;
+
+out:
+	free(data);
+	fclose(f);
+	return prog;
+}
+
+void save_gles2_cached_program(GLuint prog, const GLchar *vert_src,
+		const GLchar *frag_src) {
+	uint64_t key = get_program_key(vert_src, frag_src);
+	const char *path = get_cache_path(key, true);
+	if (path == NULL) {
+		return;
+	}
+
+	PUSH_GLES2_DEBUG;
+	GLint len = 0;
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH_OES, &len);
+	void *data = len > 0 ? malloc(len) : NULL;
+	GLenum format = 0;
+	GLsizei written = 0;
+	if (data != NULL) {
+		glGetProgramBinaryOES(prog, len, &written, &format, data);
+	}
+	POP_GLES2_DEBUG;
+	if (written <= 0) {
+		free(data);
+		return;
+	}
+
+	struct program_cache_header header = {
+		.version = PROGRAM_CACHE_VERSION,
+		.key = key,
+		.format = format,
+		.len = written,
+	};
+	memcpy(header.magic, program_cache_magic, sizeof(header.magic));
+
+	// Written to a temporary file first, so that compositors starting
+	// concurrently never read a partial file
+	char tmp_path[strlen(path) + 8];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path);
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		wlr_log_errno(WLR_DEBUG, "Failed to create '%s'", tmp_path);
+		free(data);
+		return;
+	}
+
+	bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+		write(fd, data, written) == written;
+	close(fd);
+	free(data);
+	if (!ok || rename(tmp_path, path) != 0) {
+		wlr_log_errno(WLR_DEBUG, "Failed to write '%s'", path);
+		unlink(tmp_path);
+	}
+}
@@ -40,6 +40,10 @@ static void gles2_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
 	renderer->viewport_width = width;
 	renderer->viewport_height = height;
 
+	// The gamma ramp only applies to the render pass it has been set for
+	renderer->gamma.enabled = renderer->gamma.pending;
+	renderer->gamma.pending = false;
+
 	// enable transparency
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
@@ -55,9 +59,37 @@ static void gles2_end(struct wlr_renderer *wlr_renderer) {
 	// no-op
 }
 
+// Applies the gamma ramp to a solid color, premultiplied like in the shaders
+static void gamma_apply_color(struct wlr_gles2_renderer *renderer,
+		const float color[static 4], float out[static 4]) {
+	memcpy(out, color, 4 * sizeof(float));
+	if (!renderer->gamma.enabled || color[3] <= 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < 3; ++i) {
+		float val = color[i] / color[3];
+		if (val < 0) {
+			val = 0;
+		} else if (val > 1) {
+			val = 1;
+		}
+		float pos = val * (GLES2_GAMMA_LUT_SIZE - 1);
+		size_t j = (size_t)pos;
+		size_t k = j + 1 < GLES2_GAMMA_LUT_SIZE ? j + 1 : j;
+		float a = renderer->gamma.lut[4 * j + i];
+		float b = renderer->gamma.lut[4 * k + i];
+		out[i] = (a + (b - a) * (pos - j)) / 255 * color[3];
+	}
+}
+
 static void gles2_clear(struct wlr_renderer *wlr_renderer,
-		const float color[static 4]) {
-	gles2_get_renderer_in_context(wlr_renderer);
+		const float _color[static 4]) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+
+	float color[4];
+	gamma_apply_color(renderer, _color, color);
 
 	PUSH_GLES2_DEBUG;
 	glClearColor(color[0], color[1], color[2], color[3]);
@@ -84,7 +116,7 @@ static void gles2_scissor(struct wlr_renderer *wlr_renderer,
 	POP_GLES2_DEBUG;
 }
 
-static void draw_quad(void) {
+static void draw_quad_with_texcoord(float x1, float y1, float x2, float y2) {
 	GLfloat verts[] = {
 		1, 0, // top right
 		0, 0, // top left
@@ -92,10 +124,10 @@ static void draw_quad(void) {
 		0, 1, // bottom left
 	};
 	GLfloat texcoord[] = {
-		1, 0, // top right
-		0, 0, // top left
-		1, 1, // bottom right
-		0, 1, // bottom left
+		x2, y1, // top right
+		x1, y1, // top left
+		x2, y2, // bottom right
+		x1, y2, // bottom left
 	};
 
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, verts);
@@ -110,8 +142,13 @@ static void draw_quad(void) {
 	glDisableVertexAttribArray(1);
 }
 
-static bool gles2_render_texture_with_matrix(struct wlr_renderer *wlr_renderer,
-		struct wlr_texture *wlr_texture, const float matrix[static 9],
+static void draw_quad(void) {
+	draw_quad_with_texcoord(0, 0, 1, 1);
+}
+
+static bool gles2_render_subtexture_with_matrix(
+		struct wlr_renderer *wlr_renderer, struct wlr_texture *wlr_texture,
+		const struct wlr_fbox *box, const float matrix[static 9],
 		float alpha) {
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
@@ -165,8 +202,24 @@ static bool gles2_render_texture_with_matrix(struct wlr_renderer *wlr_renderer,
 	glUniform1i(shader->invert_y, texture->inverted_y);
 	glUniform1i(shader->tex, 0);
 	glUniform1f(shader->alpha, alpha);
+	glUniform1i(shader->gamma, renderer->gamma.enabled);
+	if (renderer->gamma.enabled) {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, renderer->gamma.tex);
+		glUniform1i(shader->gamma_lut, 1);
+		glActiveTexture(GL_TEXTURE0);
+	}
 
-	draw_quad();
+	float x = box->x, y = box->y;
+	float tex_width = texture->width, tex_height = texture->height;
+	if (texture->atlas_page != NULL) {
+		// Only sample the texture's part of the atlas page
+		x += texture->atlas_x;
+		y += texture->atlas_y;
+		tex_width = tex_height = GLES2_ATLAS_PAGE_SIZE;
+	}
+	draw_quad_with_texcoord(x / tex_width, y / tex_height,
+		(x + box->width) / tex_width, (y + box->height) / tex_height);
 
 	POP_GLES2_DEBUG;
 	return true;
@@ -174,10 +227,13 @@ static bool gles2_render_texture_with_matrix(struct wlr_renderer *wlr_renderer,
 
 
 static void gles2_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
-		const float color[static 4], const float matrix[static 9]) {
+		const float _color[static 4], const float matrix[static 9]) {
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	float color[4];
+	gamma_apply_color(renderer, _color, color);
+
 	// OpenGL ES 2 requires the glUniformMatrix3fv transpose parameter to be set
 	// to GL_FALSE
 	float transposition[9];
@@ -193,10 +249,13 @@ static void gles2_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 }
 
 static void gles2_render_ellipse_with_matrix(struct wlr_renderer *wlr_renderer,
-		const float color[static 4], const float matrix[static 9]) {
+		const float _color[static 4], const float matrix[static 9]) {
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	float color[4];
+	gamma_apply_color(renderer, _color, color);
+
 	// OpenGL ES 2 requires the glUniformMatrix3fv transpose parameter to be set
 	// to GL_FALSE
 	float transposition[9];
@@ -307,9 +366,6 @@ static bool gles2_read_pixels(struct wlr_renderer *wlr_renderer,
 
 	PUSH_GLES2_DEBUG;
 
-	// Make sure any pending drawing is finished before we try to read it
-	glFinish();
-
 	glGetError(); // Clear the error flag
 
 	unsigned char *p = (unsigned char *)data + dst_y * stride;
@@ -341,6 +397,15 @@ static struct wlr_texture *gles2_texture_from_pixels(
 		struct wlr_renderer *wlr_renderer, enum wl_shm_format wl_fmt,
 		uint32_t stride, uint32_t width, uint32_t height, const void *data) {
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+	// Textures may be created outside of a render pass
+	if (!wlr_egl_is_current(renderer->egl)) {
+		wlr_egl_make_current(renderer->egl, EGL_NO_SURFACE, NULL);
+	}
+	struct wlr_texture *texture = gles2_texture_from_pixels_in_atlas(renderer,
+		wl_fmt, stride, width, height, data);
+	if (texture != NULL) {
+		return texture;
+	}
 	return wlr_gles2_texture_from_pixels(renderer->egl, wl_fmt, stride, width,
 		height, data);
 }
@@ -378,8 +443,11 @@ static void gles2_destroy(struct wlr_renderer *wlr_renderer) {
 	glDeleteProgram(renderer->shaders.tex_rgba.program);
 	glDeleteProgram(renderer->shaders.tex_rgbx.program);
 	glDeleteProgram(renderer->shaders.tex_ext.program);
+	glDeleteTextures(1, &renderer->gamma.tex);
 	POP_GLES2_DEBUG;
 
+	finish_gles2_atlas(renderer);
+
 	if (renderer->exts.debug_khr) {
 		glDisable(GL_DEBUG_OUTPUT_KHR);
 		glDebugMessageCallbackKHR(NULL, NULL);
@@ -388,13 +456,190 @@ static void gles2_destroy(struct wlr_renderer *wlr_renderer) {
 	free(renderer);
 }
 
+static bool gles2_set_gamma(struct wlr_renderer *wlr_renderer, size_t size,
+		const uint16_t *r, const uint16_t *g, const uint16_t *b) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+
+	if (size == 0) {
+		renderer->gamma.pending = false;
+		return true;
+	}
+
+	// Resample the ramp, 8 bits per channel are enough for 8-bit outputs
+	uint8_t lut[GLES2_GAMMA_LUT_SIZE * 4];
+	for (size_t i = 0; i < GLES2_GAMMA_LUT_SIZE; ++i) {
+		size_t j = i * (size - 1) / (GLES2_GAMMA_LUT_SIZE - 1);
+		lut[4 * i] = r[j] >> 8;
+		lut[4 * i + 1] = g[j] >> 8;
+		lut[4 * i + 2] = b[j] >> 8;
+		lut[4 * i + 3] = 0xFF;
+	}
+
+	renderer->gamma.pending = true;
+	if (renderer->gamma.tex != 0 &&
+			memcmp(lut, renderer->gamma.lut, sizeof(lut)) == 0) {
+		return true;
+	}
+	memcpy(renderer->gamma.lut, lut, sizeof(lut));
+
+	PUSH_GLES2_DEBUG;
+	if (renderer->gamma.tex == 0) {
+		glGenTextures(1, &renderer->gamma.tex);
+	}
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, renderer->gamma.tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, GLES2_GAMMA_LUT_SIZE, 1, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, lut);
+	glActiveTexture(GL_TEXTURE0);
+	POP_GLES2_DEBUG;
+	return true;
+}
+
+static const struct wlr_render_timer_impl render_timer_impl;
+
+static struct wlr_gles2_render_timer *gles2_get_render_timer(
+		struct wlr_render_timer *wlr_timer) {
+	assert(wlr_timer->impl == &render_timer_impl);
+	return (struct wlr_gles2_render_timer *)wlr_timer;
+}
+
+static void gles2_render_timer_begin(struct wlr_render_timer *wlr_timer) {
+	struct wlr_gles2_render_timer *timer = gles2_get_render_timer(wlr_timer);
+	assert(wlr_egl_is_current(timer->renderer->egl));
+
+	PUSH_GLES2_DEBUG;
+	// Reading GL_GPU_DISJOINT_EXT clears it, so that we only catch disjoint
+	// operations happening while the timer runs
+	GLint disjoint;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+	glQueryCounterEXT(timer->queries[0], GL_TIMESTAMP_EXT);
+	POP_GLES2_DEBUG;
+
+	timer->pending = false;
+	timer->duration_ns = -1;
+}
+
+static void gles2_render_timer_end(struct wlr_render_timer *wlr_timer) {
+	struct wlr_gles2_render_timer *timer = gles2_get_render_timer(wlr_timer);
+	assert(wlr_egl_is_current(timer->renderer->egl));
+
+	PUSH_GLES2_DEBUG;
+	glQueryCounterEXT(timer->queries[1], GL_TIMESTAMP_EXT);
+	POP_GLES2_DEBUG;
+
+	timer->pending = true;
+}
+
+static int64_t gles2_render_timer_get_duration_ns(
+		struct wlr_render_timer *wlr_timer) {
+	struct wlr_gles2_render_timer *timer = gles2_get_render_timer(wlr_timer);
+	if (!timer->pending) {
+		return timer->duration_ns;
+	}
+	if (!wlr_egl_is_current(timer->renderer->egl)) {
+		wlr_egl_make_current(timer->renderer->egl, EGL_NO_SURFACE, NULL);
+	}
+
+	PUSH_GLES2_DEBUG;
+
+	// Queries complete in order: if the end timestamp is available, so is the
+	// begin timestamp
+	GLint available = 0;
+	glGetQueryObjectivEXT(timer->queries[1], GL_QUERY_RESULT_AVAILABLE_EXT,
+		&available);
+	if (!available) {
+		POP_GLES2_DEBUG;
+		return -1;
+	}
+
+	timer->pending = false;
+
+	GLint disjoint;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+	if (!disjoint) {
+		GLuint64 begin, end;
+		glGetQueryObjectui64vEXT(timer->queries[0], GL_QUERY_RESULT_EXT, &begin);
+		glGetQueryObjectui64vEXT(timer->queries[1], GL_QUERY_RESULT_EXT, &end);
+		timer->duration_ns = end > begin ? (int64_t)(end - begin) : 0;
+	}
+
+	POP_GLES2_DEBUG;
+	return timer->duration_ns;
+}
+
+static void gles2_render_timer_destroy(struct wlr_render_timer *wlr_timer) {
+	struct wlr_gles2_render_timer *timer = gles2_get_render_timer(wlr_timer);
+	if (!wlr_egl_is_current(timer->renderer->egl)) {
+		wlr_egl_make_current(timer->renderer->egl, EGL_NO_SURFACE, NULL);
+	}
+
+	PUSH_GLES2_DEBUG;
+	glDeleteQueriesEXT(2, timer->queries);
+	POP_GLES2_DEBUG;
+
+	free(timer);
+}
+
+static const struct wlr_render_timer_impl render_timer_impl = {
+	.begin = gles2_render_timer_begin,
+	.end = gles2_render_timer_end,
+	.get_duration_ns = gles2_render_timer_get_duration_ns,
+	.destroy = gles2_render_timer_destroy,
+};
+
+static struct wlr_render_timer *gles2_render_timer_create(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+	if (!renderer->exts.disjoint_timer_query_ext) {
+		return NULL;
+	}
+
+	struct wlr_gles2_render_timer *timer =
+		calloc(1, sizeof(struct wlr_gles2_render_timer));
+	if (timer == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_render_timer_init(&timer->wlr_timer, &render_timer_impl);
+	timer->renderer = renderer;
+	timer->duration_ns = -1;
+
+	PUSH_GLES2_DEBUG;
+	glGenQueriesEXT(2, timer->queries);
+	POP_GLES2_DEBUG;
+
+	return &timer->wlr_timer;
+}
+
+static int gles2_create_fence(struct wlr_renderer *wlr_renderer) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+	if (!wlr_egl_is_current(renderer->egl)) {
+		wlr_egl_make_current(renderer->egl, EGL_NO_SURFACE, NULL);
+	}
+	return wlr_egl_create_fence(renderer->egl);
+}
+
+static bool gles2_wait_fence(struct wlr_renderer *wlr_renderer, int fd) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+	if (!wlr_egl_is_current(renderer->egl)) {
+		wlr_egl_make_current(renderer->egl, EGL_NO_SURFACE, NULL);
+	}
+	return wlr_egl_wait_fence(renderer->egl, fd);
+}
+
 static const struct wlr_renderer_impl renderer_impl = {
 	.destroy = gles2_destroy,
 	.begin = gles2_begin,
 	.end = gles2_end,
 	.clear = gles2_clear,
 	.scissor = gles2_scissor,
-	.render_texture_with_matrix = gles2_render_texture_with_matrix,
+	.render_subtexture_with_matrix = gles2_render_subtexture_with_matrix,
 	.render_quad_with_matrix = gles2_render_quad_with_matrix,
 	.render_ellipse_with_matrix = gles2_render_ellipse_with_matrix,
 	.formats = gles2_renderer_formats,
@@ -409,6 +654,10 @@ static const struct wlr_renderer_impl renderer_impl = {
 	.texture_from_wl_drm = gles2_texture_from_wl_drm,
 	.texture_from_dmabuf = gles2_texture_from_dmabuf,
 	.init_wl_display = gles2_init_wl_display,
+	.render_timer_create = gles2_render_timer_create,
+	.create_fence = gles2_create_fence,
+	.wait_fence = gles2_wait_fence,
+	.set_gamma = gles2_set_gamma,
 };
 
 void push_gles2_marker(const char *file, const char *func) {
@@ -466,9 +715,18 @@ static GLuint compile_shader(GLuint type, const GLchar *src) {
 	return shader;
 }
 
-static GLuint link_program(const GLchar *vert_src, const GLchar *frag_src) {
+static GLuint link_program(struct wlr_gles2_renderer *renderer,
+		const GLchar *vert_src, const GLchar *frag_src) {
 	PUSH_GLES2_DEBUG;
 
+	if (renderer->exts.get_program_binary_oes) {
+		GLuint prog = load_gles2_cached_program(vert_src, frag_src);
+		if (prog != 0) {
+			POP_GLES2_DEBUG;
+			return prog;
+		}
+	}
+
 	GLuint vert = compile_shader(GL_VERTEX_SHADER, vert_src);
 	if (!vert) {
 		goto error;
@@ -497,6 +755,10 @@ static GLuint link_program(const GLchar *vert_src, const GLchar *frag_src) {
 		goto error;
 	}
 
+	if (renderer->exts.get_program_binary_oes) {
+		save_gles2_cached_program(prog, vert_src, frag_src);
+	}
+
 	POP_GLES2_DEBUG;
 	return prog;
 
@@ -542,6 +804,7 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 		return NULL;
 	}
 	wlr_renderer_init(&renderer->wlr_renderer, &renderer_impl);
+	wl_list_init(&renderer->atlas_pages);
 
 	renderer->egl = egl;
 	if (!wlr_egl_make_current(renderer->egl, EGL_NO_SURFACE, NULL)) {
@@ -568,6 +831,16 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	renderer->exts.egl_image_external_oes =
 		check_gl_ext(renderer->exts_str, "GL_OES_EGL_image_external") &&
 		glEGLImageTargetTexture2DOES;
+	renderer->exts.disjoint_timer_query_ext =
+		check_gl_ext(renderer->exts_str, "GL_EXT_disjoint_timer_query") &&
+		glGenQueriesEXT && glDeleteQueriesEXT && glQueryCounterEXT &&
+		glGetQueryObjectivEXT && glGetQueryObjectui64vEXT;
+	if (check_gl_ext(renderer->exts_str, "GL_OES_get_program_binary") &&
+			glGetProgramBinaryOES && glProgramBinaryOES) {
+		GLint num_formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &num_formats);
+		renderer->exts.get_program_binary_oes = num_formats > 0;
+	}
 
 	if (renderer->exts.debug_khr) {
 		glEnable(GL_DEBUG_OUTPUT_KHR);
@@ -585,7 +858,7 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 
 	GLuint prog;
 	renderer->shaders.quad.program = prog =
-		link_program(quad_vertex_src, quad_fragment_src);
+		link_program(renderer, quad_vertex_src, quad_fragment_src);
 	if (!renderer->shaders.quad.program) {
 		goto error;
 	}
@@ -593,7 +866,7 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	renderer->shaders.quad.color = glGetUniformLocation(prog, "color");
 
 	renderer->shaders.ellipse.program = prog =
-		link_program(quad_vertex_src, ellipse_fragment_src);
+		link_program(renderer, quad_vertex_src, ellipse_fragment_src);
 	if (!renderer->shaders.ellipse.program) {
 		goto error;
 	}
@@ -601,7 +874,7 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	renderer->shaders.ellipse.color = glGetUniformLocation(prog, "color");
 
 	renderer->shaders.tex_rgba.program = prog =
-		link_program(tex_vertex_src, tex_fragment_src_rgba);
+		link_program(renderer, tex_vertex_src, tex_fragment_src_rgba);
 	if (!renderer->shaders.tex_rgba.program) {
 		goto error;
 	}
@@ -609,9 +882,12 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	renderer->shaders.tex_rgba.invert_y = glGetUniformLocation(prog, "invert_y");
 	renderer->shaders.tex_rgba.tex = glGetUniformLocation(prog, "tex");
 	renderer->shaders.tex_rgba.alpha = glGetUniformLocation(prog, "alpha");
+	renderer->shaders.tex_rgba.gamma = glGetUniformLocation(prog, "gamma");
+	renderer->shaders.tex_rgba.gamma_lut =
+		glGetUniformLocation(prog, "gamma_lut");
 
 	renderer->shaders.tex_rgbx.program = prog =
-		link_program(tex_vertex_src, tex_fragment_src_rgbx);
+		link_program(renderer, tex_vertex_src, tex_fragment_src_rgbx);
 	if (!renderer->shaders.tex_rgbx.program) {
 		goto error;
 	}
@@ -619,10 +895,13 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	renderer->shaders.tex_rgbx.invert_y = glGetUniformLocation(prog, "invert_y");
 	renderer->shaders.tex_rgbx.tex = glGetUniformLocation(prog, "tex");
 	renderer->shaders.tex_rgbx.alpha = glGetUniformLocation(prog, "alpha");
+	renderer->shaders.tex_rgbx.gamma = glGetUniformLocation(prog, "gamma");
+	renderer->shaders.tex_rgbx.gamma_lut =
+		glGetUniformLocation(prog, "gamma_lut");
 
 	if (renderer->exts.egl_image_external_oes) {
 		renderer->shaders.tex_ext.program = prog =
-			link_program(tex_vertex_src, tex_fragment_src_external);
+			link_program(renderer, tex_vertex_src, tex_fragment_src_external);
 		if (!renderer->shaders.tex_ext.program) {
 			goto error;
 		}
@@ -630,6 +909,9 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 		renderer->shaders.tex_ext.invert_y = glGetUniformLocation(prog, "invert_y");
 		renderer->shaders.tex_ext.tex = glGetUniformLocation(prog, "tex");
 		renderer->shaders.tex_ext.alpha = glGetUniformLocation(prog, "alpha");
+		renderer->shaders.tex_ext.gamma = glGetUniformLocation(prog, "gamma");
+		renderer->shaders.tex_ext.gamma_lut =
+			glGetUniformLocation(prog, "gamma_lut");
 	}
 
 	POP_GLES2_DEBUG;
@@ -39,6 +39,25 @@ const GLchar ellipse_fragment_src[] =
 "	gl_FragColor = v_color;\n"
 "}\n";
 
+// Applies the gamma ramp to a premultiplied color. The ramp has
+// GLES2_GAMMA_LUT_SIZE entries, sample at the texel centers.
+#define GAMMA_FUNC_SRC \
+"uniform bool gamma;\n" \
+"uniform sampler2D gamma_lut;\n" \
+"\n" \
+"vec4 apply_gamma(vec4 color) {\n" \
+"	if (!gamma || color.a == 0.0) {\n" \
+"		return color;\n" \
+"	}\n" \
+"	vec3 rgb = color.rgb / color.a;\n" \
+"	rgb = rgb * (255.0 / 256.0) + 0.5 / 256.0;\n" \
+"	rgb = vec3(texture2D(gamma_lut, vec2(rgb.r, 0.5)).r,\n" \
+"		texture2D(gamma_lut, vec2(rgb.g, 0.5)).g,\n" \
+"		texture2D(gamma_lut, vec2(rgb.b, 0.5)).b);\n" \
+"	return vec4(rgb * color.a, color.a);\n" \
+"}\n" \
+"\n"
+
 // Textured quads
 const GLchar tex_vertex_src[] =
 "uniform mat3 proj;\n"
@@ -61,9 +80,9 @@ const GLchar tex_fragment_src_rgba[] =
 "varying vec2 v_texcoord;\n"
 "uniform sampler2D tex;\n"
 "uniform float alpha;\n"
-"\n"
+GAMMA_FUNC_SRC
 "void main() {\n"
-"	gl_FragColor = texture2D(tex, v_texcoord) * alpha;\n"
+"	gl_FragColor = apply_gamma(texture2D(tex, v_texcoord) * alpha);\n"
 "}\n";
 
 const GLchar tex_fragment_src_rgbx[] =
@@ -71,9 +90,10 @@ const GLchar tex_fragment_src_rgbx[] =
 "varying vec2 v_texcoord;\n"
 "uniform sampler2D tex;\n"
 "uniform float alpha;\n"
-"\n"
+GAMMA_FUNC_SRC
 "void main() {\n"
-"	gl_FragColor = vec4(texture2D(tex, v_texcoord).rgb, 1.0) * alpha;\n"
+"	gl_FragColor =\n"
+"		apply_gamma(vec4(texture2D(tex, v_texcoord).rgb, 1.0) * alpha);\n"
 "}\n";
 
 const GLchar tex_fragment_src_external[] =
@@ -82,7 +102,7 @@ const GLchar tex_fragment_src_external[] =
 "varying vec2 v_texcoord;\n"
 "uniform samplerExternalOES texture0;\n"
 "uniform float alpha;\n"
-"\n"
+GAMMA_FUNC_SRC
 "void main() {\n"
-"	gl_FragColor = texture2D(texture0, v_texcoord) * alpha;\n"
+"	gl_FragColor = apply_gamma(texture2D(texture0, v_texcoord) * alpha);\n"
 "}\n";
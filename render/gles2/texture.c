@@ -56,6 +56,12 @@ static bool gles2_texture_write_pixels(struct wlr_texture *wlr_texture,
 		return false;
 	}
 
+	if (texture->atlas_page != NULL) {
+		gles2_atlas_write_pixels(texture, stride, width, height, src_x, src_y,
+			dst_x, dst_y, data);
+		return true;
+	}
+
 	const struct wlr_gles2_pixel_format *fmt =
 		get_gles2_format_from_wl(texture->wl_format);
 	assert(fmt);
@@ -84,6 +90,11 @@ static bool gles2_texture_to_dmabuf(struct wlr_texture *wlr_texture,
 		struct wlr_dmabuf_attributes *attribs) {
 	struct wlr_gles2_texture *texture = gles2_get_texture(wlr_texture);
 
+	if (texture->atlas_page != NULL) {
+		// Only a part of the atlas page belongs to the texture
+		return false;
+	}
+
 	if (!texture->image) {
 		assert(texture->type == WLR_GLES2_TEXTURE_GLTEX);
 
@@ -124,7 +135,9 @@ static void gles2_texture_destroy(struct wlr_texture *wlr_texture) {
 	}
 	wlr_egl_destroy_image(texture->egl, texture->image);
 
-	if (texture->type == WLR_GLES2_TEXTURE_GLTEX) {
+	if (texture->atlas_page != NULL) {
+		gles2_atlas_free(texture);
+	} else if (texture->type == WLR_GLES2_TEXTURE_GLTEX) {
 		glDeleteTextures(1, &texture->gl_tex);
 	}
 
@@ -182,6 +195,42 @@ struct wlr_texture *wlr_gles2_texture_from_pixels(struct wlr_egl *egl,
 	return &texture->wlr_texture;
 }
 
+struct wlr_texture *gles2_texture_from_pixels_in_atlas(
+		struct wlr_gles2_renderer *renderer, enum wl_shm_format wl_fmt,
+		uint32_t stride, uint32_t width, uint32_t height, const void *data) {
+	if (width > GLES2_ATLAS_MAX_TEXTURE_SIZE ||
+			height > GLES2_ATLAS_MAX_TEXTURE_SIZE) {
+		return NULL;
+	}
+
+	const struct wlr_gles2_pixel_format *fmt = get_gles2_format_from_wl(wl_fmt);
+	if (fmt == NULL) {
+		return NULL;
+	}
+
+	struct wlr_gles2_texture *texture =
+		calloc(1, sizeof(struct wlr_gles2_texture));
+	if (texture == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_texture_init(&texture->wlr_texture, &texture_impl);
+	texture->egl = renderer->egl;
+	texture->width = width;
+	texture->height = height;
+	texture->type = WLR_GLES2_TEXTURE_GLTEX;
+	texture->has_alpha = fmt->has_alpha;
+	texture->wl_format = fmt->wl_format;
+
+	if (!gles2_atlas_alloc(renderer, fmt, texture)) {
+		free(texture);
+		return NULL;
+	}
+
+	gles2_atlas_write_pixels(texture, stride, width, height, 0, 0, 0, 0, data);
+	return &texture->wlr_texture;
+}
+
 struct wlr_texture *wlr_gles2_texture_from_wl_drm(struct wlr_egl *egl,
 		struct wl_resource *data) {
 	if (!wlr_egl_is_current(egl)) {
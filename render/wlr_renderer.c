@@ -14,7 +14,7 @@ void wlr_renderer_init(struct wlr_renderer *renderer,
 	assert(impl->begin);
 	assert(impl->clear);
 	assert(impl->scissor);
-	assert(impl->render_texture_with_matrix);
+	assert(impl->render_subtexture_with_matrix);
 	assert(impl->render_quad_with_matrix);
 	assert(impl->render_ellipse_with_matrix);
 	assert(impl->formats);
@@ -71,7 +71,20 @@ bool wlr_render_texture(struct wlr_renderer *r, struct wlr_texture *texture,
 bool wlr_render_texture_with_matrix(struct wlr_renderer *r,
 		struct wlr_texture *texture, const float matrix[static 9],
 		float alpha) {
-	return r->impl->render_texture_with_matrix(r, texture, matrix, alpha);
+	struct wlr_fbox box = { .x = 0, .y = 0 };
+	int width, height;
+	wlr_texture_get_size(texture, &width, &height);
+	box.width = width;
+	box.height = height;
+
+	return wlr_render_subtexture_with_matrix(r, texture, &box, matrix, alpha);
+}
+
+bool wlr_render_subtexture_with_matrix(struct wlr_renderer *r,
+		struct wlr_texture *texture, const struct wlr_fbox *box,
+		const float matrix[static 9], float alpha) {
+	return r->impl->render_subtexture_with_matrix(r, texture, box, matrix,
+		alpha);
 }
 
 void wlr_render_rect(struct wlr_renderer *r, const struct wlr_box *box,
@@ -155,6 +168,64 @@ bool wlr_renderer_format_supported(struct wlr_renderer *r,
 	return r->impl->format_supported(r, fmt);
 }
 
+int wlr_renderer_create_fence(struct wlr_renderer *r) {
+	if (!r->impl->create_fence) {
+		return -1;
+	}
+	return r->impl->create_fence(r);
+}
+
+bool wlr_renderer_wait_fence(struct wlr_renderer *r, int fd) {
+	if (!r->impl->wait_fence) {
+		return false;
+	}
+	return r->impl->wait_fence(r, fd);
+}
+
+bool wlr_renderer_set_gamma(struct wlr_renderer *r, size_t size,
+		const uint16_t *red, const uint16_t *green, const uint16_t *blue) {
+	if (!r->impl->set_gamma) {
+		return false;
+	}
+	return r->impl->set_gamma(r, size, red, green, blue);
+}
+
+struct wlr_render_timer *wlr_render_timer_create(struct wlr_renderer *r) {
+	if (!r->impl->render_timer_create) {
+		return NULL;
+	}
+	return r->impl->render_timer_create(r);
+}
+
+void wlr_render_timer_init(struct wlr_render_timer *timer,
+		const struct wlr_render_timer_impl *impl) {
+	assert(impl->begin && impl->end && impl->get_duration_ns);
+	timer->impl = impl;
+}
+
+void wlr_render_timer_begin(struct wlr_render_timer *timer) {
+	timer->impl->begin(timer);
+}
+
+void wlr_render_timer_end(struct wlr_render_timer *timer) {
+	timer->impl->end(timer);
+}
+
+int64_t wlr_render_timer_get_duration_ns(struct wlr_render_timer *timer) {
+	return timer->impl->get_duration_ns(timer);
+}
+
+void wlr_render_timer_destroy(struct wlr_render_timer *timer) {
+	if (timer == NULL) {
+		return;
+	}
+	if (timer->impl && timer->impl->destroy) {
+		timer->impl->destroy(timer);
+	} else {
+		free(timer);
+	}
+}
+
 void wlr_renderer_init_wl_display(struct wlr_renderer *r,
 		struct wl_display *wl_display) {
 	if (wl_display_init_shm(wl_display)) {
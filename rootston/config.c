@@ -361,6 +361,15 @@ static int config_ini_handler(void *user, const char *section, const char *name,
 			} else {
 				wlr_log(WLR_ERROR, "got invalid output enable value: %s", value);
 			}
+		} else if (strcmp(name, "adaptive-sync") == 0) {
+			if (strcasecmp(value, "true") == 0) {
+				oc->adaptive_sync = true;
+			} else if (strcasecmp(value, "false") == 0) {
+				oc->adaptive_sync = false;
+			} else {
+				wlr_log(WLR_ERROR, "got invalid output adaptive-sync value: %s",
+					value);
+			}
 		} else if (strcmp(name, "x") == 0) {
 			oc->x = strtol(value, NULL, 10);
 		} else if (strcmp(name, "y") == 0) {
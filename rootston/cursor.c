@@ -468,6 +468,10 @@ void roots_cursor_handle_touch_motion(struct roots_cursor *cursor,
 	}
 }
 
+void roots_cursor_handle_touch_frame(struct roots_cursor *cursor) {
+	wlr_seat_touch_notify_frame(cursor->seat->seat);
+}
+
 void roots_cursor_handle_tool_axis(struct roots_cursor *cursor,
 		struct wlr_event_tablet_tool_axis *event) {
 	double x = NAN, y = NAN;
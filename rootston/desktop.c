@@ -16,11 +16,14 @@
 #include <wlr/types/wlr_idle.h>
 #include <wlr/types/wlr_input_inhibitor.h>
 #include <wlr/types/wlr_layer_shell_v1.h>
+#include <wlr/types/wlr_linux_explicit_synchronization_v1.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_output_timing_v1.h>
 #include <wlr/types/wlr_pointer_constraints_v1.h>
 #include <wlr/types/wlr_primary_selection_v1.h>
 #include <wlr/types/wlr_server_decoration.h>
 #include <wlr/types/wlr_tablet_v2.h>
+#include <wlr/types/wlr_viewporter.h>
 #include <wlr/types/wlr_wl_shell.h>
 #include <wlr/types/wlr_xcursor_manager.h>
 #include <wlr/types/wlr_xdg_output_v1.h>
@@ -405,6 +408,9 @@ struct roots_desktop *desktop_create(struct roots_server *server,
 	desktop->screenshooter = wlr_screenshooter_create(server->wl_display);
 	desktop->export_dmabuf_manager_v1 =
 		wlr_export_dmabuf_manager_v1_create(server->wl_display);
+	desktop->linux_explicit_synchronization_v1 =
+		wlr_linux_explicit_synchronization_v1_create(server->wl_display,
+		server->renderer);
 	desktop->server_decoration_manager =
 		wlr_server_decoration_manager_create(server->wl_display);
 	wlr_server_decoration_manager_set_default_mode(
@@ -435,6 +441,8 @@ struct roots_desktop *desktop_create(struct roots_server *server,
 	desktop->virtual_keyboard_new.notify = handle_virtual_keyboard;
 
 	desktop->screencopy = wlr_screencopy_manager_v1_create(server->wl_display);
+	desktop->output_timing_manager_v1 =
+		wlr_output_timing_manager_v1_create(server->wl_display);
 
 	desktop->xdg_decoration_manager =
 		wlr_xdg_decoration_manager_v1_create(server->wl_display);
@@ -459,6 +467,7 @@ struct roots_desktop *desktop_create(struct roots_server *server,
 
 	wlr_primary_selection_v1_device_manager_create(server->wl_display);
 	wlr_data_control_manager_v1_create(server->wl_display);
+	wlr_viewporter_create(server->wl_display);
 
 	return desktop;
 }
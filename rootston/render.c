@@ -42,8 +42,8 @@ static void scissor_output(struct wlr_output *wlr_output,
 
 static void render_texture(struct wlr_output *wlr_output,
 		pixman_region32_t *output_damage, struct wlr_texture *texture,
-		const struct wlr_box *box, const float matrix[static 9],
-		float rotation, float alpha) {
+		const struct wlr_fbox *src_box, const struct wlr_box *box,
+		const float matrix[static 9], float rotation, float alpha) {
 	struct wlr_renderer *renderer =
 		wlr_backend_get_renderer(wlr_output->backend);
 	assert(renderer);
@@ -65,7 +65,8 @@ static void render_texture(struct wlr_output *wlr_output,
 	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
 	for (int i = 0; i < nrects; ++i) {
 		scissor_output(wlr_output, &rects[i]);
-		wlr_render_texture_with_matrix(renderer, texture, matrix, alpha);
+		wlr_render_subtexture_with_matrix(renderer, texture, src_box, matrix,
+			alpha);
 	}
 
 damage_finish:
@@ -85,6 +86,9 @@ static void render_surface_iterator(struct roots_output *output,
 		return;
 	}
 
+	struct wlr_fbox src_box;
+	wlr_surface_get_buffer_source_box(surface, &src_box);
+
 	struct wlr_box box = *_box;
 	scale_box(&box, wlr_output->scale);
 
@@ -95,7 +99,7 @@ static void render_surface_iterator(struct roots_output *output,
 		wlr_output->transform_matrix);
 
 	render_texture(wlr_output, output_damage,
-		texture, &box, matrix, rotation, alpha);
+		texture, &src_box, &box, matrix, rotation, alpha);
 }
 
 static void render_decorations(struct roots_output *output,
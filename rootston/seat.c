@@ -182,6 +182,12 @@ static void handle_touch_motion(struct wl_listener *listener, void *data) {
 	roots_cursor_handle_touch_motion(cursor, event);
 }
 
+static void handle_touch_frame(struct wl_listener *listener, void *data) {
+	struct roots_cursor *cursor =
+		wl_container_of(listener, cursor, touch_frame);
+	roots_cursor_handle_touch_frame(cursor);
+}
+
 static void handle_tablet_tool_position(struct roots_cursor *cursor,
 		struct roots_tablet *tablet,
 		struct wlr_tablet_tool *tool,
@@ -543,6 +549,9 @@ static void roots_seat_init_cursor(struct roots_seat *seat) {
 		&seat->cursor->touch_motion);
 	seat->cursor->touch_motion.notify = handle_touch_motion;
 
+	wl_signal_add(&wlr_cursor->events.touch_frame, &seat->cursor->touch_frame);
+	seat->cursor->touch_frame.notify = handle_touch_frame;
+
 	wl_signal_add(&wlr_cursor->events.tablet_tool_axis,
 		&seat->cursor->tool_axis);
 	seat->cursor->tool_axis.notify = handle_tool_axis;
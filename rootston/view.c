@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/util/log.h>
 #include "rootston/desktop.h"
 #include "rootston/input.h"
 #include "rootston/seat.h"
@@ -20,6 +21,20 @@ void view_init(struct roots_view *view, const struct roots_view_interface *impl,
 	wl_list_init(&view->children);
 }
 
+static void output_update_adaptive_sync(struct roots_output *output) {
+	struct roots_output_config *output_config = roots_config_get_output(
+		output->desktop->config, output->wlr_output);
+	bool enabled = output->fullscreen_view != NULL &&
+		output_config != NULL && output_config->adaptive_sync;
+	if (enabled == output->wlr_output->adaptive_sync_enabled) {
+		return;
+	}
+	if (!wlr_output_enable_adaptive_sync(output->wlr_output, enabled)) {
+		wlr_log(WLR_DEBUG, "Failed to %s adaptive sync on output '%s'",
+			enabled ? "enable" : "disable", output->wlr_output->name);
+	}
+}
+
 void view_destroy(struct roots_view *view) {
 	if (view == NULL) {
 		return;
@@ -34,6 +49,7 @@ void view_destroy(struct roots_view *view) {
 	// Can happen if fullscreened while unmapped, and hasn't been mapped
 	if (view->fullscreen_output != NULL) {
 		view->fullscreen_output->fullscreen_view = NULL;
+		output_update_adaptive_sync(view->fullscreen_output);
 	}
 
 	view->impl->destroy(view);
@@ -300,6 +316,7 @@ void view_set_fullscreen(struct roots_view *view, bool fullscreen,
 
 		roots_output->fullscreen_view = view;
 		view->fullscreen_output = roots_output;
+		output_update_adaptive_sync(roots_output);
 		output_damage_whole(roots_output);
 	}
 
@@ -310,6 +327,7 @@ void view_set_fullscreen(struct roots_view *view, bool fullscreen,
 
 		output_damage_whole(view->fullscreen_output);
 		view->fullscreen_output->fullscreen_view = NULL;
+		output_update_adaptive_sync(view->fullscreen_output);
 		view->fullscreen_output = NULL;
 	}
 }
@@ -513,6 +531,7 @@ void view_unmap(struct roots_view *view) {
 	if (view->fullscreen_output != NULL) {
 		output_damage_whole(view->fullscreen_output);
 		view->fullscreen_output->fullscreen_view = NULL;
+		output_update_adaptive_sync(view->fullscreen_output);
 		view->fullscreen_output = NULL;
 	}
 
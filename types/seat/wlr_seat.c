@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -14,6 +15,40 @@
 
 #define SEAT_VERSION 6
 
+// Must be a power of two
+#define SEAT_CLIENT_TABLE_INITIAL_SIZE 16
+
+static size_t seat_client_table_index(struct wlr_seat *seat,
+		struct wl_client *wl_client) {
+	// Fibonacci hashing, the low bits of the address are mostly zero
+	uint64_t hash = (uint64_t)(uintptr_t)wl_client * 11400714819323198485ull;
+	return (size_t)(hash >> 32) & (seat->client_table_size - 1);
+}
+
+static void seat_client_table_grow(struct wlr_seat *seat) {
+	size_t size = seat->client_table_size * 2;
+	struct wl_list *table = calloc(size, sizeof(struct wl_list));
+	if (table == NULL) {
+		// Lookups still work with a higher load factor
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		wl_list_init(&table[i]);
+	}
+
+	struct wl_list *old_table = seat->client_table;
+	seat->client_table = table;
+	seat->client_table_size = size;
+
+	struct wlr_seat_client *client;
+	wl_list_for_each(client, &seat->clients, link) {
+		wl_list_insert(&table[seat_client_table_index(seat, client->client)],
+			&client->table_link);
+	}
+	free(old_table);
+}
+
 static void seat_handle_get_pointer(struct wl_client *client,
 		struct wl_resource *seat_resource, uint32_t id) {
 	struct wlr_seat_client *seat_client =
@@ -95,6 +130,8 @@ static void seat_client_handle_resource_destroy(
 	}
 
 	wl_list_remove(&client->link);
+	wl_list_remove(&client->table_link);
+	client->seat->client_table_len--;
 	free(client);
 }
 
@@ -142,6 +179,12 @@ static void seat_handle_bind(struct wl_client *client, void *_wlr_seat,
 		wl_signal_init(&seat_client->events.destroy);
 
 		wl_list_insert(&wlr_seat->clients, &seat_client->link);
+		if (++wlr_seat->client_table_len > wlr_seat->client_table_size) {
+			seat_client_table_grow(wlr_seat);
+		}
+		size_t index = seat_client_table_index(wlr_seat, client);
+		wl_list_insert(&wlr_seat->client_table[index],
+			&seat_client->table_link);
 	}
 
 	wl_resource_set_implementation(wl_resource, &seat_impl,
@@ -182,10 +225,19 @@ void wlr_seat_destroy(struct wlr_seat *seat) {
 		}
 	}
 
+	if (seat->pointer_state.motion_timer != NULL) {
+		wl_event_source_remove(seat->pointer_state.motion_timer);
+	}
+	wl_list_remove(&seat->pointer_state.surface_frame_done.link);
+	if (seat->touch_state.frame_idle != NULL) {
+		wl_event_source_remove(seat->touch_state.frame_idle);
+	}
+
 	wl_global_destroy(seat->global);
 	free(seat->pointer_state.default_grab);
 	free(seat->keyboard_state.default_grab);
 	free(seat->touch_state.default_grab);
+	free(seat->client_table);
 	free(seat->name);
 	free(seat);
 }
@@ -205,6 +257,7 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 	// pointer state
 	seat->pointer_state.seat = seat;
 	wl_list_init(&seat->pointer_state.surface_destroy.link);
+	wl_list_init(&seat->pointer_state.surface_frame_done.link);
 
 	struct wlr_seat_pointer_grab *pointer_grab =
 		calloc(1, sizeof(struct wlr_seat_pointer_grab));
@@ -254,9 +307,24 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 	seat->touch_state.seat = seat;
 	wl_list_init(&seat->touch_state.touch_points);
 
+	seat->client_table_size = SEAT_CLIENT_TABLE_INITIAL_SIZE;
+	seat->client_table =
+		calloc(seat->client_table_size, sizeof(struct wl_list));
+	if (seat->client_table == NULL) {
+		free(touch_grab);
+		free(pointer_grab);
+		free(keyboard_grab);
+		free(seat);
+		return NULL;
+	}
+	for (size_t i = 0; i < seat->client_table_size; ++i) {
+		wl_list_init(&seat->client_table[i]);
+	}
+
 	seat->global = wl_global_create(display, &wl_seat_interface,
 		SEAT_VERSION, seat, seat_handle_bind);
 	if (seat->global == NULL) {
+		free(seat->client_table);
 		free(touch_grab);
 		free(pointer_grab);
 		free(keyboard_grab);
@@ -288,6 +356,8 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 	wl_signal_init(&seat->events.touch_grab_begin);
 	wl_signal_init(&seat->events.touch_grab_end);
 
+	wl_signal_init(&seat->events.input_dispatch);
+
 	wl_signal_init(&seat->events.destroy);
 
 	seat->display_destroy.notify = handle_display_destroy;
@@ -298,8 +368,9 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 
 struct wlr_seat_client *wlr_seat_client_for_wl_client(struct wlr_seat *wlr_seat,
 		struct wl_client *wl_client) {
+	size_t index = seat_client_table_index(wlr_seat, wl_client);
 	struct wlr_seat_client *seat_client;
-	wl_list_for_each(seat_client, &wlr_seat->clients, link) {
+	wl_list_for_each(seat_client, &wlr_seat->client_table[index], table_link) {
 		if (seat_client->client == wl_client) {
 			return seat_client;
 		}
@@ -307,6 +378,19 @@ struct wlr_seat_client *wlr_seat_client_for_wl_client(struct wlr_seat *wlr_seat,
 	return NULL;
 }
 
+void seat_emit_input_dispatch(struct wlr_seat *seat,
+		struct wlr_surface *surface, uint32_t time_msec) {
+	if (surface == NULL) {
+		return;
+	}
+	struct wlr_seat_input_dispatch_event event = {
+		.seat = seat,
+		.surface = surface,
+		.time_msec = time_msec,
+	};
+	wlr_signal_emit_safe(&seat->events.input_dispatch, &event);
+}
+
 void wlr_seat_set_capabilities(struct wlr_seat *wlr_seat,
 		uint32_t capabilities) {
 	wlr_seat->capabilities = capabilities;
@@ -81,6 +81,9 @@ void wlr_seat_keyboard_send_key(struct wlr_seat *wlr_seat, uint32_t time,
 
 		wl_keyboard_send_key(resource, serial, time, key, state);
 	}
+
+	seat_emit_input_dispatch(wlr_seat,
+		wlr_seat->keyboard_state.focused_surface, time);
 }
 
 static void seat_client_send_keymap(struct wlr_seat_client *client,
@@ -336,7 +339,7 @@ void wlr_seat_keyboard_notify_key(struct wlr_seat *seat, uint32_t time,
 
 static void seat_client_send_keymap(struct wlr_seat_client *client,
 		struct wlr_keyboard *keyboard) {
-	if (!keyboard) {
+	if (!keyboard || client->active_keyboards == 0) {
 		return;
 	}
 
@@ -404,6 +407,7 @@ void seat_client_create_keyboard(struct wlr_seat_client *seat_client,
 	wl_resource_set_implementation(resource, &keyboard_impl, seat_client,
 		keyboard_handle_resource_destroy);
 	wl_list_insert(&seat_client->keyboards, wl_resource_get_link(resource));
+	seat_client->active_keyboards++;
 
 	struct wlr_keyboard *keyboard = seat_client->seat->keyboard_state.keyboard;
 	seat_client_send_keymap(seat_client, keyboard);
@@ -420,4 +424,5 @@ void seat_client_destroy_keyboard(struct wl_resource *resource) {
 		return;
 	}
 	wl_resource_set_user_data(resource, NULL);
+	seat_client->active_keyboards--;
 }
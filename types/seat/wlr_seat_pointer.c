@@ -9,6 +9,9 @@
 #include "types/wlr_seat.h"
 #include "util/signal.h"
 
+// Minimum delay between two coalesced motion events, in milliseconds
+#define MOTION_COALESCING_INTERVAL_MS 16
+
 static void default_pointer_enter(struct wlr_seat_pointer_grab *grab,
 		struct wlr_surface *surface, double sx, double sy) {
 	wlr_seat_pointer_enter(grab->seat, surface, sx, sy);
@@ -128,6 +131,65 @@ static void seat_pointer_handle_surface_destroy(struct wl_listener *listener,
 	wlr_seat_pointer_clear_focus(state->seat);
 }
 
+static void pointer_send_motion(struct wlr_seat_client *client, uint32_t time,
+		double sx, double sy) {
+	struct wl_resource *resource;
+	wl_resource_for_each(resource, &client->pointers) {
+		if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
+			continue;
+		}
+
+		wl_pointer_send_motion(resource, time, wl_fixed_from_double(sx),
+			wl_fixed_from_double(sy));
+	}
+
+	seat_emit_input_dispatch(client->seat,
+		client->seat->pointer_state.focused_surface, time);
+}
+
+// Sends pending coalesced motion, followed by a frame if `frame` is true
+static void seat_pointer_flush_motion(struct wlr_seat *wlr_seat, bool frame) {
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	if (!state->motion_pending) {
+		return;
+	}
+	state->motion_pending = false;
+
+	struct wlr_seat_client *client = state->focused_client;
+	if (client == NULL) {
+		return;
+	}
+
+	pointer_send_motion(client, state->motion_time_msec, state->sx, state->sy);
+	state->frame_needed = true;
+	if (frame) {
+		wlr_seat_pointer_send_frame(wlr_seat);
+	}
+
+	// Start a new coalescing period
+	wl_event_source_timer_update(state->motion_timer,
+		MOTION_COALESCING_INTERVAL_MS);
+	state->motion_throttled = true;
+}
+
+static int handle_motion_timer(void *data) {
+	struct wlr_seat *wlr_seat = data;
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	if (state->motion_pending) {
+		seat_pointer_flush_motion(wlr_seat, true);
+	} else {
+		state->motion_throttled = false;
+	}
+	return 0;
+}
+
+static void seat_pointer_handle_surface_frame_done(
+		struct wl_listener *listener, void *data) {
+	struct wlr_seat_pointer_state *state =
+		wl_container_of(listener, state, surface_frame_done);
+	seat_pointer_flush_motion(state->seat, true);
+}
+
 void wlr_seat_pointer_enter(struct wlr_seat *wlr_seat,
 		struct wlr_surface *surface, double sx, double sy) {
 	if (wlr_seat->pointer_state.focused_surface == surface) {
@@ -135,6 +197,9 @@ void wlr_seat_pointer_enter(struct wlr_seat *wlr_seat,
 		return;
 	}
 
+	// motion for the previously entered surface must come before the leave
+	seat_pointer_flush_motion(wlr_seat, false);
+
 	struct wlr_seat_client *client = NULL;
 	if (surface) {
 		struct wl_client *wl_client = wl_resource_get_client(surface->resource);
@@ -178,15 +243,22 @@ void wlr_seat_pointer_enter(struct wlr_seat *wlr_seat,
 	// reinitialize the focus destroy events
 	wl_list_remove(&wlr_seat->pointer_state.surface_destroy.link);
 	wl_list_init(&wlr_seat->pointer_state.surface_destroy.link);
+	wl_list_remove(&wlr_seat->pointer_state.surface_frame_done.link);
+	wl_list_init(&wlr_seat->pointer_state.surface_frame_done.link);
 	if (surface != NULL) {
 		wl_signal_add(&surface->events.destroy,
 			&wlr_seat->pointer_state.surface_destroy);
 		wlr_seat->pointer_state.surface_destroy.notify =
 			seat_pointer_handle_surface_destroy;
+		wl_signal_add(&surface->events.frame_done,
+			&wlr_seat->pointer_state.surface_frame_done);
+		wlr_seat->pointer_state.surface_frame_done.notify =
+			seat_pointer_handle_surface_frame_done;
 	}
 
 	wlr_seat->pointer_state.focused_client = client;
 	wlr_seat->pointer_state.focused_surface = surface;
+	wlr_seat->pointer_state.frame_needed = false;
 	if (surface != NULL) {
 		wlr_seat->pointer_state.sx = sx;
 		wlr_seat->pointer_state.sy = sy;
@@ -211,27 +283,61 @@ void wlr_seat_pointer_clear_focus(struct wlr_seat *wlr_seat) {
 
 void wlr_seat_pointer_send_motion(struct wlr_seat *wlr_seat, uint32_t time,
 		double sx, double sy) {
-	struct wlr_seat_client *client = wlr_seat->pointer_state.focused_client;
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	struct wlr_seat_client *client = state->focused_client;
 	if (client == NULL) {
 		return;
 	}
 
-	if (wlr_seat->pointer_state.sx == sx && wlr_seat->pointer_state.sy == sy) {
+	if (state->sx == sx && state->sy == sy) {
 		return;
 	}
 
-	struct wl_resource *resource;
-	wl_resource_for_each(resource, &client->pointers) {
-		if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
-			continue;
-		}
+	state->sx = sx;
+	state->sy = sy;
 
-		wl_pointer_send_motion(resource, time, wl_fixed_from_double(sx),
-			wl_fixed_from_double(sy));
+	if (state->coalesce_motion && state->motion_throttled) {
+		// Merged with the following events, sent at the next client frame
+		state->motion_pending = true;
+		state->motion_time_msec = time;
+		return;
+	}
+
+	pointer_send_motion(client, time, sx, sy);
+	state->frame_needed = true;
+
+	if (state->coalesce_motion) {
+		wl_event_source_timer_update(state->motion_timer,
+			MOTION_COALESCING_INTERVAL_MS);
+		state->motion_throttled = true;
+	}
+}
+
+void wlr_seat_pointer_set_motion_coalescing(struct wlr_seat *wlr_seat,
+		bool enabled) {
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	if (state->coalesce_motion == enabled) {
+		return;
+	}
+
+	if (enabled) {
+		if (state->motion_timer == NULL) {
+			struct wl_event_loop *loop =
+				wl_display_get_event_loop(wlr_seat->display);
+			state->motion_timer =
+				wl_event_loop_add_timer(loop, handle_motion_timer, wlr_seat);
+			if (state->motion_timer == NULL) {
+				wlr_log(WLR_ERROR, "Failed to create motion timer");
+				return;
+			}
+		}
+	} else {
+		seat_pointer_flush_motion(wlr_seat, true);
+		wl_event_source_timer_update(state->motion_timer, 0);
+		state->motion_throttled = false;
 	}
 
-	wlr_seat->pointer_state.sx = sx;
-	wlr_seat->pointer_state.sy = sy;
+	state->coalesce_motion = enabled;
 }
 
 uint32_t wlr_seat_pointer_send_button(struct wlr_seat *wlr_seat, uint32_t time,
@@ -241,6 +347,9 @@ uint32_t wlr_seat_pointer_send_button(struct wlr_seat *wlr_seat, uint32_t time,
 		return 0;
 	}
 
+	seat_pointer_flush_motion(wlr_seat, false);
+	wlr_seat->pointer_state.frame_needed = true;
+
 	uint32_t serial = wl_display_next_serial(wlr_seat->display);
 	struct wl_resource *resource;
 	wl_resource_for_each(resource, &client->pointers) {
@@ -250,6 +359,9 @@ uint32_t wlr_seat_pointer_send_button(struct wlr_seat *wlr_seat, uint32_t time,
 
 		wl_pointer_send_button(resource, serial, time, button, state);
 	}
+
+	seat_emit_input_dispatch(wlr_seat,
+		wlr_seat->pointer_state.focused_surface, time);
 	return serial;
 }
 
@@ -261,6 +373,9 @@ void wlr_seat_pointer_send_axis(struct wlr_seat *wlr_seat, uint32_t time,
 		return;
 	}
 
+	seat_pointer_flush_motion(wlr_seat, false);
+	wlr_seat->pointer_state.frame_needed = true;
+
 	struct wl_resource *resource;
 	wl_resource_for_each(resource, &client->pointers) {
 		if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
@@ -285,6 +400,9 @@ void wlr_seat_pointer_send_axis(struct wlr_seat *wlr_seat, uint32_t time,
 			wl_pointer_send_axis_stop(resource, time, orientation);
 		}
 	}
+
+	seat_emit_input_dispatch(wlr_seat,
+		wlr_seat->pointer_state.focused_surface, time);
 }
 
 void wlr_seat_pointer_send_frame(struct wlr_seat *wlr_seat) {
@@ -293,6 +411,13 @@ void wlr_seat_pointer_send_frame(struct wlr_seat *wlr_seat) {
 		return;
 	}
 
+	struct wlr_seat_pointer_state *state = &wlr_seat->pointer_state;
+	if (state->coalesce_motion && !state->frame_needed) {
+		// Only coalesced motion happened, which will send its own frame
+		return;
+	}
+	state->frame_needed = false;
+
 	struct wl_resource *resource;
 	wl_resource_for_each(resource, &client->pointers) {
 		if (wlr_seat_client_from_pointer_resource(resource) == NULL) {
@@ -397,6 +522,7 @@ void seat_client_create_pointer(struct wlr_seat_client *seat_client,
 	wl_resource_set_implementation(resource, &pointer_impl, seat_client,
 		&pointer_handle_resource_destroy);
 	wl_list_insert(&seat_client->pointers, wl_resource_get_link(resource));
+	seat_client->active_pointers++;
 }
 
 void seat_client_destroy_pointer(struct wl_resource *resource) {
@@ -406,6 +532,7 @@ void seat_client_destroy_pointer(struct wl_resource *resource) {
 		return;
 	}
 	wl_resource_set_user_data(resource, NULL);
+	seat_client->active_pointers--;
 }
 
 bool wlr_seat_validate_pointer_grab_serial(struct wlr_seat *seat,
@@ -37,12 +37,17 @@ static void default_touch_cancel(struct wlr_seat_touch_grab *grab) {
 	// cannot be cancelled
 }
 
+static void default_touch_frame(struct wlr_seat_touch_grab *grab) {
+	wlr_seat_touch_send_frame(grab->seat);
+}
+
 const struct wlr_touch_grab_interface default_touch_grab_impl = {
 	.down = default_touch_down,
 	.up = default_touch_up,
 	.motion = default_touch_motion,
 	.enter = default_touch_enter,
 	.cancel = default_touch_cancel,
+	.frame = default_touch_frame,
 };
 
 
@@ -119,7 +124,7 @@ static struct wlr_touch_point *touch_point_create(
 	struct wlr_seat_client *client =
 		wlr_seat_client_for_wl_client(seat, wl_client);
 
-	if (client == NULL || wl_list_empty(&client->touches)) {
+	if (client == NULL || client->active_touches == 0) {
 		// touch points are not valid without a connected client with touch
 		return NULL;
 	}
@@ -209,6 +214,15 @@ void wlr_seat_touch_notify_motion(struct wlr_seat *seat, uint32_t time,
 	grab->interface->motion(grab, time, point);
 }
 
+void wlr_seat_touch_notify_frame(struct wlr_seat *seat) {
+	struct wlr_seat_touch_grab *grab = seat->touch_state.grab;
+	if (grab->interface->frame) {
+		grab->interface->frame(grab);
+	} else {
+		wlr_seat_touch_send_frame(seat);
+	}
+}
+
 static void handle_point_focus_destroy(struct wl_listener *listener,
 		void *data) {
 	struct wlr_touch_point *point =
@@ -229,7 +243,7 @@ static void touch_point_set_focus(struct wlr_touch_point *point,
 			wlr_seat_client_for_wl_client(point->client->seat,
 				wl_resource_get_client(surface->resource));
 
-		if (client && !wl_list_empty(&client->touches)) {
+		if (client && client->active_touches > 0) {
 			wl_signal_add(&surface->events.destroy, &point->focus_surface_destroy);
 			point->focus_surface_destroy.notify = handle_point_focus_destroy;
 			point->focus_surface = surface;
@@ -269,6 +283,23 @@ void wlr_seat_touch_point_clear_focus(struct wlr_seat *seat, uint32_t time,
 	touch_point_clear_focus(point);
 }
 
+static void handle_frame_idle(void *data) {
+	struct wlr_seat *seat = data;
+	seat->touch_state.frame_idle = NULL;
+	wlr_seat_touch_send_frame(seat);
+}
+
+static void seat_client_mark_touch_frame(struct wlr_seat_client *client) {
+	client->needs_touch_frame = true;
+
+	struct wlr_seat *seat = client->seat;
+	if (seat->touch_state.frame_idle == NULL) {
+		struct wl_event_loop *loop = wl_display_get_event_loop(seat->display);
+		seat->touch_state.frame_idle =
+			wl_event_loop_add_idle(loop, handle_frame_idle, seat);
+	}
+}
+
 uint32_t wlr_seat_touch_send_down(struct wlr_seat *seat,
 		struct wlr_surface *surface, uint32_t time, int32_t touch_id, double sx,
 		double sy) {
@@ -286,8 +317,9 @@ uint32_t wlr_seat_touch_send_down(struct wlr_seat *seat,
 		}
 		wl_touch_send_down(resource, serial, time, surface->resource,
 			touch_id, wl_fixed_from_double(sx), wl_fixed_from_double(sy));
-		wl_touch_send_frame(resource);
 	}
+	seat_client_mark_touch_frame(point->client);
+	seat_emit_input_dispatch(seat, surface, time);
 
 	return serial;
 }
@@ -306,8 +338,9 @@ void wlr_seat_touch_send_up(struct wlr_seat *seat, uint32_t time, int32_t touch_
 			continue;
 		}
 		wl_touch_send_up(resource, serial, time, touch_id);
-		wl_touch_send_frame(resource);
 	}
+	seat_client_mark_touch_frame(point->client);
+	seat_emit_input_dispatch(seat, point->surface, time);
 }
 
 void wlr_seat_touch_send_motion(struct wlr_seat *seat, uint32_t time, int32_t touch_id,
@@ -325,7 +358,31 @@ void wlr_seat_touch_send_motion(struct wlr_seat *seat, uint32_t time, int32_t to
 		}
 		wl_touch_send_motion(resource, time, touch_id, wl_fixed_from_double(sx),
 			wl_fixed_from_double(sy));
-		wl_touch_send_frame(resource);
+	}
+	seat_client_mark_touch_frame(point->client);
+	seat_emit_input_dispatch(seat, point->surface, time);
+}
+
+void wlr_seat_touch_send_frame(struct wlr_seat *seat) {
+	if (seat->touch_state.frame_idle != NULL) {
+		wl_event_source_remove(seat->touch_state.frame_idle);
+		seat->touch_state.frame_idle = NULL;
+	}
+
+	struct wlr_seat_client *client;
+	wl_list_for_each(client, &seat->clients, link) {
+		if (!client->needs_touch_frame) {
+			continue;
+		}
+		client->needs_touch_frame = false;
+
+		struct wl_resource *resource;
+		wl_resource_for_each(resource, &client->touches) {
+			if (seat_client_from_touch_resource(resource) == NULL) {
+				continue;
+			}
+			wl_touch_send_frame(resource);
+		}
 	}
 }
 
@@ -349,6 +406,7 @@ void seat_client_create_touch(struct wlr_seat_client *seat_client,
 	wl_resource_set_implementation(resource, &touch_impl, seat_client,
 		&touch_handle_resource_destroy);
 	wl_list_insert(&seat_client->touches, wl_resource_get_link(resource));
+	seat_client->active_touches++;
 }
 
 void seat_client_destroy_touch(struct wl_resource *resource) {
@@ -358,6 +416,7 @@ void seat_client_destroy_touch(struct wl_resource *resource) {
 		return;
 	}
 	wl_resource_set_user_data(resource, NULL);
+	seat_client->active_touches--;
 }
 
 bool wlr_seat_validate_touch_grab_serial(struct wlr_seat *seat,
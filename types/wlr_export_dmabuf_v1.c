@@ -1,8 +1,10 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <wlr/backend.h>
 #include <wlr/interfaces/wlr_output.h>
 #include <wlr/render/dmabuf.h>
+#include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_export_dmabuf_v1.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/log.h>
@@ -39,6 +41,12 @@ static void frame_destroy(struct wlr_export_dmabuf_frame_v1 *frame) {
 	}
 	wl_list_remove(&frame->link);
 	wl_list_remove(&frame->output_swap_buffers.link);
+	if (frame->fence_source != NULL) {
+		wl_event_source_remove(frame->fence_source);
+	}
+	if (frame->fence_fd >= 0) {
+		close(frame->fence_fd);
+	}
 	wlr_dmabuf_attributes_finish(&frame->attribs);
 	// Make the frame resource inert
 	wl_resource_set_user_data(frame->resource, NULL);
@@ -50,6 +58,22 @@ static void frame_handle_resource_destroy(struct wl_resource *resource) {
 	frame_destroy(frame);
 }
 
+static void frame_send_ready(struct wlr_export_dmabuf_frame_v1 *frame) {
+	time_t tv_sec = frame->ready_time.tv_sec;
+	uint32_t tv_sec_hi = (sizeof(tv_sec) > 4) ? tv_sec >> 32 : 0;
+	uint32_t tv_sec_lo = tv_sec & 0xFFFFFFFF;
+	zwlr_export_dmabuf_frame_v1_send_ready(frame->resource,
+		tv_sec_hi, tv_sec_lo, frame->ready_time.tv_nsec);
+	frame_destroy(frame);
+}
+
+static int frame_handle_fence(int fd, uint32_t mask, void *data) {
+	struct wlr_export_dmabuf_frame_v1 *frame = data;
+	// Sync files become readable once they're signalled
+	frame_send_ready(frame);
+	return 0;
+}
+
 static void frame_output_handle_swap_buffers(struct wl_listener *listener,
 		void *data) {
 	struct wlr_export_dmabuf_frame_v1 *frame =
@@ -59,12 +83,22 @@ static void frame_output_handle_swap_buffers(struct wl_listener *listener,
 	wl_list_remove(&frame->output_swap_buffers.link);
 	wl_list_init(&frame->output_swap_buffers.link);
 
-	time_t tv_sec = event->when->tv_sec;
-	uint32_t tv_sec_hi = (sizeof(tv_sec) > 4) ? tv_sec >> 32 : 0;
-	uint32_t tv_sec_lo = tv_sec & 0xFFFFFFFF;
-	zwlr_export_dmabuf_frame_v1_send_ready(frame->resource,
-		tv_sec_hi, tv_sec_lo, event->when->tv_nsec);
-	frame_destroy(frame);
+	frame->ready_time = *event->when;
+
+	if (frame->fence_fd >= 0) {
+		// Only tell the client that the frame is ready once the GPU is done
+		// rendering it, without blocking the compositor
+		struct wl_event_loop *loop =
+			wl_display_get_event_loop(frame->output->display);
+		frame->fence_source = wl_event_loop_add_fd(loop, frame->fence_fd,
+			WL_EVENT_READABLE, frame_handle_fence, frame);
+		if (frame->fence_source != NULL) {
+			return;
+		}
+		wlr_log(WLR_ERROR, "Failed to wait for export-dmabuf frame fence");
+	}
+
+	frame_send_ready(frame);
 }
 
 
@@ -92,6 +126,7 @@ static void manager_handle_capture_output(struct wl_client *client,
 	}
 	frame->manager = manager;
 	frame->output = output;
+	frame->fence_fd = -1;
 	wl_list_init(&frame->output_swap_buffers.link);
 
 	uint32_t version = wl_resource_get_version(manager_resource);
@@ -127,6 +162,12 @@ static void manager_handle_capture_output(struct wl_client *client,
 		frame->cursor_locked = true;
 	}
 
+	// The exported buffer might still be being rendered to
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	if (renderer != NULL) {
+		frame->fence_fd = wlr_renderer_create_fence(renderer);
+	}
+
 	uint32_t frame_flags = ZWLR_EXPORT_DMABUF_FRAME_V1_FLAGS_TRANSIENT;
 	uint32_t mod_high = attribs->modifier >> 32;
 	uint32_t mod_low = attribs->modifier & 0xFFFFFFFF;
@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 199309L
+#include <inttypes.h>
+#include <pixman.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_input_latency.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+#include "util/signal.h"
+
+// Events sent to a surface which doesn't commit are discarded past this limit
+#define MAX_PENDING_EVENTS 256
+// Committed events not picked up by an output are discarded past this limit
+#define MAX_COMMITTED_EVENTS 1024
+// Input timestamps further in the past are assumed to use another clock
+#define MAX_INPUT_DELAY_MS 10000
+
+struct wlr_input_latency_event {
+	struct wlr_input_latency_record record;
+	struct wl_list link;
+};
+
+struct wlr_input_latency_surface {
+	struct wlr_input_latency *latency;
+	struct wlr_surface *surface;
+	struct wl_list pending; // wlr_input_latency_event::link
+	size_t pending_len;
+	struct wl_list link; // wlr_input_latency::surfaces
+
+	struct wl_listener surface_commit;
+	struct wl_listener surface_destroy;
+};
+
+struct wlr_input_latency_output {
+	struct wlr_input_latency *latency;
+	struct wlr_output *output;
+	struct wl_list in_flight; // wlr_input_latency_event::link
+	struct wl_list link; // wlr_input_latency::outputs
+
+	struct wl_listener output_commit;
+	struct wl_listener output_present;
+	struct wl_listener output_destroy;
+};
+
+static const char *stage_names[] = {
+	[WLR_INPUT_LATENCY_DISPATCH] = "dispatch",
+	[WLR_INPUT_LATENCY_CLIENT] = "client",
+	[WLR_INPUT_LATENCY_RENDER] = "render",
+	[WLR_INPUT_LATENCY_PRESENT] = "present",
+	[WLR_INPUT_LATENCY_TOTAL] = "total",
+};
+
+static int64_t timespec_to_nsec(const struct timespec *t) {
+	return (int64_t)t->tv_sec * 1000000000 + t->tv_nsec;
+}
+
+static void get_time(struct timespec *t) {
+	clock_gettime(CLOCK_MONOTONIC, t);
+}
+
+static void latency_drop_events(struct wlr_input_latency *latency,
+		struct wl_list *events) {
+	struct wlr_input_latency_event *event, *tmp;
+	wl_list_for_each_safe(event, tmp, events, link) {
+		wl_list_remove(&event->link);
+		free(event);
+		latency->dropped++;
+	}
+}
+
+static void histogram_add(struct wlr_input_latency_histogram *histogram,
+		const struct timespec *start, const struct timespec *end) {
+	int64_t nsec = timespec_to_nsec(end) - timespec_to_nsec(start);
+	uint64_t usec = nsec > 0 ? (uint64_t)nsec / 1000 : 0;
+
+	size_t bucket = 0;
+	while (bucket < WLR_INPUT_LATENCY_HISTOGRAM_BUCKETS - 1 &&
+			(usec >> (bucket + 1)) != 0) {
+		bucket++;
+	}
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->sum_usec += usec;
+	if (usec > histogram->max_usec) {
+		histogram->max_usec = usec;
+	}
+}
+
+static void trace_write_stage(struct wlr_input_latency *latency,
+		const struct wlr_input_latency_record *record,
+		enum wlr_input_latency_stage stage, const struct timespec *start,
+		const struct timespec *end) {
+	int64_t start_nsec = timespec_to_nsec(start);
+	int64_t duration_nsec = timespec_to_nsec(end) - start_nsec;
+	if (duration_nsec < 0) {
+		duration_nsec = 0;
+	}
+	fprintf(latency->trace, "{\"name\":\"%s\",\"cat\":\"input\",\"ph\":\"X\","
+		"\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+		"\"args\":{\"id\":%" PRIu64 "}},\n", stage_names[stage], (int)stage,
+		start_nsec / 1000.0, duration_nsec / 1000.0, record->id);
+}
+
+static void latency_add_record(struct wlr_input_latency *latency,
+		struct wlr_input_latency_record *record) {
+	struct {
+		enum wlr_input_latency_stage stage;
+		const struct timespec *start, *end;
+	} stages[] = {
+		{ WLR_INPUT_LATENCY_DISPATCH, &record->input, &record->dispatch },
+		{ WLR_INPUT_LATENCY_CLIENT, &record->dispatch, &record->commit },
+		{ WLR_INPUT_LATENCY_RENDER, &record->commit, &record->render },
+		{ WLR_INPUT_LATENCY_PRESENT, &record->render, &record->present },
+		{ WLR_INPUT_LATENCY_TOTAL, &record->input, &record->present },
+	};
+	for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); ++i) {
+		if (stages[i].start == &record->input && !record->has_input_time) {
+			continue;
+		}
+		histogram_add(&latency->histograms[stages[i].stage],
+			stages[i].start, stages[i].end);
+		if (latency->trace != NULL &&
+				stages[i].stage != WLR_INPUT_LATENCY_TOTAL) {
+			trace_write_stage(latency, record, stages[i].stage,
+				stages[i].start, stages[i].end);
+		}
+	}
+
+	wlr_signal_emit_safe(&latency->events.record, record);
+}
+
+static void latency_surface_destroy(struct wlr_input_latency_surface *ls) {
+	latency_drop_events(ls->latency, &ls->pending);
+	wl_list_remove(&ls->surface_commit.link);
+	wl_list_remove(&ls->surface_destroy.link);
+	wl_list_remove(&ls->link);
+	free(ls);
+}
+
+static void surface_handle_commit(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_surface *ls =
+		wl_container_of(listener, ls, surface_commit);
+	if (ls->pending_len == 0 ||
+			!pixman_region32_not_empty(&ls->surface->buffer_damage)) {
+		return;
+	}
+
+	struct wlr_input_latency *latency = ls->latency;
+	// Events are only completed by outputs
+	if (wl_list_empty(&latency->outputs)) {
+		latency_drop_events(latency, &ls->pending);
+		ls->pending_len = 0;
+		return;
+	}
+
+	struct timespec now;
+	get_time(&now);
+
+	struct wlr_input_latency_event *event, *tmp;
+	wl_list_for_each_safe(event, tmp, &ls->pending, link) {
+		if (latency->committed_len == MAX_COMMITTED_EVENTS) {
+			struct wlr_input_latency_event *oldest =
+				wl_container_of(latency->committed.next, oldest, link);
+			wl_list_remove(&oldest->link);
+			free(oldest);
+			latency->committed_len--;
+			latency->dropped++;
+		}
+
+		event->record.commit = now;
+		wl_list_remove(&event->link);
+		wl_list_insert(latency->committed.prev, &event->link);
+		latency->committed_len++;
+	}
+	ls->pending_len = 0;
+}
+
+static void surface_handle_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_surface *ls =
+		wl_container_of(listener, ls, surface_destroy);
+	latency_surface_destroy(ls);
+}
+
+static struct wlr_input_latency_surface *latency_get_surface(
+		struct wlr_input_latency *latency, struct wlr_surface *surface) {
+	struct wlr_input_latency_surface *ls;
+	wl_list_for_each(ls, &latency->surfaces, link) {
+		if (ls->surface == surface) {
+			return ls;
+		}
+	}
+
+	ls = calloc(1, sizeof(struct wlr_input_latency_surface));
+	if (ls == NULL) {
+		return NULL;
+	}
+	ls->latency = latency;
+	ls->surface = surface;
+	wl_list_init(&ls->pending);
+
+	ls->surface_commit.notify = surface_handle_commit;
+	wl_signal_add(&surface->events.commit, &ls->surface_commit);
+	ls->surface_destroy.notify = surface_handle_destroy;
+	wl_signal_add(&surface->events.destroy, &ls->surface_destroy);
+
+	wl_list_insert(&latency->surfaces, &ls->link);
+	return ls;
+}
+
+static void seat_handle_input_dispatch(struct wl_listener *listener,
+		void *data) {
+	struct wlr_input_latency *latency =
+		wl_container_of(listener, latency, seat_input_dispatch);
+	struct wlr_seat_input_dispatch_event *dispatch = data;
+
+	struct wlr_input_latency_surface *ls =
+		latency_get_surface(latency, dispatch->surface);
+	if (ls == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+
+	if (ls->pending_len == MAX_PENDING_EVENTS) {
+		struct wlr_input_latency_event *oldest =
+			wl_container_of(ls->pending.next, oldest, link);
+		wl_list_remove(&oldest->link);
+		free(oldest);
+		ls->pending_len--;
+		latency->dropped++;
+	}
+
+	struct wlr_input_latency_event *event =
+		calloc(1, sizeof(struct wlr_input_latency_event));
+	if (event == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+	event->record.id = latency->next_id++;
+	get_time(&event->record.dispatch);
+
+	// Input timestamps are truncated to 32-bit milliseconds
+	int64_t now_msec = timespec_to_nsec(&event->record.dispatch) / 1000000;
+	uint32_t delay_msec = (uint32_t)now_msec - dispatch->time_msec;
+	if (delay_msec <= MAX_INPUT_DELAY_MS) {
+		int64_t input_msec = now_msec - delay_msec;
+		event->record.input.tv_sec = input_msec / 1000;
+		event->record.input.tv_nsec = (input_msec % 1000) * 1000000;
+		event->record.has_input_time = true;
+	}
+
+	wl_list_insert(ls->pending.prev, &event->link);
+	ls->pending_len++;
+}
+
+static void latency_output_destroy(struct wlr_input_latency_output *lo) {
+	struct wlr_input_latency *latency = lo->latency;
+	latency_drop_events(latency, &lo->in_flight);
+	wl_list_remove(&lo->output_commit.link);
+	wl_list_remove(&lo->output_present.link);
+	wl_list_remove(&lo->output_destroy.link);
+	wl_list_remove(&lo->link);
+	free(lo);
+
+	// No output is left to complete the committed events
+	if (wl_list_empty(&latency->outputs)) {
+		latency_drop_events(latency, &latency->committed);
+		latency->committed_len = 0;
+	}
+}
+
+static void output_handle_commit(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_output *lo =
+		wl_container_of(listener, lo, output_commit);
+	struct wlr_input_latency *latency = lo->latency;
+	if (wl_list_empty(&latency->committed)) {
+		return;
+	}
+
+	struct timespec now;
+	get_time(&now);
+
+	struct wlr_input_latency_event *event, *tmp;
+	wl_list_for_each_safe(event, tmp, &latency->committed, link) {
+		event->record.render = now;
+		wl_list_remove(&event->link);
+		wl_list_insert(lo->in_flight.prev, &event->link);
+	}
+	latency->committed_len = 0;
+}
+
+static void output_handle_present(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_output *lo =
+		wl_container_of(listener, lo, output_present);
+	struct wlr_output_event_present *present = data;
+	int64_t present_nsec = timespec_to_nsec(present->when);
+
+	struct wlr_input_latency_event *event, *tmp;
+	wl_list_for_each_safe(event, tmp, &lo->in_flight, link) {
+		// Events submitted after this frame wait for the next one
+		if (timespec_to_nsec(&event->record.render) > present_nsec) {
+			break;
+		}
+		event->record.present = *present->when;
+		wl_list_remove(&event->link);
+		latency_add_record(lo->latency, &event->record);
+		free(event);
+	}
+}
+
+static void output_handle_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency_output *lo =
+		wl_container_of(listener, lo, output_destroy);
+	latency_output_destroy(lo);
+}
+
+bool wlr_input_latency_add_output(struct wlr_input_latency *latency,
+		struct wlr_output *output) {
+	struct wlr_input_latency_output *lo;
+	wl_list_for_each(lo, &latency->outputs, link) {
+		if (lo->output == output) {
+			return true;
+		}
+	}
+
+	lo = calloc(1, sizeof(struct wlr_input_latency_output));
+	if (lo == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	lo->latency = latency;
+	lo->output = output;
+	wl_list_init(&lo->in_flight);
+
+	lo->output_commit.notify = output_handle_commit;
+	wl_signal_add(&output->events.commit, &lo->output_commit);
+	lo->output_present.notify = output_handle_present;
+	wl_signal_add(&output->events.present, &lo->output_present);
+	lo->output_destroy.notify = output_handle_destroy;
+	wl_signal_add(&output->events.destroy, &lo->output_destroy);
+
+	wl_list_insert(&latency->outputs, &lo->link);
+	return true;
+}
+
+static void seat_handle_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_latency *latency =
+		wl_container_of(listener, latency, seat_destroy);
+	wlr_input_latency_destroy(latency);
+}
+
+struct wlr_input_latency *wlr_input_latency_create(struct wlr_seat *seat) {
+	struct wlr_input_latency *latency =
+		calloc(1, sizeof(struct wlr_input_latency));
+	if (latency == NULL) {
+		return NULL;
+	}
+	latency->seat = seat;
+	wl_list_init(&latency->surfaces);
+	wl_list_init(&latency->outputs);
+	wl_list_init(&latency->committed);
+	wl_signal_init(&latency->events.record);
+	wl_signal_init(&latency->events.destroy);
+
+	latency->seat_input_dispatch.notify = seat_handle_input_dispatch;
+	wl_signal_add(&seat->events.input_dispatch, &latency->seat_input_dispatch);
+	latency->seat_destroy.notify = seat_handle_destroy;
+	wl_signal_add(&seat->events.destroy, &latency->seat_destroy);
+
+	return latency;
+}
+
+void wlr_input_latency_destroy(struct wlr_input_latency *latency) {
+	if (latency == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&latency->events.destroy, latency);
+
+	struct wlr_input_latency_surface *ls, *ls_tmp;
+	wl_list_for_each_safe(ls, ls_tmp, &latency->surfaces, link) {
+		latency_surface_destroy(ls);
+	}
+	struct wlr_input_latency_output *lo, *lo_tmp;
+	wl_list_for_each_safe(lo, lo_tmp, &latency->outputs, link) {
+		latency_output_destroy(lo);
+	}
+	latency_drop_events(latency, &latency->committed);
+
+	wl_list_remove(&latency->seat_input_dispatch.link);
+	wl_list_remove(&latency->seat_destroy.link);
+	free(latency);
+}
+
+void wlr_input_latency_set_trace_file(struct wlr_input_latency *latency,
+		FILE *trace) {
+	if (latency->trace != NULL) {
+		fflush(latency->trace);
+	}
+	latency->trace = trace;
+	if (trace != NULL) {
+		// The closing bracket is optional in the Trace Event Format
+		fprintf(trace, "[\n");
+	}
+}
+
+void wlr_input_latency_write_histograms(struct wlr_input_latency *latency,
+		FILE *f) {
+	fprintf(f, "Input latency (%" PRIu64 " events dropped)\n",
+		latency->dropped);
+	for (size_t i = 0; i < WLR_INPUT_LATENCY_STAGE_COUNT; ++i) {
+		const struct wlr_input_latency_histogram *histogram =
+			&latency->histograms[i];
+		fprintf(f, "%s: %" PRIu64 " events", stage_names[i], histogram->count);
+		if (histogram->count == 0) {
+			fprintf(f, "\n");
+			continue;
+		}
+		fprintf(f, ", mean %" PRIu64 " us, max %" PRIu64 " us\n",
+			histogram->sum_usec / histogram->count, histogram->max_usec);
+
+		for (size_t j = 0; j < WLR_INPUT_LATENCY_HISTOGRAM_BUCKETS; ++j) {
+			if (histogram->buckets[j] == 0) {
+				continue;
+			}
+			uint64_t low = j == 0 ? 0 : (uint64_t)1 << j;
+			if (j == WLR_INPUT_LATENCY_HISTOGRAM_BUCKETS - 1) {
+				fprintf(f, "  >= %" PRIu64 " us: %" PRIu64 "\n", low,
+					histogram->buckets[j]);
+			} else {
+				fprintf(f, "  [%" PRIu64 ", %" PRIu64 ") us: %" PRIu64 "\n",
+					low, (uint64_t)1 << (j + 1), histogram->buckets[j]);
+			}
+		}
+	}
+}
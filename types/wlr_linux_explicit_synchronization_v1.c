@@ -0,0 +1,404 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
+#include <wlr/types/wlr_linux_explicit_synchronization_v1.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/log.h>
+#include "linux-explicit-synchronization-unstable-v1-protocol.h"
+#include "util/signal.h"
+
+#define LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION 1
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+	explicit_sync_impl;
+static const struct zwp_linux_surface_synchronization_v1_interface
+	surface_sync_impl;
+
+static struct wlr_linux_explicit_synchronization_v1 *
+		explicit_sync_from_resource(struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource,
+		&zwp_linux_explicit_synchronization_v1_interface,
+		&explicit_sync_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+// Returns NULL if the surface synchronization is inert
+static struct wlr_linux_surface_synchronization_v1 *
+		surface_sync_from_resource(struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource,
+		&zwp_linux_surface_synchronization_v1_interface,
+		&surface_sync_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void buffer_release_handle_resource_destroy(
+		struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void buffer_release_send(struct wl_resource *resource, int fence_fd) {
+	if (fence_fd >= 0) {
+		zwp_linux_buffer_release_v1_send_fenced_release(resource, fence_fd);
+	} else {
+		zwp_linux_buffer_release_v1_send_immediate_release(resource);
+	}
+	wl_resource_destroy(resource);
+}
+
+static void release_all(struct wl_list *releases, int fence_fd) {
+	struct wl_resource *resource, *tmp;
+	wl_resource_for_each_safe(resource, tmp, releases) {
+		buffer_release_send(resource, fence_fd);
+	}
+}
+
+static void surface_sync_release_current(
+		struct wlr_linux_surface_synchronization_v1 *surface_sync) {
+	if (wl_list_empty(&surface_sync->current_releases)) {
+		return;
+	}
+
+	// Signalled once the GPU is done with all rendering operations which might
+	// read from the buffers
+	int fence_fd = wlr_renderer_create_fence(surface_sync->manager->renderer);
+	release_all(&surface_sync->current_releases, fence_fd);
+	if (fence_fd >= 0) {
+		close(fence_fd);
+	}
+}
+
+static void surface_sync_destroy(
+		struct wlr_linux_surface_synchronization_v1 *surface_sync) {
+	if (surface_sync == NULL) {
+		return;
+	}
+
+	surface_sync_release_current(surface_sync);
+	release_all(&surface_sync->committed_releases, -1);
+	if (surface_sync->pending_release != NULL) {
+		buffer_release_send(surface_sync->pending_release, -1);
+	}
+	if (surface_sync->pending_fence_fd >= 0) {
+		close(surface_sync->pending_fence_fd);
+	}
+
+	if (surface_sync->surface != NULL) {
+		wl_list_remove(&surface_sync->surface_destroy.link);
+		wl_list_remove(&surface_sync->surface_client_commit.link);
+		wl_list_remove(&surface_sync->surface_commit.link);
+	}
+	wl_list_remove(&surface_sync->link);
+	wl_resource_set_user_data(surface_sync->resource, NULL);
+	free(surface_sync);
+}
+
+static void surface_sync_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		wl_container_of(listener, surface_sync, surface_destroy);
+
+	surface_sync_release_current(surface_sync);
+	release_all(&surface_sync->committed_releases, -1);
+
+	// The resource stays alive until the client destroys it, requests made
+	// from now on are errors
+	wl_list_remove(&surface_sync->surface_destroy.link);
+	wl_list_remove(&surface_sync->surface_client_commit.link);
+	wl_list_remove(&surface_sync->surface_commit.link);
+	surface_sync->surface = NULL;
+}
+
+static void surface_sync_handle_surface_client_commit(
+		struct wl_listener *listener, void *data) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		wl_container_of(listener, surface_sync, surface_client_commit);
+	struct wlr_surface *surface = surface_sync->surface;
+
+	bool has_buffer = surface->pending.committed & WLR_SURFACE_STATE_BUFFER;
+	struct wl_resource *buffer = surface->pending.buffer_resource;
+
+	if (surface_sync->pending_fence_fd >= 0 ||
+			surface_sync->pending_release != NULL) {
+		if (!has_buffer || buffer == NULL) {
+			wl_resource_post_error(surface_sync->resource,
+				ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_BUFFER,
+				"Fence or release set without attaching a buffer");
+			return;
+		}
+		if (!wlr_dmabuf_v1_resource_is_buffer(buffer)) {
+			wl_resource_post_error(surface_sync->resource,
+				ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_UNSUPPORTED_BUFFER,
+				"Fences are only supported with linux-dmabuf buffers");
+			return;
+		}
+	}
+
+	if (surface_sync->pending_fence_fd >= 0) {
+		// The buffer is only read by the renderer, so there's no need to
+		// block until the fence is signalled
+		bool ok = wlr_renderer_wait_fence(surface_sync->manager->renderer,
+			surface_sync->pending_fence_fd);
+		close(surface_sync->pending_fence_fd);
+		surface_sync->pending_fence_fd = -1;
+		if (!ok) {
+			wl_resource_post_error(surface_sync->resource,
+				ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_INVALID_FENCE,
+				"Invalid acquire fence");
+			return;
+		}
+	}
+
+	if (has_buffer) {
+		// Buffers committed earlier but not applied yet (e.g. because the
+		// surface is a synchronized subsurface) will never be used
+		release_all(&surface_sync->committed_releases, -1);
+		surface_sync->committed_buffers++;
+	}
+
+	if (surface_sync->pending_release != NULL) {
+		wl_list_insert(surface_sync->committed_releases.prev,
+			wl_resource_get_link(surface_sync->pending_release));
+		surface_sync->pending_release = NULL;
+	}
+}
+
+static void surface_sync_handle_surface_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		wl_container_of(listener, surface_sync, surface_commit);
+
+	if (surface_sync->committed_buffers == 0) {
+		return;
+	}
+	surface_sync->committed_buffers = 0;
+
+	// The surface has switched to a new buffer
+	surface_sync_release_current(surface_sync);
+	wl_list_insert_list(&surface_sync->current_releases,
+		&surface_sync->committed_releases);
+	wl_list_init(&surface_sync->committed_releases);
+}
+
+static void surface_sync_handle_resource_destroy(struct wl_resource *resource) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		surface_sync_from_resource(resource);
+	surface_sync_destroy(surface_sync);
+}
+
+static void surface_sync_handle_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void surface_sync_handle_set_acquire_fence(struct wl_client *client,
+		struct wl_resource *resource, int32_t fd) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		surface_sync_from_resource(resource);
+	if (surface_sync == NULL || surface_sync->surface == NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+			"The surface has been destroyed");
+		close(fd);
+		return;
+	}
+
+	if (surface_sync->pending_fence_fd >= 0) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_FENCE,
+			"An acquire fence has already been set for this commit");
+		close(fd);
+		return;
+	}
+
+	surface_sync->pending_fence_fd = fd;
+}
+
+static void surface_sync_handle_get_release(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id) {
+	struct wlr_linux_surface_synchronization_v1 *surface_sync =
+		surface_sync_from_resource(resource);
+	if (surface_sync == NULL || surface_sync->surface == NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+			"The surface has been destroyed");
+		return;
+	}
+
+	if (surface_sync->pending_release != NULL) {
+		wl_resource_post_error(resource,
+			ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_RELEASE,
+			"A release has already been requested for this commit");
+		return;
+	}
+
+	struct wl_resource *release_resource = wl_resource_create(client,
+		&zwp_linux_buffer_release_v1_interface,
+		wl_resource_get_version(resource), id);
+	if (release_resource == NULL) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+	wl_resource_set_implementation(release_resource, NULL, NULL,
+		buffer_release_handle_resource_destroy);
+	wl_list_init(wl_resource_get_link(release_resource));
+
+	surface_sync->pending_release = release_resource;
+}
+
+static const struct zwp_linux_surface_synchronization_v1_interface
+		surface_sync_impl = {
+	.destroy = surface_sync_handle_destroy,
+	.set_acquire_fence = surface_sync_handle_set_acquire_fence,
+	.get_release = surface_sync_handle_get_release,
+};
+
+static void explicit_sync_handle_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void explicit_sync_handle_get_synchronization(struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource) {
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync =
+		explicit_sync_from_resource(resource);
+	struct wlr_surface *surface = wlr_surface_from_resource(surface_resource);
+
+	struct wlr_linux_surface_synchronization_v1 *surface_sync;
+	wl_list_for_each(surface_sync, &explicit_sync->surface_syncs, link) {
+		if (surface_sync->surface == surface) {
+			wl_resource_post_error(resource,
+				ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_ERROR_SYNCHRONIZATION_EXISTS,
+				"The surface already has a synchronization object");
+			return;
+		}
+	}
+
+	surface_sync = calloc(1, sizeof(struct wlr_linux_surface_synchronization_v1));
+	if (surface_sync == NULL) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	uint32_t version = wl_resource_get_version(resource);
+	surface_sync->resource = wl_resource_create(client,
+		&zwp_linux_surface_synchronization_v1_interface, version, id);
+	if (surface_sync->resource == NULL) {
+		wl_resource_post_no_memory(resource);
+		free(surface_sync);
+		return;
+	}
+	wl_resource_set_implementation(surface_sync->resource, &surface_sync_impl,
+		surface_sync, surface_sync_handle_resource_destroy);
+
+	surface_sync->manager = explicit_sync;
+	surface_sync->surface = surface;
+	surface_sync->pending_fence_fd = -1;
+	wl_list_init(&surface_sync->committed_releases);
+	wl_list_init(&surface_sync->current_releases);
+
+	surface_sync->surface_destroy.notify = surface_sync_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &surface_sync->surface_destroy);
+	surface_sync->surface_client_commit.notify =
+		surface_sync_handle_surface_client_commit;
+	wl_signal_add(&surface->events.client_commit,
+		&surface_sync->surface_client_commit);
+	surface_sync->surface_commit.notify = surface_sync_handle_surface_commit;
+	wl_signal_add(&surface->events.commit, &surface_sync->surface_commit);
+
+	wl_list_insert(&explicit_sync->surface_syncs, &surface_sync->link);
+}
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+		explicit_sync_impl = {
+	.destroy = explicit_sync_handle_destroy,
+	.get_synchronization = explicit_sync_handle_get_synchronization,
+};
+
+static void explicit_sync_handle_resource_destroy(
+		struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void explicit_sync_bind(struct wl_client *client, void *data,
+		uint32_t version, uint32_t id) {
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync = data;
+
+	struct wl_resource *resource = wl_resource_create(client,
+		&zwp_linux_explicit_synchronization_v1_interface, version, id);
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &explicit_sync_impl,
+		explicit_sync, explicit_sync_handle_resource_destroy);
+
+	wl_list_insert(&explicit_sync->resources, wl_resource_get_link(resource));
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync =
+		wl_container_of(listener, explicit_sync, display_destroy);
+	wlr_linux_explicit_synchronization_v1_destroy(explicit_sync);
+}
+
+struct wlr_linux_explicit_synchronization_v1 *
+		wlr_linux_explicit_synchronization_v1_create(struct wl_display *display,
+		struct wlr_renderer *renderer) {
+	// Acquire fences can only be honored if the renderer can wait for them
+	int fence_fd = wlr_renderer_create_fence(renderer);
+	if (fence_fd < 0) {
+		wlr_log(WLR_INFO, "Renderer doesn't support explicit synchronization");
+		return NULL;
+	}
+	close(fence_fd);
+
+	struct wlr_linux_explicit_synchronization_v1 *explicit_sync =
+		calloc(1, sizeof(struct wlr_linux_explicit_synchronization_v1));
+	if (explicit_sync == NULL) {
+		return NULL;
+	}
+	explicit_sync->renderer = renderer;
+	wl_list_init(&explicit_sync->resources);
+	wl_list_init(&explicit_sync->surface_syncs);
+	wl_signal_init(&explicit_sync->events.destroy);
+
+	explicit_sync->global = wl_global_create(display,
+		&zwp_linux_explicit_synchronization_v1_interface,
+		LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION, explicit_sync,
+		explicit_sync_bind);
+	if (explicit_sync->global == NULL) {
+		free(explicit_sync);
+		return NULL;
+	}
+
+	explicit_sync->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &explicit_sync->display_destroy);
+
+	return explicit_sync;
+}
+
+void wlr_linux_explicit_synchronization_v1_destroy(
+		struct wlr_linux_explicit_synchronization_v1 *explicit_sync) {
+	if (explicit_sync == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&explicit_sync->events.destroy, explicit_sync);
+	wl_list_remove(&explicit_sync->display_destroy.link);
+	wl_global_destroy(explicit_sync->global);
+
+	struct wlr_linux_surface_synchronization_v1 *surface_sync, *sync_tmp;
+	wl_list_for_each_safe(surface_sync, sync_tmp,
+			&explicit_sync->surface_syncs, link) {
+		surface_sync_destroy(surface_sync);
+	}
+
+	struct wl_resource *resource, *tmp;
+	wl_resource_for_each_safe(resource, tmp, &explicit_sync->resources) {
+		wl_resource_destroy(resource);
+	}
+
+	free(explicit_sync);
+}
@@ -290,7 +290,9 @@ void wlr_output_init(struct wlr_output *output, struct wlr_backend *backend,
 	wl_list_init(&output->resources);
 	wl_signal_init(&output->events.frame);
 	wl_signal_init(&output->events.needs_swap);
+	wl_signal_init(&output->events.make_current);
 	wl_signal_init(&output->events.swap_buffers);
+	wl_signal_init(&output->events.commit);
 	wl_signal_init(&output->events.present);
 	wl_signal_init(&output->events.enable);
 	wl_signal_init(&output->events.mode);
@@ -361,7 +363,12 @@ void wlr_output_effective_resolution(struct wlr_output *output,
 }
 
 bool wlr_output_make_current(struct wlr_output *output, int *buffer_age) {
-	return output->impl->make_current(output, buffer_age);
+	if (!output->impl->make_current(output, buffer_age)) {
+		return false;
+	}
+
+	wlr_signal_emit_safe(&output->events.make_current, output);
+	return true;
 }
 
 bool wlr_output_preferred_read_format(struct wlr_output *output,
@@ -418,6 +425,8 @@ bool wlr_output_swap_buffers(struct wlr_output *output, struct timespec *when,
 
 	pixman_region32_fini(&render_damage);
 
+	wlr_signal_emit_safe(&output->events.commit, &event);
+
 	struct wlr_output_cursor *cursor;
 	wl_list_for_each(cursor, &output->cursors, link) {
 		if (!cursor->enabled || !cursor->visible || cursor->surface == NULL) {
@@ -499,6 +508,21 @@ size_t wlr_output_get_gamma_size(struct wlr_output *output) {
 	return output->impl->get_gamma_size(output);
 }
 
+bool wlr_output_enable_adaptive_sync(struct wlr_output *output, bool enabled) {
+	if (output->adaptive_sync_enabled == enabled) {
+		return true;
+	}
+	if (!output->impl->set_adaptive_sync ||
+			(enabled && !output->adaptive_sync_capable)) {
+		return false;
+	}
+	if (!output->impl->set_adaptive_sync(output, enabled)) {
+		return false;
+	}
+	output->adaptive_sync_enabled = enabled;
+	return true;
+}
+
 bool wlr_output_export_dmabuf(struct wlr_output *output,
 		struct wlr_dmabuf_attributes *attribs) {
 	if (!output->impl->export_dmabuf) {
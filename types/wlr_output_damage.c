@@ -5,6 +5,8 @@
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output_damage.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+#include <wlr/util/region.h>
 #include "util/signal.h"
 
 static void output_handle_destroy(struct wl_listener *listener, void *data) {
@@ -62,8 +64,16 @@ struct wlr_output_damage *wlr_output_damage_create(struct wlr_output *output) {
 	wl_signal_init(&output_damage->events.frame);
 	wl_signal_init(&output_damage->events.destroy);
 
+	output_damage->previous = calloc(WLR_OUTPUT_DAMAGE_PREVIOUS_LEN,
+		sizeof(pixman_region32_t));
+	if (output_damage->previous == NULL) {
+		free(output_damage);
+		return NULL;
+	}
+	output_damage->previous_len = WLR_OUTPUT_DAMAGE_PREVIOUS_LEN;
+
 	pixman_region32_init(&output_damage->current);
-	for (size_t i = 0; i < WLR_OUTPUT_DAMAGE_PREVIOUS_LEN; ++i) {
+	for (size_t i = 0; i < output_damage->previous_len; ++i) {
 		pixman_region32_init(&output_damage->previous[i]);
 	}
 
@@ -95,12 +105,45 @@ void wlr_output_damage_destroy(struct wlr_output_damage *output_damage) {
 	wl_list_remove(&output_damage->output_needs_swap.link);
 	wl_list_remove(&output_damage->output_frame.link);
 	pixman_region32_fini(&output_damage->current);
-	for (size_t i = 0; i < WLR_OUTPUT_DAMAGE_PREVIOUS_LEN; ++i) {
+	for (size_t i = 0; i < output_damage->previous_len; ++i) {
 		pixman_region32_fini(&output_damage->previous[i]);
 	}
+	free(output_damage->previous);
 	free(output_damage);
 }
 
+/**
+ * Grows the damage history to `len` frames. The damage of the frames which
+ * haven't been tracked is unknown, so they're considered fully damaged.
+ */
+static bool output_damage_grow_previous(struct wlr_output_damage *output_damage,
+		size_t len) {
+	pixman_region32_t *previous = calloc(len, sizeof(pixman_region32_t));
+	if (previous == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+
+	// Reorder the queue from the most recent frame
+	size_t idx = output_damage->previous_idx;
+	for (size_t i = 0; i < output_damage->previous_len; ++i) {
+		previous[i] =
+			output_damage->previous[(idx + i) % output_damage->previous_len];
+	}
+
+	int width, height;
+	wlr_output_transformed_resolution(output_damage->output, &width, &height);
+	for (size_t i = output_damage->previous_len; i < len; ++i) {
+		pixman_region32_init_rect(&previous[i], 0, 0, width, height);
+	}
+
+	free(output_damage->previous);
+	output_damage->previous = previous;
+	output_damage->previous_len = len;
+	output_damage->previous_idx = 0;
+	return true;
+}
+
 bool wlr_output_damage_make_current(struct wlr_output_damage *output_damage,
 		bool *needs_swap, pixman_region32_t *damage) {
 	struct wlr_output *output = output_damage->output;
@@ -110,8 +153,15 @@ bool wlr_output_damage_make_current(struct wlr_output_damage *output_damage,
 		return false;
 	}
 
+	// Keep as many frames as the output has buffers
+	if (buffer_age - 1 > (int)output_damage->previous_len &&
+			buffer_age - 1 <= WLR_OUTPUT_DAMAGE_MAX_PREVIOUS_LEN) {
+		output_damage_grow_previous(output_damage, buffer_age - 1);
+	}
+
 	// Check if we can use damage tracking
-	if (buffer_age <= 0 || buffer_age - 1 > WLR_OUTPUT_DAMAGE_PREVIOUS_LEN) {
+	if (buffer_age <= 0 ||
+			buffer_age - 1 > (int)output_damage->previous_len) {
 		int width, height;
 		wlr_output_transformed_resolution(output, &width, &height);
 
@@ -123,17 +173,12 @@ bool wlr_output_damage_make_current(struct wlr_output_damage *output_damage,
 		// Accumulate damage from old buffers
 		size_t idx = output_damage->previous_idx;
 		for (int i = 0; i < buffer_age - 1; ++i) {
-			int j = (idx + i) % WLR_OUTPUT_DAMAGE_PREVIOUS_LEN;
+			int j = (idx + i) % output_damage->previous_len;
 			pixman_region32_union(damage, damage, &output_damage->previous[j]);
 		}
 
 		// Check the number of rectangles
-		int n_rects = pixman_region32_n_rects(damage);
-		if (n_rects > output_damage->max_rects) {
-			pixman_box32_t *extents = pixman_region32_extents(damage);
-			pixman_region32_union_rect(damage, damage, extents->x1, extents->y1,
-				extents->x2 - extents->x1, extents->y2 - extents->y1);
-		}
+		wlr_region_simplify(damage, damage, output_damage->max_rects);
 	}
 
 	*needs_swap = output->needs_swap || pixman_region32_not_empty(damage);
@@ -147,8 +192,8 @@ bool wlr_output_damage_swap_buffers(struct wlr_output_damage *output_damage,
 	}
 
 	// same as decrementing, but works on unsigned integers
-	output_damage->previous_idx += WLR_OUTPUT_DAMAGE_PREVIOUS_LEN - 1;
-	output_damage->previous_idx %= WLR_OUTPUT_DAMAGE_PREVIOUS_LEN;
+	output_damage->previous_idx += output_damage->previous_len - 1;
+	output_damage->previous_idx %= output_damage->previous_len;
 
 	pixman_region32_copy(&output_damage->previous[output_damage->previous_idx],
 		&output_damage->current);
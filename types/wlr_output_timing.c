@@ -0,0 +1,239 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/backend.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_output_timing.h>
+#include <wlr/types/wlr_output.h>
+#include "util/signal.h"
+
+static int64_t timespec_to_nsec(const struct timespec *t) {
+	return (int64_t)t->tv_sec * 1000000000 + t->tv_nsec;
+}
+
+static void timing_push_record(struct wlr_output_timing *timing,
+		struct wlr_output_timing_record *record,
+		struct wlr_render_timer *timer) {
+	if (record->stages == 0) {
+		return;
+	}
+
+	if (timer != NULL && (record->stages & WLR_OUTPUT_TIMING_RENDER_END)) {
+		int64_t duration = wlr_render_timer_get_duration_ns(timer);
+		if (duration >= 0) {
+			record->gpu_duration_ns = duration;
+			record->stages |= WLR_OUTPUT_TIMING_GPU;
+		}
+	}
+
+	timing->history[timing->history_idx] = *record;
+	struct wlr_output_timing_record *stored =
+		&timing->history[timing->history_idx];
+	timing->history_idx =
+		(timing->history_idx + 1) % WLR_OUTPUT_TIMING_HISTORY_LEN;
+	if (timing->history_len < WLR_OUTPUT_TIMING_HISTORY_LEN) {
+		timing->history_len++;
+	}
+
+	memset(record, 0, sizeof(*record));
+
+	wlr_signal_emit_safe(&timing->events.record, stored);
+}
+
+static void timing_get_time(struct wlr_output_timing *timing,
+		struct timespec *t) {
+	clock_gettime(timing->clock, t);
+}
+
+static void output_handle_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *timing =
+		wl_container_of(listener, timing, output_destroy);
+	wlr_output_timing_destroy(timing);
+}
+
+static void output_handle_frame(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *timing =
+		wl_container_of(listener, timing, output_frame);
+
+	// The previous frame callback didn't result in a new frame being
+	// submitted, record it anyway
+	timing_push_record(timing, &timing->pending, timing->pending_timer);
+	timing->pending_timer = NULL;
+
+	timing->pending.seq = timing->next_seq++;
+	timing->pending.stages = WLR_OUTPUT_TIMING_FRAME;
+	timing_get_time(timing, &timing->pending.frame);
+}
+
+static void output_handle_make_current(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_timing *timing =
+		wl_container_of(listener, timing, output_make_current);
+
+	if (timing->pending.stages & WLR_OUTPUT_TIMING_RENDER_BEGIN) {
+		// Only the first call per frame marks the start of rendering
+		return;
+	}
+	if (timing->pending.stages == 0) {
+		// Rendering without a prior frame event
+		timing->pending.seq = timing->next_seq++;
+	}
+	timing->pending.stages |= WLR_OUTPUT_TIMING_RENDER_BEGIN;
+	timing_get_time(timing, &timing->pending.render_begin);
+
+	if (!timing->gpu_timers_unsupported && timing->gpu_timers[0] == NULL) {
+		struct wlr_renderer *renderer =
+			wlr_backend_get_renderer(timing->output->backend);
+		for (size_t i = 0; renderer != NULL && i < 2; ++i) {
+			timing->gpu_timers[i] = wlr_render_timer_create(renderer);
+		}
+		if (timing->gpu_timers[0] == NULL || timing->gpu_timers[1] == NULL) {
+			wlr_render_timer_destroy(timing->gpu_timers[0]);
+			wlr_render_timer_destroy(timing->gpu_timers[1]);
+			timing->gpu_timers[0] = timing->gpu_timers[1] = NULL;
+			timing->gpu_timers_unsupported = true;
+		}
+	}
+
+	if (timing->gpu_timers[0] != NULL) {
+		// Don't clobber the query of the frame waiting for presentation
+		timing->pending_timer =
+			timing->gpu_timers[0] == timing->submitted_timer ?
+			timing->gpu_timers[1] : timing->gpu_timers[0];
+		wlr_render_timer_begin(timing->pending_timer);
+	}
+}
+
+static void output_handle_swap_buffers(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_timing *timing =
+		wl_container_of(listener, timing, output_swap_buffers);
+
+	if (!(timing->pending.stages & WLR_OUTPUT_TIMING_RENDER_BEGIN)) {
+		return;
+	}
+	timing->pending.stages |= WLR_OUTPUT_TIMING_RENDER_END;
+	timing_get_time(timing, &timing->pending.render_end);
+
+	if (timing->pending_timer != NULL) {
+		wlr_render_timer_end(timing->pending_timer);
+	}
+}
+
+static void output_handle_commit(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *timing =
+		wl_container_of(listener, timing, output_commit);
+
+	if (timing->pending.stages == 0) {
+		return;
+	}
+
+	// The previously submitted frame has been superseded without being
+	// presented
+	timing_push_record(timing, &timing->submitted, timing->submitted_timer);
+
+	timing->pending.stages |= WLR_OUTPUT_TIMING_SUBMIT;
+	timing_get_time(timing, &timing->pending.submit);
+
+	timing->submitted = timing->pending;
+	timing->submitted_timer = timing->pending_timer;
+	memset(&timing->pending, 0, sizeof(timing->pending));
+	timing->pending_timer = NULL;
+}
+
+static void output_handle_present(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *timing =
+		wl_container_of(listener, timing, output_present);
+	struct wlr_output_event_present *event = data;
+
+	struct wlr_output_timing_record *record = &timing->submitted;
+	if (record->stages == 0) {
+		return;
+	}
+
+	record->stages |= WLR_OUTPUT_TIMING_PRESENT;
+	if (event->when != NULL) {
+		record->present = *event->when;
+	} else {
+		timing_get_time(timing, &record->present);
+	}
+	record->present_seq = event->seq;
+	record->refresh = event->refresh;
+	record->present_flags = event->flags;
+
+	if (event->seq != 0 && timing->last_present_seq != 0 &&
+			event->seq > timing->last_present_seq) {
+		record->missed_vblanks = event->seq - timing->last_present_seq - 1;
+	} else if (event->seq == 0 && event->refresh > 0 &&
+			(record->stages & WLR_OUTPUT_TIMING_SUBMIT)) {
+		// No vblank counter, estimate from the submission latency
+		int64_t latency = timespec_to_nsec(&record->present) -
+			timespec_to_nsec(&record->submit);
+		if (latency > event->refresh) {
+			record->missed_vblanks = latency / event->refresh;
+		}
+	}
+	timing->last_present_seq = event->seq;
+
+	timing_push_record(timing, record, timing->submitted_timer);
+	timing->submitted_timer = NULL;
+}
+
+struct wlr_output_timing *wlr_output_timing_create(struct wlr_output *output) {
+	struct wlr_output_timing *timing =
+		calloc(1, sizeof(struct wlr_output_timing));
+	if (timing == NULL) {
+		return NULL;
+	}
+
+	timing->output = output;
+	timing->clock = wlr_backend_get_presentation_clock(output->backend);
+	wl_signal_init(&timing->events.record);
+	wl_signal_init(&timing->events.destroy);
+
+	wl_signal_add(&output->events.destroy, &timing->output_destroy);
+	timing->output_destroy.notify = output_handle_destroy;
+	wl_signal_add(&output->events.frame, &timing->output_frame);
+	timing->output_frame.notify = output_handle_frame;
+	wl_signal_add(&output->events.make_current, &timing->output_make_current);
+	timing->output_make_current.notify = output_handle_make_current;
+	wl_signal_add(&output->events.swap_buffers, &timing->output_swap_buffers);
+	timing->output_swap_buffers.notify = output_handle_swap_buffers;
+	wl_signal_add(&output->events.commit, &timing->output_commit);
+	timing->output_commit.notify = output_handle_commit;
+	wl_signal_add(&output->events.present, &timing->output_present);
+	timing->output_present.notify = output_handle_present;
+
+	return timing;
+}
+
+void wlr_output_timing_destroy(struct wlr_output_timing *timing) {
+	if (timing == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&timing->events.destroy, timing);
+	wl_list_remove(&timing->output_destroy.link);
+	wl_list_remove(&timing->output_frame.link);
+	wl_list_remove(&timing->output_make_current.link);
+	wl_list_remove(&timing->output_swap_buffers.link);
+	wl_list_remove(&timing->output_commit.link);
+	wl_list_remove(&timing->output_present.link);
+	wlr_render_timer_destroy(timing->gpu_timers[0]);
+	wlr_render_timer_destroy(timing->gpu_timers[1]);
+	free(timing);
+}
+
+size_t wlr_output_timing_get_history(struct wlr_output_timing *timing,
+		struct wlr_output_timing_record *records, size_t len) {
+	if (len > timing->history_len) {
+		len = timing->history_len;
+	}
+	// history_idx points right after the most recent record
+	size_t start = timing->history_idx + WLR_OUTPUT_TIMING_HISTORY_LEN - len;
+	for (size_t i = 0; i < len; ++i) {
+		records[i] = timing->history[(start + i) % WLR_OUTPUT_TIMING_HISTORY_LEN];
+	}
+	return len;
+}
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 199309L
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_output_timing_v1.h>
+#include <wlr/types/wlr_output.h>
+#include "util/signal.h"
+#include "wlr-output-timing-unstable-v1-protocol.h"
+
+#define OUTPUT_TIMING_MANAGER_VERSION 1
+
+static const struct zwlr_output_timing_v1_interface timing_impl;
+
+static struct wlr_output_timing_v1 *timing_from_resource(
+		struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource,
+		&zwlr_output_timing_v1_interface, &timing_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void timing_handle_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static const struct zwlr_output_timing_v1_interface timing_impl = {
+	.destroy = timing_handle_destroy,
+};
+
+static void timing_destroy(struct wlr_output_timing_v1 *timing) {
+	if (timing == NULL) {
+		return;
+	}
+	wl_list_remove(&timing->link);
+	wl_list_remove(&timing->timing_record.link);
+	wl_list_remove(&timing->timing_destroy.link);
+	wlr_output_timing_destroy(timing->timing);
+	// Make the timing resource inert
+	wl_resource_set_user_data(timing->resource, NULL);
+	free(timing);
+}
+
+static void timing_handle_resource_destroy(struct wl_resource *resource) {
+	struct wlr_output_timing_v1 *timing = timing_from_resource(resource);
+	timing_destroy(timing);
+}
+
+static uint32_t timespec_offset(const struct timespec *base,
+		const struct timespec *t) {
+	int64_t offset = (int64_t)(t->tv_sec - base->tv_sec) * 1000000000 +
+		(t->tv_nsec - base->tv_nsec);
+	if (offset < 0) {
+		return 0;
+	}
+	return offset > UINT32_MAX ? UINT32_MAX : offset;
+}
+
+static void timing_handle_record(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing_v1 *timing =
+		wl_container_of(listener, timing, timing_record);
+	struct wlr_output_timing_record *record = data;
+
+	const struct timespec *stages[] = {
+		&record->frame,
+		&record->render_begin,
+		&record->render_end,
+		&record->submit,
+		&record->present,
+	};
+	const struct timespec *base = NULL;
+	for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); ++i) {
+		if (record->stages & (1 << i)) {
+			base = stages[i];
+			break;
+		}
+	}
+	if (base == NULL) {
+		return;
+	}
+
+	uint32_t offsets[sizeof(stages) / sizeof(stages[0])] = {0};
+	for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); ++i) {
+		if (record->stages & (1 << i)) {
+			offsets[i] = timespec_offset(base, stages[i]);
+		}
+	}
+
+	uint32_t gpu_duration = 0;
+	if (record->stages & WLR_OUTPUT_TIMING_GPU) {
+		gpu_duration = record->gpu_duration_ns > UINT32_MAX ?
+			UINT32_MAX : record->gpu_duration_ns;
+	}
+
+	uint64_t tv_sec = base->tv_sec;
+	zwlr_output_timing_v1_send_frame(timing->resource,
+		record->seq >> 32, record->seq & 0xFFFFFFFF,
+		tv_sec >> 32, tv_sec & 0xFFFFFFFF, base->tv_nsec, record->stages,
+		offsets[0], offsets[1], offsets[2], offsets[3], offsets[4],
+		gpu_duration, record->refresh > 0 ? record->refresh : 0,
+		record->missed_vblanks);
+}
+
+static void timing_handle_timing_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_timing_v1 *timing =
+		wl_container_of(listener, timing, timing_destroy);
+	// The output has been destroyed
+	timing->timing = NULL;
+	timing_destroy(timing);
+}
+
+
+static const struct zwlr_output_timing_manager_v1_interface manager_impl;
+
+static struct wlr_output_timing_manager_v1 *manager_from_resource(
+		struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource,
+		&zwlr_output_timing_manager_v1_interface, &manager_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void manager_handle_get_output_timing(struct wl_client *client,
+		struct wl_resource *manager_resource, uint32_t id,
+		struct wl_resource *output_resource) {
+	struct wlr_output_timing_manager_v1 *manager =
+		manager_from_resource(manager_resource);
+	struct wlr_output *output = wlr_output_from_resource(output_resource);
+
+	uint32_t version = wl_resource_get_version(manager_resource);
+	struct wl_resource *resource = wl_resource_create(client,
+		&zwlr_output_timing_v1_interface, version, id);
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &timing_impl, NULL, NULL);
+
+	if (output == NULL) {
+		return; // leave the resource inert
+	}
+
+	struct wlr_output_timing_v1 *timing =
+		calloc(1, sizeof(struct wlr_output_timing_v1));
+	if (timing == NULL) {
+		wl_resource_post_no_memory(manager_resource);
+		return;
+	}
+	timing->timing = wlr_output_timing_create(output);
+	if (timing->timing == NULL) {
+		free(timing);
+		wl_resource_post_no_memory(manager_resource);
+		return;
+	}
+	timing->manager = manager;
+	timing->resource = resource;
+	wl_resource_set_implementation(resource, &timing_impl, timing,
+		timing_handle_resource_destroy);
+
+	wl_list_insert(&manager->timings, &timing->link);
+
+	wl_signal_add(&timing->timing->events.record, &timing->timing_record);
+	timing->timing_record.notify = timing_handle_record;
+	wl_signal_add(&timing->timing->events.destroy, &timing->timing_destroy);
+	timing->timing_destroy.notify = timing_handle_timing_destroy;
+
+	zwlr_output_timing_v1_send_clock_id(resource, timing->timing->clock);
+}
+
+static void manager_handle_destroy(struct wl_client *client,
+		struct wl_resource *manager_resource) {
+	wl_resource_destroy(manager_resource);
+}
+
+static const struct zwlr_output_timing_manager_v1_interface manager_impl = {
+	.get_output_timing = manager_handle_get_output_timing,
+	.destroy = manager_handle_destroy,
+};
+
+static void manager_handle_resource_destroy(struct wl_resource *resource) {
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void manager_bind(struct wl_client *client, void *data, uint32_t version,
+		uint32_t id) {
+	struct wlr_output_timing_manager_v1 *manager = data;
+
+	struct wl_resource *resource = wl_resource_create(client,
+		&zwlr_output_timing_manager_v1_interface, version, id);
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &manager_impl, manager,
+		manager_handle_resource_destroy);
+
+	wl_list_insert(&manager->resources, wl_resource_get_link(resource));
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing_manager_v1 *manager =
+		wl_container_of(listener, manager, display_destroy);
+	wlr_output_timing_manager_v1_destroy(manager);
+}
+
+struct wlr_output_timing_manager_v1 *wlr_output_timing_manager_v1_create(
+		struct wl_display *display) {
+	struct wlr_output_timing_manager_v1 *manager =
+		calloc(1, sizeof(struct wlr_output_timing_manager_v1));
+	if (manager == NULL) {
+		return NULL;
+	}
+	wl_list_init(&manager->resources);
+	wl_list_init(&manager->timings);
+	wl_signal_init(&manager->events.destroy);
+
+	manager->global = wl_global_create(display,
+		&zwlr_output_timing_manager_v1_interface, OUTPUT_TIMING_MANAGER_VERSION,
+		manager, manager_bind);
+	if (manager->global == NULL) {
+		free(manager);
+		return NULL;
+	}
+
+	manager->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &manager->display_destroy);
+
+	return manager;
+}
+
+void wlr_output_timing_manager_v1_destroy(
+		struct wlr_output_timing_manager_v1 *manager) {
+	if (manager == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&manager->events.destroy, manager);
+	wl_list_remove(&manager->display_destroy.link);
+	wl_global_destroy(manager->global);
+	struct wl_resource *resource, *resource_tmp;
+	wl_resource_for_each_safe(resource, resource_tmp, &manager->resources) {
+		wl_resource_destroy(resource);
+	}
+	struct wlr_output_timing_v1 *timing, *timing_tmp;
+	wl_list_for_each_safe(timing, timing_tmp, &manager->timings, link) {
+		wl_resource_destroy(timing->resource);
+	}
+	free(manager);
+}
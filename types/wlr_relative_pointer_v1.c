@@ -272,4 +272,7 @@ void wlr_relative_pointer_manager_v1_send_relative_motion(
 			wl_fixed_from_double(dx), wl_fixed_from_double(dy),
 			wl_fixed_from_double(dx_unaccel), wl_fixed_from_double(dy_unaccel));
 	}
+
+	// Relative motion isn't coalesced, it needs its own frame
+	seat->pointer_state.frame_needed = true;
 }
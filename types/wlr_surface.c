@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <wayland-server.h>
 #include <wlr/render/interface.h>
@@ -138,6 +139,40 @@ static void surface_set_input_region(struct wl_client *client,
 	}
 }
 
+/**
+ * Computes the buffer size in surface-local coordinates, before the viewport
+ * is applied.
+ */
+static void surface_state_transformed_buffer_size(
+		struct wlr_surface_state *state, int *out_width, int *out_height) {
+	int width = state->buffer_width / state->scale;
+	int height = state->buffer_height / state->scale;
+	if ((state->transform & WL_OUTPUT_TRANSFORM_90) != 0) {
+		int tmp = width;
+		width = height;
+		height = tmp;
+	}
+	*out_width = width;
+	*out_height = height;
+}
+
+/**
+ * Computes the size of the viewport source rectangle, in the same coordinates
+ * as `surface_state_transformed_buffer_size`.
+ */
+static void surface_state_viewport_src_size(struct wlr_surface_state *state,
+		double *out_width, double *out_height) {
+	if (state->viewport.has_src) {
+		*out_width = state->viewport.src.width;
+		*out_height = state->viewport.src.height;
+	} else {
+		int width, height;
+		surface_state_transformed_buffer_size(state, &width, &height);
+		*out_width = width;
+		*out_height = height;
+	}
+}
+
 static void surface_state_finalize(struct wlr_surface *surface,
 		struct wlr_surface_state *state) {
 	if ((state->committed & WLR_SURFACE_STATE_BUFFER)) {
@@ -149,15 +184,19 @@ static void surface_state_finalize(struct wlr_surface *surface,
 		}
 	}
 
-	int width = state->buffer_width / state->scale;
-	int height = state->buffer_height / state->scale;
-	if ((state->transform & WL_OUTPUT_TRANSFORM_90) != 0) {
-		int tmp = width;
-		width = height;
-		height = tmp;
+	if (state->buffer_width == 0 && state->buffer_height == 0) {
+		state->width = state->height = 0;
+	} else if (state->viewport.has_dst) {
+		state->width = state->viewport.dst_width;
+		state->height = state->viewport.dst_height;
+	} else if (state->viewport.has_src) {
+		// Without a destination size, the source size must be integral
+		state->width = state->viewport.src.width;
+		state->height = state->viewport.src.height;
+	} else {
+		surface_state_transformed_buffer_size(state,
+			&state->width, &state->height);
 	}
-	state->width = width;
-	state->height = height;
 
 	pixman_region32_intersect_rect(&state->surface_damage,
 		&state->surface_damage, 0, 0, state->width, state->height);
@@ -172,29 +211,50 @@ static void surface_update_damage(pixman_region32_t *buffer_damage,
 	pixman_region32_clear(buffer_damage);
 
 	if (pending->width != current->width ||
-			pending->height != current->height) {
-		// Damage the whole buffer on resize
+			pending->height != current->height ||
+			(pending->committed & WLR_SURFACE_STATE_VIEWPORT)) {
+		// Damage the whole buffer on resize or when the viewport changes
 		pixman_region32_union_rect(buffer_damage, buffer_damage, 0, 0,
 			pending->buffer_width, pending->buffer_height);
 	} else {
-		// Copy over surface damage + buffer damage
-		pixman_region32_t surface_damage;
-		pixman_region32_init(&surface_damage);
-
-		pixman_region32_copy(&surface_damage, &pending->surface_damage);
-		wlr_region_transform(&surface_damage, &surface_damage,
-			wlr_output_transform_invert(pending->transform),
-			pending->width, pending->height);
-		wlr_region_scale(&surface_damage, &surface_damage, pending->scale);
+		// Copy over surface damage + buffer damage. The surface damage is
+		// converted in place to avoid a temporary region.
+		pixman_region32_copy(buffer_damage, &pending->surface_damage);
+		if (pending->viewport.has_dst) {
+			double src_width, src_height;
+			surface_state_viewport_src_size(pending, &src_width, &src_height);
+			wlr_region_scale_xy(buffer_damage, buffer_damage,
+				src_width / pending->viewport.dst_width,
+				src_height / pending->viewport.dst_height);
+		}
+		if (pending->viewport.has_src) {
+			// The source may not be aligned with the buffer pixels, round
+			// the damage outwards in that case
+			pixman_region32_translate(buffer_damage,
+				floor(pending->viewport.src.x),
+				floor(pending->viewport.src.y));
+			if (pending->viewport.src.x != floor(pending->viewport.src.x) ||
+					pending->viewport.src.y != floor(pending->viewport.src.y)) {
+				wlr_region_expand(buffer_damage, buffer_damage, 1);
+			}
+		}
 
-		pixman_region32_union(buffer_damage,
-			&pending->buffer_damage, &surface_damage);
+		int width, height;
+		surface_state_transformed_buffer_size(pending, &width, &height);
+		wlr_region_transform(buffer_damage, buffer_damage,
+			wlr_output_transform_invert(pending->transform), width, height);
+		wlr_region_scale(buffer_damage, buffer_damage, pending->scale);
 
-		pixman_region32_fini(&surface_damage);
+		pixman_region32_union(buffer_damage, buffer_damage,
+			&pending->buffer_damage);
 	}
+
+	// Scaling and expanding round outwards, which can go past the buffer
+	pixman_region32_intersect_rect(buffer_damage, buffer_damage, 0, 0,
+		pending->buffer_width, pending->buffer_height);
 }
 
-static void surface_state_copy(struct wlr_surface_state *state,
+static void surface_state_copy_attributes(struct wlr_surface_state *state,
 		struct wlr_surface_state *next) {
 	state->width = next->width;
 	state->height = next->height;
@@ -207,12 +267,23 @@ static void surface_state_copy(struct wlr_surface_state *state,
 	if (next->committed & WLR_SURFACE_STATE_TRANSFORM) {
 		state->transform = next->transform;
 	}
+	if (next->committed & WLR_SURFACE_STATE_VIEWPORT) {
+		state->viewport = next->viewport;
+	}
 	if (next->committed & WLR_SURFACE_STATE_BUFFER) {
 		state->dx = next->dx;
 		state->dy = next->dy;
 	} else {
 		state->dx = state->dy = 0;
 	}
+
+	state->committed |= next->committed;
+}
+
+static void surface_state_copy(struct wlr_surface_state *state,
+		struct wlr_surface_state *next) {
+	surface_state_copy_attributes(state, next);
+
 	if (next->committed & WLR_SURFACE_STATE_SURFACE_DAMAGE) {
 		pixman_region32_copy(&state->surface_damage, &next->surface_damage);
 	} else {
@@ -229,16 +300,23 @@ static void surface_state_copy(struct wlr_surface_state *state,
 	if (next->committed & WLR_SURFACE_STATE_INPUT_REGION) {
 		pixman_region32_copy(&state->input, &next->input);
 	}
+}
 
-	state->committed |= next->committed;
+static void region_swap(pixman_region32_t *a, pixman_region32_t *b) {
+	pixman_region32_t tmp = *a;
+	*a = *b;
+	*b = tmp;
 }
 
 /**
  * Append pending state to current state and clear pending state.
+ *
+ * Regions are swapped instead of copied. The regions left in `next` are stale,
+ * but are only read again after the client sets them, which overwrites them.
  */
 static void surface_state_move(struct wlr_surface_state *state,
 		struct wlr_surface_state *next) {
-	surface_state_copy(state, next);
+	surface_state_copy_attributes(state, next);
 
 	if (next->committed & WLR_SURFACE_STATE_BUFFER) {
 		surface_state_set_buffer(state, next->buffer_resource);
@@ -246,10 +324,22 @@ static void surface_state_move(struct wlr_surface_state *state,
 		next->dx = next->dy = 0;
 	}
 	if (next->committed & WLR_SURFACE_STATE_SURFACE_DAMAGE) {
+		region_swap(&state->surface_damage, &next->surface_damage);
 		pixman_region32_clear(&next->surface_damage);
+	} else {
+		pixman_region32_clear(&state->surface_damage);
 	}
 	if (next->committed & WLR_SURFACE_STATE_BUFFER_DAMAGE) {
+		region_swap(&state->buffer_damage, &next->buffer_damage);
 		pixman_region32_clear(&next->buffer_damage);
+	} else {
+		pixman_region32_clear(&state->buffer_damage);
+	}
+	if (next->committed & WLR_SURFACE_STATE_OPAQUE_REGION) {
+		region_swap(&state->opaque, &next->opaque);
+	}
+	if (next->committed & WLR_SURFACE_STATE_INPUT_REGION) {
+		region_swap(&state->input, &next->input);
 	}
 	if (next->committed & WLR_SURFACE_STATE_FRAME_CALLBACK_LIST) {
 		wl_list_insert_list(&state->frame_callback_list,
@@ -316,6 +406,7 @@ static void surface_update_opaque_region(struct wlr_surface *surface) {
 	}
 
 	if (wlr_texture_is_opaque(texture)) {
+		pixman_region32_fini(&surface->opaque_region);
 		pixman_region32_init_rect(&surface->opaque_region,
 			0, 0, surface->current.width, surface->current.height);
 		return;
@@ -332,22 +423,28 @@ static void surface_update_input_region(struct wlr_surface *surface) {
 		0, 0, surface->current.width, surface->current.height);
 }
 
-static void surface_commit_pending(struct wlr_surface *surface) {
-	surface_state_finalize(surface, &surface->pending);
+/**
+ * Applies `next` to the current state. `next` is usually the pending state,
+ * but can also be state cached by a synchronized subsurface or held by
+ * wlr_surface_hold_commits.
+ */
+static void surface_commit_state(struct wlr_surface *surface,
+		struct wlr_surface_state *next) {
+	surface_state_finalize(surface, next);
 
 	if (surface->role && surface->role->precommit) {
-		surface->role->precommit(surface);
+		surface->role->precommit(surface, next);
 	}
 
-	bool invalid_buffer = surface->pending.committed & WLR_SURFACE_STATE_BUFFER;
+	bool invalid_buffer = next->committed & WLR_SURFACE_STATE_BUFFER;
 
-	surface->sx += surface->pending.dx;
-	surface->sy += surface->pending.dy;
+	surface->sx += next->dx;
+	surface->sy += next->dy;
 	surface_update_damage(&surface->buffer_damage,
-		&surface->current, &surface->pending);
+		&surface->current, next);
 
 	surface_state_copy(&surface->previous, &surface->current);
-	surface_state_move(&surface->current, &surface->pending);
+	surface_state_move(&surface->current, next);
 
 	if (invalid_buffer) {
 		surface_apply_damage(surface);
@@ -403,7 +500,7 @@ static void subsurface_parent_commit(struct wlr_subsurface *subsurface,
 	if (synchronized || subsurface->synchronized) {
 		if (subsurface->has_cache) {
 			surface_state_move(&surface->pending, &subsurface->cached);
-			surface_commit_pending(surface);
+			surface_commit_state(surface, &surface->pending);
 			subsurface->has_cache = false;
 			subsurface->cached.committed = 0;
 		}
@@ -424,10 +521,10 @@ static void subsurface_commit(struct wlr_subsurface *subsurface) {
 	} else {
 		if (subsurface->has_cache) {
 			surface_state_move(&surface->pending, &subsurface->cached);
-			surface_commit_pending(surface);
+			surface_commit_state(surface, &surface->pending);
 			subsurface->has_cache = false;
 		} else {
-			surface_commit_pending(surface);
+			surface_commit_state(surface, &surface->pending);
 		}
 	}
 }
@@ -436,12 +533,19 @@ static void surface_commit(struct wl_client *client,
 		struct wl_resource *resource) {
 	struct wlr_surface *surface = wlr_surface_from_resource(resource);
 
+	wlr_signal_emit_safe(&surface->events.client_commit, surface);
+
 	struct wlr_subsurface *subsurface = wlr_surface_is_subsurface(surface) ?
 		wlr_subsurface_from_wlr_surface(surface) : NULL;
 	if (subsurface != NULL) {
 		subsurface_commit(subsurface);
+	} else if (surface->commit_holds > 0) {
+		// Synchronized subsurfaces are applied along with the held state
+		surface_state_move(&surface->held, &surface->pending);
+		surface->has_held = true;
+		return;
 	} else {
-		surface_commit_pending(surface);
+		surface_commit_state(surface, &surface->pending);
 	}
 
 	wl_list_for_each(subsurface, &surface->subsurfaces, parent_link) {
@@ -449,6 +553,27 @@ static void surface_commit(struct wl_client *client,
 	}
 }
 
+void wlr_surface_hold_commits(struct wlr_surface *surface) {
+	assert(!wlr_surface_is_subsurface(surface));
+	surface->commit_holds++;
+}
+
+void wlr_surface_release_commits(struct wlr_surface *surface) {
+	assert(surface->commit_holds > 0);
+	surface->commit_holds--;
+	if (surface->commit_holds > 0 || !surface->has_held) {
+		return;
+	}
+
+	surface_commit_state(surface, &surface->held);
+	surface->has_held = false;
+
+	struct wlr_subsurface *subsurface;
+	wl_list_for_each(subsurface, &surface->subsurfaces, parent_link) {
+		subsurface_parent_commit(subsurface, false);
+	}
+}
+
 static void surface_set_buffer_transform(struct wl_client *client,
 		struct wl_resource *resource, int32_t transform) {
 	if (transform < WL_OUTPUT_TRANSFORM_NORMAL ||
@@ -572,6 +697,7 @@ static void surface_handle_resource_destroy(struct wl_resource *resource) {
 	surface_state_finish(&surface->pending);
 	surface_state_finish(&surface->current);
 	surface_state_finish(&surface->previous);
+	surface_state_finish(&surface->held);
 	pixman_region32_fini(&surface->buffer_damage);
 	pixman_region32_fini(&surface->opaque_region);
 	pixman_region32_fini(&surface->input_region);
@@ -613,8 +739,11 @@ struct wlr_surface *wlr_surface_create(struct wl_client *client,
 	surface_state_init(&surface->current);
 	surface_state_init(&surface->pending);
 	surface_state_init(&surface->previous);
+	surface_state_init(&surface->held);
 
+	wl_signal_init(&surface->events.client_commit);
 	wl_signal_init(&surface->events.commit);
+	wl_signal_init(&surface->events.frame_done);
 	wl_signal_init(&surface->events.destroy);
 	wl_signal_init(&surface->events.new_subsurface);
 	wl_list_init(&surface->subsurfaces);
@@ -891,15 +1020,16 @@ static void subsurface_role_commit(struct wlr_surface *surface) {
 	subsurface_consider_map(subsurface, true);
 }
 
-static void subsurface_role_precommit(struct wlr_surface *surface) {
+static void subsurface_role_precommit(struct wlr_surface *surface,
+		const struct wlr_surface_state *state) {
 	struct wlr_subsurface *subsurface =
 		wlr_subsurface_from_wlr_surface(surface);
 	if (subsurface == NULL) {
 		return;
 	}
 
-	if (surface->pending.committed & WLR_SURFACE_STATE_BUFFER &&
-			surface->pending.buffer_resource == NULL) {
+	if (state->committed & WLR_SURFACE_STATE_BUFFER &&
+			state->buffer_resource == NULL) {
 		// This is a NULL commit
 		subsurface_unmap(subsurface);
 	}
@@ -1056,6 +1186,12 @@ static inline int64_t timespec_to_msec(const struct timespec *a) {
 
 void wlr_surface_send_frame_done(struct wlr_surface *surface,
 		const struct timespec *when) {
+	if (wl_list_empty(&surface->current.frame_callback_list)) {
+		return;
+	}
+
+	wlr_signal_emit_safe(&surface->events.frame_done, (void *)when);
+
 	struct wl_resource *resource, *tmp;
 	wl_resource_for_each_safe(resource, tmp,
 			&surface->current.frame_callback_list) {
@@ -1126,6 +1262,26 @@ void wlr_surface_get_effective_damage(struct wlr_surface *surface,
 		surface->current.buffer_height);
 	wlr_region_scale(damage, damage, 1.0 / (float)surface->current.scale);
 
+	struct wlr_surface_state *current = &surface->current;
+	if (current->viewport.has_src) {
+		pixman_region32_translate(damage, -floor(current->viewport.src.x),
+			-floor(current->viewport.src.y));
+		if (current->viewport.src.x != floor(current->viewport.src.x) ||
+				current->viewport.src.y != floor(current->viewport.src.y)) {
+			wlr_region_expand(damage, damage, 1);
+		}
+	}
+	if (current->viewport.has_dst) {
+		double src_width, src_height;
+		surface_state_viewport_src_size(current, &src_width, &src_height);
+		// Filtering makes each source pixel bleed into its neighbours once
+		// scaled
+		wlr_region_expand(damage, damage, 1);
+		wlr_region_scale_xy(damage, damage,
+			current->viewport.dst_width / src_width,
+			current->viewport.dst_height / src_height);
+	}
+
 	// On resize, damage the previous bounds of the surface. The current bounds
 	// have already been damaged in surface_update_damage.
 	if (surface->previous.width > surface->current.width ||
@@ -1147,3 +1303,29 @@ void wlr_surface_get_effective_damage(struct wlr_surface *surface,
 			surface->previous.width, surface->previous.height);
 	}
 }
+
+void wlr_surface_get_buffer_source_box(struct wlr_surface *surface,
+		struct wlr_fbox *box) {
+	box->x = box->y = 0;
+	box->width = surface->current.buffer_width;
+	box->height = surface->current.buffer_height;
+
+	struct wlr_surface_state *current = &surface->current;
+	if (current->viewport.has_src) {
+		box->x = current->viewport.src.x * current->scale;
+		box->y = current->viewport.src.y * current->scale;
+		box->width = current->viewport.src.width * current->scale;
+		box->height = current->viewport.src.height * current->scale;
+
+		// The source box is in transformed buffer coordinates
+		double width = current->buffer_width;
+		double height = current->buffer_height;
+		if ((current->transform & WL_OUTPUT_TRANSFORM_90) != 0) {
+			double tmp = width;
+			width = height;
+			height = tmp;
+		}
+		wlr_fbox_transform(box, box,
+			wlr_output_transform_invert(current->transform), width, height);
+	}
+}
@@ -41,12 +41,26 @@ int wlr_xcursor_manager_load(struct wlr_xcursor_manager *manager,
 		}
 	}
 
+	// Share the theme index and decoded cursors with the other scales
+	struct wlr_xcursor_theme *shared = NULL;
+	if (!wl_list_empty(&manager->scaled_themes)) {
+		struct wlr_xcursor_manager_theme *first =
+			wl_container_of(manager->scaled_themes.next, first, link);
+		shared = first->theme;
+	}
+
 	theme = calloc(1, sizeof(struct wlr_xcursor_manager_theme));
 	if (theme == NULL) {
 		return 1;
 	}
 	theme->scale = scale;
-	theme->theme = wlr_xcursor_theme_load(manager->name, manager->size * scale);
+	if (shared != NULL) {
+		theme->theme = wlr_xcursor_theme_load_size(shared,
+			manager->size * scale);
+	} else {
+		theme->theme = wlr_xcursor_theme_load(manager->name,
+			manager->size * scale);
+	}
 	if (theme->theme == NULL) {
 		free(theme);
 		return 1;
@@ -319,6 +319,15 @@ static void xdg_surface_handle_surface_commit(struct wl_listener *listener,
 	}
 }
 
+static void xdg_surface_handle_surface_client_commit(
+		struct wl_listener *listener, void *data) {
+	struct wlr_xdg_surface *surface =
+		wl_container_of(listener, surface, surface_client_commit);
+	if (surface->role == WLR_XDG_SURFACE_ROLE_TOPLEVEL) {
+		handle_xdg_toplevel_client_commit(surface);
+	}
+}
+
 void handle_xdg_surface_commit(struct wlr_surface *wlr_surface) {
 	struct wlr_xdg_surface *surface =
 		wlr_xdg_surface_from_wlr_surface(wlr_surface);
@@ -361,15 +370,16 @@ void handle_xdg_surface_commit(struct wlr_surface *wlr_surface) {
 	}
 }
 
-void handle_xdg_surface_precommit(struct wlr_surface *wlr_surface) {
+void handle_xdg_surface_precommit(struct wlr_surface *wlr_surface,
+		const struct wlr_surface_state *state) {
 	struct wlr_xdg_surface *surface =
 		wlr_xdg_surface_from_wlr_surface(wlr_surface);
 	if (surface == NULL) {
 		return;
 	}
 
-	if (wlr_surface->pending.committed & WLR_SURFACE_STATE_BUFFER &&
-			wlr_surface->pending.buffer_resource == NULL) {
+	if (state->committed & WLR_SURFACE_STATE_BUFFER &&
+			state->buffer_resource == NULL) {
 		// This is a NULL commit
 		if (surface->configured && surface->mapped) {
 			unmap_xdg_surface(surface);
@@ -434,6 +444,11 @@ struct wlr_xdg_surface *create_xdg_surface(
 		&xdg_surface->surface_commit);
 	xdg_surface->surface_commit.notify = xdg_surface_handle_surface_commit;
 
+	wl_signal_add(&xdg_surface->surface->events.client_commit,
+		&xdg_surface->surface_client_commit);
+	xdg_surface->surface_client_commit.notify =
+		xdg_surface_handle_surface_client_commit;
+
 	wlr_log(WLR_DEBUG, "new xdg_surface %p (res %p)", xdg_surface,
 		xdg_surface->resource);
 	wl_resource_set_implementation(xdg_surface->resource,
@@ -493,6 +508,7 @@ void destroy_xdg_surface(struct wlr_xdg_surface *surface) {
 	wl_list_remove(&surface->link);
 	wl_list_remove(&surface->surface_destroy.link);
 	wl_list_remove(&surface->surface_commit.link);
+	wl_list_remove(&surface->surface_client_commit.link);
 	free(surface);
 }
 
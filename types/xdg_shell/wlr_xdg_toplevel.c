@@ -13,16 +13,20 @@ void handle_xdg_toplevel_ack_configure(
 	assert(surface->role == WLR_XDG_SURFACE_ROLE_TOPLEVEL);
 	assert(configure->toplevel_state != NULL);
 
-	surface->toplevel->current.maximized =
-		configure->toplevel_state->maximized;
-	surface->toplevel->current.fullscreen =
-		configure->toplevel_state->fullscreen;
-	surface->toplevel->current.resizing =
-		configure->toplevel_state->resizing;
-	surface->toplevel->current.activated =
-		configure->toplevel_state->activated;
-	surface->toplevel->current.tiled =
-		configure->toplevel_state->tiled;
+	// Applied once the client commits the surface state matching it, which
+	// may be held
+	surface->toplevel->acked = *configure->toplevel_state;
+	surface->toplevel->has_acked = true;
+}
+
+void handle_xdg_toplevel_client_commit(struct wlr_xdg_surface *surface) {
+	assert(surface->role == WLR_XDG_SURFACE_ROLE_TOPLEVEL);
+	struct wlr_xdg_toplevel *toplevel = surface->toplevel;
+	if (toplevel->has_acked) {
+		toplevel->committed = toplevel->acked;
+		toplevel->has_committed = true;
+		toplevel->has_acked = false;
+	}
 }
 
 bool compare_xdg_surface_toplevel_state(struct wlr_xdg_toplevel *state) {
@@ -38,7 +42,13 @@ bool compare_xdg_surface_toplevel_state(struct wlr_xdg_toplevel *state) {
 
 	if (wl_list_empty(&state->base->configure_list)) {
 		// last configure is actually the current state, just use it
-		configured.state = state->current;
+		if (state->has_acked) {
+			configured.state = state->acked;
+		} else if (state->has_committed) {
+			configured.state = state->committed;
+		} else {
+			configured.state = state->current;
+		}
 		configured.width = state->base->surface->current.width;
 		configured.height = state->base->surface->current.height;
 	} else {
@@ -187,6 +197,16 @@ void handle_xdg_surface_toplevel_committed(struct wlr_xdg_surface *surface) {
 		return;
 	}
 
+	struct wlr_xdg_toplevel *toplevel = surface->toplevel;
+	if (toplevel->has_committed) {
+		toplevel->has_committed = false;
+		toplevel->current.maximized = toplevel->committed.maximized;
+		toplevel->current.fullscreen = toplevel->committed.fullscreen;
+		toplevel->current.resizing = toplevel->committed.resizing;
+		toplevel->current.activated = toplevel->committed.activated;
+		toplevel->current.tiled = toplevel->committed.tiled;
+	}
+
 	// update state that doesn't need compositor approval
 	surface->toplevel->current.max_width =
 		surface->toplevel->client_pending.max_width;
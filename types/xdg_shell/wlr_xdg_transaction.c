@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+#include "util/signal.h"
+
+static void transaction_schedule_apply(struct wlr_xdg_transaction *transaction);
+
+static void participant_destroy(
+		struct wlr_xdg_transaction_participant *participant) {
+	struct wlr_xdg_transaction *transaction = participant->transaction;
+	if (!participant->ready) {
+		transaction->waiting--;
+	}
+	wl_list_remove(&participant->surface_client_commit.link);
+	wl_list_remove(&participant->surface_destroy.link);
+	wl_list_remove(&participant->link);
+	free(participant);
+}
+
+static void participant_set_ready(
+		struct wlr_xdg_transaction_participant *participant) {
+	struct wlr_xdg_transaction *transaction = participant->transaction;
+	if (participant->ready) {
+		return;
+	}
+	participant->ready = true;
+	transaction->waiting--;
+	if (transaction->committed && transaction->waiting == 0) {
+		transaction_schedule_apply(transaction);
+	}
+}
+
+static void participant_handle_surface_client_commit(
+		struct wl_listener *listener, void *data) {
+	struct wlr_xdg_transaction_participant *participant =
+		wl_container_of(listener, participant, surface_client_commit);
+	struct wlr_xdg_surface *xdg_surface =
+		wlr_xdg_surface_from_wlr_surface(participant->surface);
+	// Serials may wrap around
+	if (xdg_surface == NULL ||
+			(int32_t)(xdg_surface->configure_serial - participant->serial) >= 0) {
+		participant_set_ready(participant);
+	}
+}
+
+static void participant_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_xdg_transaction_participant *participant =
+		wl_container_of(listener, participant, surface_destroy);
+	struct wlr_xdg_transaction *transaction = participant->transaction;
+	participant_destroy(participant);
+	if (transaction->committed && transaction->waiting == 0) {
+		transaction_schedule_apply(transaction);
+	}
+}
+
+static void transaction_handle_apply(void *data) {
+	struct wlr_xdg_transaction *transaction = data;
+	transaction->apply_idle = NULL;
+	wlr_xdg_transaction_destroy(transaction);
+}
+
+static int transaction_handle_timeout(void *data) {
+	struct wlr_xdg_transaction *transaction = data;
+	wlr_log(WLR_DEBUG, "Transaction timed out with %zu participants waiting",
+		transaction->waiting);
+	wlr_xdg_transaction_destroy(transaction);
+	return 0;
+}
+
+static void transaction_schedule_apply(struct wlr_xdg_transaction *transaction) {
+	if (transaction->apply_idle != NULL) {
+		return;
+	}
+	// Applied from an idle callback so that the commit which made the last
+	// participant ready is held and applied along with the others
+	transaction->apply_idle = wl_event_loop_add_idle(transaction->event_loop,
+		transaction_handle_apply, transaction);
+	if (transaction->apply_idle == NULL) {
+		wlr_log(WLR_ERROR, "Failed to schedule transaction");
+	}
+}
+
+struct wlr_xdg_transaction *wlr_xdg_transaction_create(
+		struct wl_display *display) {
+	struct wlr_xdg_transaction *transaction =
+		calloc(1, sizeof(struct wlr_xdg_transaction));
+	if (transaction == NULL) {
+		return NULL;
+	}
+	transaction->event_loop = wl_display_get_event_loop(display);
+	wl_list_init(&transaction->participants);
+	wl_signal_init(&transaction->events.apply);
+	wl_signal_init(&transaction->events.destroy);
+	return transaction;
+}
+
+bool wlr_xdg_transaction_add_toplevel(struct wlr_xdg_transaction *transaction,
+		struct wlr_xdg_surface *surface, uint32_t serial) {
+	assert(surface->role == WLR_XDG_SURFACE_ROLE_TOPLEVEL);
+	assert(!transaction->committed);
+	if (serial == 0) {
+		return true;
+	}
+
+	struct wlr_xdg_transaction_participant *participant;
+	wl_list_for_each(participant, &transaction->participants, link) {
+		if (participant->surface == surface->surface) {
+			participant->serial = serial;
+			return true;
+		}
+	}
+
+	participant = calloc(1, sizeof(struct wlr_xdg_transaction_participant));
+	if (participant == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	participant->transaction = transaction;
+	participant->surface = surface->surface;
+	participant->serial = serial;
+
+	participant->surface_client_commit.notify =
+		participant_handle_surface_client_commit;
+	wl_signal_add(&surface->surface->events.client_commit,
+		&participant->surface_client_commit);
+	participant->surface_destroy.notify = participant_handle_surface_destroy;
+	wl_signal_add(&surface->surface->events.destroy,
+		&participant->surface_destroy);
+
+	wl_list_insert(transaction->participants.prev, &participant->link);
+	transaction->waiting++;
+
+	wlr_surface_hold_commits(surface->surface);
+	return true;
+}
+
+void wlr_xdg_transaction_commit(struct wlr_xdg_transaction *transaction,
+		int timeout_ms) {
+	assert(!transaction->committed);
+	transaction->committed = true;
+
+	if (transaction->waiting == 0) {
+		transaction_schedule_apply(transaction);
+		return;
+	}
+
+	if (timeout_ms > 0) {
+		transaction->timer = wl_event_loop_add_timer(transaction->event_loop,
+			transaction_handle_timeout, transaction);
+		if (transaction->timer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create transaction timer");
+			return;
+		}
+		wl_event_source_timer_update(transaction->timer, timeout_ms);
+	}
+}
+
+void wlr_xdg_transaction_destroy(struct wlr_xdg_transaction *transaction) {
+	if (transaction == NULL) {
+		return;
+	}
+
+	// Apply the held states in a row, so that they end up in the same frame
+	struct wlr_xdg_transaction_participant *participant, *tmp;
+	wl_list_for_each_safe(participant, tmp, &transaction->participants, link) {
+		struct wlr_surface *surface = participant->surface;
+		participant_destroy(participant);
+		wlr_surface_release_commits(surface);
+	}
+
+	wlr_signal_emit_safe(&transaction->events.apply, transaction);
+	wlr_signal_emit_safe(&transaction->events.destroy, transaction);
+
+	if (transaction->timer != NULL) {
+		wl_event_source_remove(transaction->timer);
+	}
+	if (transaction->apply_idle != NULL) {
+		wl_event_source_remove(transaction->apply_idle);
+	}
+	free(transaction);
+}
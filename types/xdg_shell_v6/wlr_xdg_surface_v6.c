@@ -409,15 +409,16 @@ void handle_xdg_surface_v6_commit(struct wlr_surface *wlr_surface) {
 	}
 }
 
-void handle_xdg_surface_v6_precommit(struct wlr_surface *wlr_surface) {
+void handle_xdg_surface_v6_precommit(struct wlr_surface *wlr_surface,
+		const struct wlr_surface_state *state) {
 	struct wlr_xdg_surface_v6 *surface =
 		wlr_xdg_surface_v6_from_wlr_surface(wlr_surface);
 	if (surface == NULL) {
 		return;
 	}
 
-	if (wlr_surface->pending.committed & WLR_SURFACE_STATE_BUFFER &&
-			wlr_surface->pending.buffer_resource == NULL) {
+	if (state->committed & WLR_SURFACE_STATE_BUFFER &&
+			state->buffer_resource == NULL) {
 		// This is a NULL commit
 		if (surface->configured && surface->mapped) {
 			unmap_xdg_surface_v6(surface);
@@ -1,13 +1,40 @@
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <wlr/types/wlr_box.h>
 #include <wlr/util/region.h>
 
+// Regions with at most this many rectangles are processed without heap
+// allocations, which covers the common single-rectangle damage
+#define REGION_STACK_RECTS 16
+
+static pixman_box32_t *region_rects_alloc(pixman_box32_t *stack_rects,
+		int nrects) {
+	if (nrects <= REGION_STACK_RECTS) {
+		return stack_rects;
+	}
+	return malloc(nrects * sizeof(pixman_box32_t));
+}
+
+static void region_set_rects(pixman_region32_t *dst, pixman_box32_t *rects,
+		int nrects, pixman_box32_t *stack_rects) {
+	pixman_region32_fini(dst);
+	pixman_region32_init_rects(dst, rects, nrects);
+	if (rects != stack_rects) {
+		free(rects);
+	}
+}
+
 void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
 		float scale) {
-	if (scale == 1) {
+	wlr_region_scale_xy(dst, src, scale, scale);
+}
+
+void wlr_region_scale_xy(pixman_region32_t *dst, pixman_region32_t *src,
+		float scale_x, float scale_y) {
+	if (scale_x == 1 && scale_y == 1) {
 		pixman_region32_copy(dst, src);
 		return;
 	}
@@ -15,21 +42,20 @@ void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
 
 	for (int i = 0; i < nrects; ++i) {
-		dst_rects[i].x1 = floor(src_rects[i].x1 * scale);
-		dst_rects[i].x2 = ceil(src_rects[i].x2 * scale);
-		dst_rects[i].y1 = floor(src_rects[i].y1 * scale);
-		dst_rects[i].y2 = ceil(src_rects[i].y2 * scale);
+		dst_rects[i].x1 = floor(src_rects[i].x1 * scale_x);
+		dst_rects[i].x2 = ceil(src_rects[i].x2 * scale_x);
+		dst_rects[i].y1 = floor(src_rects[i].y1 * scale_y);
+		dst_rects[i].y2 = ceil(src_rects[i].y2 * scale_y);
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_set_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
@@ -42,7 +68,8 @@ void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -100,9 +127,7 @@ void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
 		}
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_set_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
@@ -115,7 +140,8 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -127,9 +153,7 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 		dst_rects[i].y2 = src_rects[i].y2 + distance;
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_set_rects(dst, dst_rects, nrects, stack_rects);
 }
 
 void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
@@ -142,7 +166,8 @@ void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -176,9 +201,171 @@ void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 		dst_rects[i].y2 = ceil(oy + y2);
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_set_rects(dst, dst_rects, nrects, stack_rects);
+}
+
+static int64_t box_area(const pixman_box32_t *box) {
+	return (int64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+static void box_union(pixman_box32_t *dst, const pixman_box32_t *a,
+		const pixman_box32_t *b) {
+	dst->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+	dst->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+	dst->x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+	dst->y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+}
+
+static bool box_intersects(const pixman_box32_t *a, const pixman_box32_t *b) {
+	return a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2;
+}
+
+// Area added to the region by replacing two boxes with their bounding box
+static int64_t box_merge_cost(const pixman_box32_t *a,
+		const pixman_box32_t *b) {
+	pixman_box32_t merged;
+	box_union(&merged, a, b);
+	return box_area(&merged) - box_area(a) - box_area(b);
+}
+
+struct merge_box {
+	pixman_box32_t box;
+	bool merged; // merged into another box
+	int best; // cheapest box to merge with
+	int64_t best_cost;
+};
+
+static void merge_box_update_best(struct merge_box *boxes, int n, int i) {
+	boxes[i].best = -1;
+	boxes[i].best_cost = INT64_MAX;
+	for (int j = 0; j < n; ++j) {
+		if (j == i || boxes[j].merged) {
+			continue;
+		}
+		int64_t cost = box_merge_cost(&boxes[i].box, &boxes[j].box);
+		if (cost < boxes[i].best_cost) {
+			boxes[i].best = j;
+			boxes[i].best_cost = cost;
+		}
+	}
+}
+
+static void merge_box_into(struct merge_box *boxes, int dst, int src) {
+	box_union(&boxes[dst].box, &boxes[dst].box, &boxes[src].box);
+	boxes[src].merged = true;
+}
+
+/**
+ * Merges the cheapest pair of boxes. Boxes overlapping the result are merged
+ * into it as well so that the boxes stay disjoint, and the sum of their areas
+ * is the area of the region.
+ */
+static void merge_boxes_step(struct merge_box *boxes, int n) {
+	int i = -1;
+	for (int j = 0; j < n; ++j) {
+		if (!boxes[j].merged &&
+				(i < 0 || boxes[j].best_cost < boxes[i].best_cost)) {
+			i = j;
+		}
+	}
+	merge_box_into(boxes, i, boxes[i].best);
+
+	bool absorbed;
+	do {
+		absorbed = false;
+		for (int j = 0; j < n; ++j) {
+			if (j != i && !boxes[j].merged &&
+					box_intersects(&boxes[i].box, &boxes[j].box)) {
+				merge_box_into(boxes, i, j);
+				absorbed = true;
+			}
+		}
+	} while (absorbed);
+
+	// Only the costs involving the grown box have changed
+	for (int j = 0; j < n; ++j) {
+		if (j == i || boxes[j].merged) {
+			continue;
+		}
+		if (boxes[j].best == i || boxes[boxes[j].best].merged) {
+			merge_box_update_best(boxes, n, j);
+			continue;
+		}
+		int64_t cost = box_merge_cost(&boxes[j].box, &boxes[i].box);
+		if (cost < boxes[j].best_cost) {
+			boxes[j].best = i;
+			boxes[j].best_cost = cost;
+		}
+	}
+	merge_box_update_best(boxes, n, i);
+}
+
+void wlr_region_simplify(pixman_region32_t *dst, pixman_region32_t *src,
+		int max_rects) {
+	int nrects;
+	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	if (nrects <= max_rects) {
+		pixman_region32_copy(dst, src);
+		return;
+	}
+	if (max_rects <= 1) {
+		pixman_box32_t extents = *pixman_region32_extents(src);
+		pixman_region32_fini(dst);
+		pixman_region32_init_with_extents(dst, &extents);
+		return;
+	}
+
+	struct merge_box *boxes = calloc(nrects, sizeof(struct merge_box));
+	pixman_box32_t stack_rects[REGION_STACK_RECTS];
+	pixman_box32_t *dst_rects = region_rects_alloc(stack_rects, nrects);
+	if (boxes == NULL || dst_rects == NULL) {
+		free(boxes);
+		if (dst_rects != stack_rects) {
+			free(dst_rects);
+		}
+		pixman_box32_t extents = *pixman_region32_extents(src);
+		pixman_region32_fini(dst);
+		pixman_region32_init_with_extents(dst, &extents);
+		return;
+	}
+
+	for (int i = 0; i < nrects; ++i) {
+		boxes[i].box = src_rects[i];
+	}
+	for (int i = 0; i < nrects; ++i) {
+		merge_box_update_best(boxes, nrects, i);
+	}
+
+	// Disjoint boxes can still be split into more rectangles once stored in
+	// a region, since pixman keeps them sorted in horizontal bands
+	pixman_region32_t merged;
+	pixman_region32_init(&merged);
+	int n = nrects;
+	int target = max_rects;
+	while (true) {
+		while (n > target) {
+			merge_boxes_step(boxes, nrects);
+			n = 0;
+			for (int i = 0; i < nrects; ++i) {
+				if (!boxes[i].merged) {
+					dst_rects[n++] = boxes[i].box;
+				}
+			}
+		}
+		pixman_region32_fini(&merged);
+		pixman_region32_init_rects(&merged, dst_rects, n);
+		if (n <= 1 || pixman_region32_n_rects(&merged) <= max_rects) {
+			break;
+		}
+		target = n - 1;
+	}
+
+	pixman_region32_copy(dst, &merged);
+	pixman_region32_fini(&merged);
+	if (dst_rects != stack_rects) {
+		free(dst_rects);
+	}
+	free(boxes);
 }
 
 static void region_confine(pixman_region32_t *region, double x1, double y1, double x2,
@@ -24,6 +24,7 @@
  */
 
 #define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,6 +33,37 @@
 #include <wlr/xcursor.h>
 #include "xcursor/xcursor.h"
 
+#define XCURSOR_INDEX_MIN_BUCKETS 64
+
+struct xcursor_index_image {
+	int size; // requested size
+	unsigned int nominal_size; // size of the decoded images
+	struct wlr_xcursor *cursor; // NULL if the cursor couldn't be decoded
+	bool owned; // false if the cursor is shared with another size
+};
+
+struct xcursor_index_entry {
+	char *name;
+	char *path;
+	struct xcursor_index_entry *next; // next entry in the bucket
+
+	struct xcursor_index_image *images;
+	size_t images_len;
+};
+
+/**
+ * Maps cursor names to cursor files. Cursors are only decoded when they are
+ * first requested, and decoded images are shared between all themes using the
+ * index.
+ */
+struct wlr_xcursor_theme_index {
+	int refs;
+
+	struct xcursor_index_entry **buckets;
+	size_t bucket_count; // always a power of two
+	size_t entry_count;
+};
+
 static void xcursor_destroy(struct wlr_xcursor *cursor) {
 	for (size_t i = 0; i < cursor->image_count; i++) {
 		free(cursor->images[i]->buffer);
@@ -184,83 +216,305 @@ static struct wlr_xcursor *xcursor_create_from_xcursor_images(
 	return cursor;
 }
 
-static void load_callback(XcursorImages *images, void *data) {
-	struct wlr_xcursor_theme *theme = data;
-	struct wlr_xcursor *cursor;
+static uint32_t index_hash(const char *name) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (const char *c = name; *c != '\0'; c++) {
+		hash ^= (uint8_t)*c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
 
-	if (wlr_xcursor_theme_get_cursor(theme, images->name)) {
-		XcursorImagesDestroy(images);
+static struct wlr_xcursor_theme_index *index_create(void) {
+	struct wlr_xcursor_theme_index *index = calloc(1, sizeof(*index));
+	if (index == NULL) {
+		return NULL;
+	}
+	index->buckets = calloc(XCURSOR_INDEX_MIN_BUCKETS,
+		sizeof(index->buckets[0]));
+	if (index->buckets == NULL) {
+		free(index);
+		return NULL;
+	}
+	index->bucket_count = XCURSOR_INDEX_MIN_BUCKETS;
+	index->refs = 1;
+	return index;
+}
+
+static void index_unref(struct wlr_xcursor_theme_index *index) {
+	if (index == NULL || --index->refs > 0) {
 		return;
 	}
 
-	cursor = xcursor_create_from_xcursor_images(images, theme);
+	for (size_t i = 0; i < index->bucket_count; i++) {
+		struct xcursor_index_entry *entry = index->buckets[i];
+		while (entry != NULL) {
+			struct xcursor_index_entry *next = entry->next;
+			for (size_t j = 0; j < entry->images_len; j++) {
+				if (entry->images[j].owned) {
+					xcursor_destroy(entry->images[j].cursor);
+				}
+			}
+			free(entry->images);
+			free(entry->name);
+			free(entry->path);
+			free(entry);
+			entry = next;
+		}
+	}
+	free(index->buckets);
+	free(index);
+}
 
-	if (cursor) {
-		theme->cursor_count++;
-		theme->cursors =
-			realloc(theme->cursors,
-				theme->cursor_count * sizeof(theme->cursors[0]));
+static struct xcursor_index_entry *index_find(
+		struct wlr_xcursor_theme_index *index, const char *name) {
+	uint32_t hash = index_hash(name);
+	struct xcursor_index_entry *entry =
+		index->buckets[hash & (index->bucket_count - 1)];
+	for (; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->name, name) == 0) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void index_grow(struct wlr_xcursor_theme_index *index) {
+	size_t bucket_count = index->bucket_count * 2;
+	struct xcursor_index_entry **buckets =
+		calloc(bucket_count, sizeof(buckets[0]));
+	if (buckets == NULL) {
+		// Keep using the current buckets, lookups will just be slower
+		return;
+	}
 
-		if (theme->cursors == NULL) {
-			theme->cursor_count--;
-			free(cursor);
-		} else {
-			theme->cursors[theme->cursor_count - 1] = cursor;
+	for (size_t i = 0; i < index->bucket_count; i++) {
+		struct xcursor_index_entry *entry = index->buckets[i];
+		while (entry != NULL) {
+			struct xcursor_index_entry *next = entry->next;
+			uint32_t hash = index_hash(entry->name);
+			struct xcursor_index_entry **bucket =
+				&buckets[hash & (bucket_count - 1)];
+			entry->next = *bucket;
+			*bucket = entry;
+			entry = next;
 		}
 	}
 
-	XcursorImagesDestroy(images);
+	free(index->buckets);
+	index->buckets = buckets;
+	index->bucket_count = bucket_count;
 }
 
-struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
-	struct wlr_xcursor_theme *theme;
+static void index_callback(const char *name, const char *path, void *data) {
+	struct wlr_xcursor_theme_index *index = data;
 
-	theme = malloc(sizeof(*theme));
-	if (!theme) {
+	// Inherited themes are indexed last, the first cursor found wins
+	if (index_find(index, name) != NULL) {
+		return;
+	}
+
+	struct xcursor_index_entry *entry = calloc(1, sizeof(*entry));
+	if (entry == NULL) {
+		return;
+	}
+	entry->name = strdup(name);
+	entry->path = strdup(path);
+	if (entry->name == NULL || entry->path == NULL) {
+		free(entry->name);
+		free(entry->path);
+		free(entry);
+		return;
+	}
+
+	if (index->entry_count >= index->bucket_count) {
+		index_grow(index);
+	}
+
+	uint32_t hash = index_hash(name);
+	struct xcursor_index_entry **bucket =
+		&index->buckets[hash & (index->bucket_count - 1)];
+	entry->next = *bucket;
+	*bucket = entry;
+	index->entry_count++;
+}
+
+static struct xcursor_index_image *index_entry_add_image(
+		struct xcursor_index_entry *entry, int size,
+		unsigned int nominal_size, struct wlr_xcursor *cursor, bool owned) {
+	struct xcursor_index_image *images = realloc(entry->images,
+		(entry->images_len + 1) * sizeof(entry->images[0]));
+	if (images == NULL) {
 		return NULL;
 	}
+	entry->images = images;
+
+	struct xcursor_index_image *image = &entry->images[entry->images_len++];
+	image->size = size;
+	image->nominal_size = nominal_size;
+	image->cursor = cursor;
+	image->owned = owned;
+	return image;
+}
 
-	if (!name) {
-		name = "default";
+static struct wlr_xcursor *index_entry_load(struct xcursor_index_entry *entry,
+		int size) {
+	for (size_t i = 0; i < entry->images_len; i++) {
+		if (entry->images[i].size == size) {
+			return entry->images[i].cursor;
+		}
+	}
+
+	unsigned int nominal_size = xcursor_file_best_size(entry->path, size);
+	if (nominal_size == 0) {
+		wlr_log(WLR_DEBUG, "Failed to load cursor '%s' from %s",
+			entry->name, entry->path);
+		index_entry_add_image(entry, size, 0, NULL, false);
+		return NULL;
+	}
+
+	// Another size might have picked the same images
+	for (size_t i = 0; i < entry->images_len; i++) {
+		if (entry->images[i].nominal_size == nominal_size &&
+				entry->images[i].cursor != NULL) {
+			struct wlr_xcursor *cursor = entry->images[i].cursor;
+			index_entry_add_image(entry, size, nominal_size, cursor, false);
+			return cursor;
+		}
+	}
+
+	struct wlr_xcursor *cursor = NULL;
+	XcursorImages *images =
+		xcursor_file_load_images(entry->path, entry->name, nominal_size);
+	if (images != NULL) {
+		cursor = xcursor_create_from_xcursor_images(images, NULL);
+		XcursorImagesDestroy(images);
+	}
+	if (cursor == NULL) {
+		wlr_log(WLR_DEBUG, "Failed to load cursor '%s' from %s",
+			entry->name, entry->path);
+	}
+
+	if (index_entry_add_image(entry, size, nominal_size, cursor,
+			cursor != NULL) == NULL && cursor != NULL) {
+		xcursor_destroy(cursor);
+		return NULL;
+	}
+	return cursor;
+}
+
+/**
+ * Returns true if at least one cursor of the index can be decoded at the given
+ * size. The decoded cursor is kept in the index.
+ */
+static bool index_has_cursors(struct wlr_xcursor_theme_index *index,
+		int size) {
+	for (size_t i = 0; i < index->bucket_count; i++) {
+		struct xcursor_index_entry *entry = index->buckets[i];
+		for (; entry != NULL; entry = entry->next) {
+			if (index_entry_load(entry, size) != NULL) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void theme_add_cursor(struct wlr_xcursor_theme *theme,
+		struct wlr_xcursor *cursor) {
+	// The cursor may have been obtained before, or loaded by another theme
+	// sharing the index
+	for (unsigned int i = 0; i < theme->cursor_count; i++) {
+		if (theme->cursors[i] == cursor) {
+			return;
+		}
+	}
+
+	// Grow the array geometrically: its capacity is the next power of two
+	unsigned int count = theme->cursor_count;
+	if ((count & (count - 1)) == 0) {
+		size_t cap = count == 0 ? 1 : 2 * (size_t)count;
+		struct wlr_xcursor **cursors =
+			realloc(theme->cursors, cap * sizeof(theme->cursors[0]));
+		if (cursors == NULL) {
+			return;
+		}
+		theme->cursors = cursors;
+	}
+	theme->cursors[theme->cursor_count++] = cursor;
+}
+
+static struct wlr_xcursor_theme *theme_create(const char *name, int size,
+		struct wlr_xcursor_theme_index *index) {
+	struct wlr_xcursor_theme *theme = calloc(1, sizeof(*theme));
+	if (!theme) {
+		return NULL;
 	}
 
 	theme->name = strdup(name);
 	if (!theme->name) {
-		goto out_error_name;
+		free(theme);
+		return NULL;
 	}
 	theme->size = size;
-	theme->cursor_count = 0;
-	theme->cursors = NULL;
-
-	xcursor_load_theme(name, size, load_callback, theme);
 
-	if (theme->cursor_count == 0) {
+	// Fall back to the built-in theme if none of the cursors can be decoded
+	if (index != NULL && index_has_cursors(index, size)) {
+		index->refs++;
+		theme->index = index;
+	} else {
 		load_default_theme(theme);
 	}
 
-	wlr_log(WLR_DEBUG, "Loaded cursor theme '%s', available cursors:",
-			theme->name);
-	for (size_t i = 0; i < theme->cursor_count; ++i) {
-		struct wlr_xcursor *c = theme->cursors[i];
-		struct wlr_xcursor_image *i = c->images[0];
-		wlr_log(WLR_DEBUG, "%s (%u images) %dx%d+%d,%d",
-				c->name, c->image_count,
-				i->width, i->height, i->hotspot_x, i->hotspot_y);
+	return theme;
+}
+
+struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
+	if (!name) {
+		name = "default";
+	}
+
+	struct wlr_xcursor_theme_index *index = index_create();
+	if (index != NULL) {
+		xcursor_index_theme(name, index_callback, index);
+		if (index->entry_count == 0) {
+			index_unref(index);
+			index = NULL;
+		}
+	}
+
+	struct wlr_xcursor_theme *theme = theme_create(name, size, index);
+	// The theme holds its own reference
+	index_unref(index);
+	if (theme == NULL) {
+		return NULL;
+	}
+
+	if (theme->index != NULL) {
+		wlr_log(WLR_DEBUG, "Indexed cursor theme '%s', %zu cursors available",
+			theme->name, theme->index->entry_count);
+	} else {
+		wlr_log(WLR_DEBUG, "Loaded built-in cursor theme, %u cursors available",
+			theme->cursor_count);
 	}
 
 	return theme;
+}
 
-out_error_name:
-	free(theme);
-	return NULL;
+struct wlr_xcursor_theme *wlr_xcursor_theme_load_size(
+		struct wlr_xcursor_theme *theme, int size) {
+	return theme_create(theme->name, size, theme->index);
 }
 
 void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
-	unsigned int i;
-
-	for (i = 0; i < theme->cursor_count; i++) {
-		xcursor_destroy(theme->cursors[i]);
+	// Cursors loaded from an index are owned by the index
+	if (theme->index == NULL) {
+		for (unsigned int i = 0; i < theme->cursor_count; i++) {
+			xcursor_destroy(theme->cursors[i]);
+		}
 	}
+	index_unref(theme->index);
 
 	free(theme->name);
 	free(theme->cursors);
@@ -269,15 +523,25 @@ void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
 
 struct wlr_xcursor *wlr_xcursor_theme_get_cursor(struct wlr_xcursor_theme *theme,
 		const char *name) {
-	unsigned int i;
-
-	for (i = 0; i < theme->cursor_count; i++) {
-		if (strcmp(name, theme->cursors[i]->name) == 0) {
-			return theme->cursors[i];
+	if (theme->index == NULL) {
+		for (unsigned int i = 0; i < theme->cursor_count; i++) {
+			if (strcmp(name, theme->cursors[i]->name) == 0) {
+				return theme->cursors[i];
+			}
 		}
+		return NULL;
 	}
 
-	return NULL;
+	struct xcursor_index_entry *entry = index_find(theme->index, name);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	struct wlr_xcursor *cursor = index_entry_load(entry, theme->size);
+	if (cursor != NULL) {
+		theme_add_cursor(theme, cursor);
+	}
+	return cursor;
 }
 
 static int xcursor_frame_and_duration(struct wlr_xcursor *cursor,
@@ -25,9 +25,14 @@
 
 #define _DEFAULT_SOURCE
 #include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "xcursor/xcursor.h"
 
 /*
@@ -471,6 +476,7 @@ _XcursorReadImage (XcursorFile		*file,
     XcursorImage	*image;
     int			n;
     XcursorPixel	*p;
+    unsigned char	*bytes;
 
     if (!file || !fileHeader)
         return NULL;
@@ -507,15 +513,27 @@ _XcursorReadImage (XcursorFile		*file,
     image->yhot = head.yhot;
     image->delay = head.delay;
     n = image->width * image->height;
+    if (n > INT_MAX / 4)
+    {
+	XcursorImageDestroy (image);
+	return NULL;
+    }
+    /* read all pixels at once and convert them from LSBFirst in place */
+    if ((*file->read) (file, (unsigned char *) image->pixels, n * 4) != n * 4)
+    {
+	XcursorImageDestroy (image);
+	return NULL;
+    }
     p = image->pixels;
+    bytes = (unsigned char *) image->pixels;
     while (n--)
     {
-	if (!_XcursorReadUInt (file, p))
-	{
-	    XcursorImageDestroy (image);
-	    return NULL;
-	}
+	*p = (((XcursorUInt) bytes[0] << 0) |
+	      ((XcursorUInt) bytes[1] << 8) |
+	      ((XcursorUInt) bytes[2] << 16) |
+	      ((XcursorUInt) bytes[3] << 24));
 	p++;
+	bytes += 4;
     }
     return image;
 }
@@ -609,6 +627,95 @@ XcursorFileLoadImages (FILE *file, int size)
     return XcursorXcFileLoadImages (&f, size);
 }
 
+/*
+ * Memory-backed cursor files, used to decode mmap'ed cursors without going
+ * through stdio
+ */
+
+typedef struct _XcursorMemoryFile {
+    const unsigned char	*data;
+    size_t		size;
+    size_t		pos;
+} XcursorMemoryFile;
+
+static int
+_XcursorMemoryFileRead (XcursorFile *file, unsigned char *buf, int len)
+{
+    XcursorMemoryFile	*m = file->closure;
+    size_t		avail = m->size - m->pos;
+
+    if (len < 0)
+	return 0;
+    if ((size_t) len > avail)
+	len = avail;
+    memcpy (buf, m->data + m->pos, len);
+    m->pos += len;
+    return len;
+}
+
+static int
+_XcursorMemoryFileWrite (XcursorFile *file, unsigned char *buf, int len)
+{
+    return 0;
+}
+
+static int
+_XcursorMemoryFileSeek (XcursorFile *file, long offset, int whence)
+{
+    XcursorMemoryFile	*m = file->closure;
+    long		pos;
+
+    switch (whence) {
+    case SEEK_SET:
+	pos = offset;
+	break;
+    case SEEK_CUR:
+	pos = (long) m->pos + offset;
+	break;
+    case SEEK_END:
+	pos = (long) m->size + offset;
+	break;
+    default:
+	return EOF;
+    }
+    if (pos < 0 || (size_t) pos > m->size)
+	return EOF;
+    m->pos = pos;
+    return 0;
+}
+
+static void
+_XcursorMemoryFileInitialize (XcursorMemoryFile *memfile, XcursorFile *file)
+{
+    file->closure = memfile;
+    file->read = _XcursorMemoryFileRead;
+    file->write = _XcursorMemoryFileWrite;
+    file->seek = _XcursorMemoryFileSeek;
+}
+
+static void *
+_XcursorMapFile (const char *path, size_t *size)
+{
+    struct stat	st;
+    void	*data;
+    int		fd;
+
+    fd = open (path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+	return NULL;
+    if (fstat (fd, &st) != 0 || st.st_size <= 0)
+    {
+	close (fd);
+	return NULL;
+    }
+    data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED)
+	return NULL;
+    *size = st.st_size;
+    return data;
+}
+
 /*
  * From libXcursor/src/library.c
  */
@@ -873,16 +980,86 @@ XcursorLibraryLoadImages (const char *file, const char *theme, int size)
     return images;
 }
 
+/** Get the nominal size of the cursor images closest to a size
+ *
+ * Only the file header is read, the images aren't decoded.
+ *
+ * \param path The path of the cursor file
+ * \param size The desired size of the cursor images
+ * \return The nominal size of the closest images, or 0 on error
+ */
+unsigned int
+xcursor_file_best_size(const char *path, int size)
+{
+	XcursorMemoryFile memfile = {0};
+	XcursorFile f;
+	XcursorFileHeader *fileHeader;
+	XcursorDim bestSize;
+	int nsize;
+	void *data;
+
+	if (size < 0)
+		return 0;
+
+	data = _XcursorMapFile(path, &memfile.size);
+	if (!data)
+		return 0;
+	memfile.data = data;
+
+	_XcursorMemoryFileInitialize(&memfile, &f);
+	fileHeader = _XcursorReadFileHeader(&f);
+	bestSize = 0;
+	if (fileHeader) {
+		bestSize = _XcursorFindBestSize(fileHeader, size, &nsize);
+		_XcursorFileHeaderDestroy(fileHeader);
+	}
+
+	munmap(data, memfile.size);
+	return bestSize;
+}
+
+/** Decode the cursor images of a file
+ *
+ * The file is mmap'ed and only the images with the nominal size closest to
+ * the desired size are decoded.
+ *
+ * \param path The path of the cursor file
+ * \param name The name of the cursor
+ * \param size The desired size of the cursor images
+ * \return The decoded images, to be destroyed with XcursorImagesDestroy(),
+ * or NULL on error
+ */
+XcursorImages *
+xcursor_file_load_images(const char *path, const char *name, int size)
+{
+	XcursorMemoryFile memfile = {0};
+	XcursorFile f;
+	XcursorImages *images;
+	void *data;
+
+	data = _XcursorMapFile(path, &memfile.size);
+	if (!data)
+		return NULL;
+	memfile.data = data;
+
+	_XcursorMemoryFileInitialize(&memfile, &f);
+	images = XcursorXcFileLoadImages(&f, size);
+	if (images)
+		XcursorImagesSetName(images, name);
+
+	munmap(data, memfile.size);
+	return images;
+}
+
 static void
-load_all_cursors_from_dir(const char *path, int size,
-			  void (*load_callback)(XcursorImages *, void *),
-			  void *user_data)
+index_all_cursors_from_dir(const char *path,
+			   void (*index_callback)(const char *, const char *,
+						  void *),
+			   void *user_data)
 {
-	FILE *f;
 	DIR *dir = opendir(path);
 	struct dirent *ent;
 	char *full;
-	XcursorImages *images;
 
 	if (!dir)
 		return;
@@ -898,48 +1075,32 @@ load_all_cursors_from_dir(const char *path, int size,
 		if (!full)
 			continue;
 
-		f = fopen(full, "r");
-		if (!f) {
-			free(full);
-			continue;
-		}
-
-		images = XcursorFileLoadImages(f, size);
-
-		if (images) {
-			XcursorImagesSetName(images, ent->d_name);
-			load_callback(images, user_data);
-		}
-
-		fclose (f);
+		index_callback(ent->d_name, full, user_data);
 		free(full);
 	}
 
 	closedir(dir);
 }
 
-/** Load all the cursor of a theme
+/** Index all the cursors of a theme
  *
- * This function loads all the cursor images of a given theme and its
- * inherited themes. Each cursor is loaded into an XcursorImages object
- * which is passed to the caller's load callback. If a cursor appears
- * more than once across all the inherited themes, the load callback
- * will be called multiple times, with possibly different XcursorImages
- * object which have the same name. The user is expected to destroy the
- * XcursorImages objects passed to the callback with
- * XcursorImagesDestroy().
+ * This function lists the cursor files of a given theme and its inherited
+ * themes, without opening them. The cursors can then be decoded on demand
+ * with xcursor_file_load_images(). If a cursor appears more than once across
+ * all the inherited themes, the index callback will be called multiple
+ * times with the same name, the first call being the one from the most
+ * specific theme.
  *
- * \param theme The name of theme that should be loaded
- * \param size The desired size of the cursor images
- * \param load_callback A callback function that will be called
- * for each cursor loaded. The first parameter is the XcursorImages
- * object representing the loaded cursor and the second is a pointer
- * to data provided by the user.
- * \param user_data The data that should be passed to the load callback
+ * \param theme The name of theme that should be indexed
+ * \param index_callback A callback function that will be called
+ * for each cursor file. The first parameter is the name of the cursor, the
+ * second is the path of the cursor file and the third is a pointer to data
+ * provided by the user. Both strings are only valid during the call.
+ * \param user_data The data that should be passed to the index callback
  */
 void
-xcursor_load_theme(const char *theme, int size,
-		    void (*load_callback)(XcursorImages *, void *),
+xcursor_index_theme(const char *theme,
+		    void (*index_callback)(const char *, const char *, void *),
 		    void *user_data)
 {
 	char *full, *dir;
@@ -959,8 +1120,8 @@ xcursor_load_theme(const char *theme, int size,
 		full = _XcursorBuildFullname(dir, "cursors", "");
 
 		if (full) {
-			load_all_cursors_from_dir(full, size, load_callback,
-						  user_data);
+			index_all_cursors_from_dir(full, index_callback,
+						   user_data);
 			free(full);
 		}
 
@@ -976,7 +1137,7 @@ xcursor_load_theme(const char *theme, int size,
 	}
 
 	for (i = inherits; i; i = _XcursorNextPath(i))
-		xcursor_load_theme(i, size, load_callback, user_data);
+		xcursor_index_theme(i, index_callback, user_data);
 
 	if (inherits)
 		free(inherits);